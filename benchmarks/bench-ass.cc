@@ -0,0 +1,174 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-ass [COUNT]
+// Read an Advanced SubStation Alpha document of COUNT dialogues (100000 by
+// default):
+// - with the old reader (all the lines, then a regex for each line of the
+//   script info and the events),
+// - with the streaming reader of the plugin,
+// the subtitles must be the same.
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include "benchmark.h"
+#include "document.h"
+#include "reader.h"
+#include "subtitleformatsystem.h"
+#include "utility.h"
+
+// The reader replaced by the streaming reader, without the styles. The layer
+// is read too, to compare the subtitles.
+class OldReader {
+ public:
+  explicit OldReader(Document *doc) : m_document(doc) {
+  }
+
+  void open(Reader &file) {
+    std::vector<Glib::ustring> lines = file.get_lines();
+
+    DocumentBulkEdit bulk(m_document);
+    read_script_info(lines);
+    read_events(lines);
+  }
+
+ protected:
+  void read_script_info(const std::vector<Glib::ustring> &lines) {
+    ScriptInfo &script_info = m_document->get_script_info();
+
+    Glib::RefPtr<Glib::Regex> re = Glib::Regex::create("^(.*?):\\s(.*?)$");
+    Glib::RefPtr<Glib::Regex> re_block = Glib::Regex::create("^\\[.*\\]$");
+
+    bool read = false;
+
+    for (const auto &line : lines) {
+      if (read) {
+        if (re_block->match(line))
+          return;
+      } else if (line.find("[Script Info]") != Glib::ustring::npos) {
+        read = true;
+      }
+
+      if (!read)
+        continue;
+      if (!re->match(line))
+        continue;
+
+      std::vector<Glib::ustring> group = re->split(line);
+      if (group.size() == 1)
+        continue;
+
+      script_info.data[group[1]] = group[2];
+    }
+  }
+
+  void read_events(const std::vector<Glib::ustring> &lines) {
+    Subtitles subtitles = m_document->subtitles();
+
+    Glib::RefPtr<Glib::Regex> re = Glib::Regex::create(
+        "^Dialogue:\\s*([^,]*),([^,]*),([^,]*),\\**([^,]*),([^,]*),([^,]*),(["
+        "^,"
+        "]*),([^,]*),([^,]*),(.*)$");
+
+    for (const auto &line : lines) {
+      if (!re->match(line))
+        continue;
+
+      std::vector<Glib::ustring> group = re->split(line);
+      if (group.size() == 1)
+        continue;
+
+      Subtitle sub = subtitles.append();
+
+      sub.set_layer(group[1]);
+      sub.set_start_and_end(from_ass_time(group[2]), from_ass_time(group[3]));
+      sub.set_style(group[4]);
+      sub.set_name(group[5]);
+      sub.set_margin_l(group[6]);
+      sub.set_margin_r(group[7]);
+      sub.set_margin_v(group[8]);
+      sub.set_effect(group[9]);
+
+      utility::replace(group[10], "\\n", "\n");
+      utility::replace(group[10], "\\N", "\n");
+      sub.set_text(group[10]);
+    }
+  }
+
+  SubtitleTime from_ass_time(const Glib::ustring &t) {
+    int h, m, s, ms;
+    if (std::sscanf(t.c_str(), "%d:%d:%d.%d", &h, &m, &s, &ms) == 4)
+      return SubtitleTime(h, m, s, ms * 10);
+
+    return SubtitleTime::null();
+  }
+
+ protected:
+  Document *m_document;
+};
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-ass");
+
+  guint count = benchmark_count(argc, argv, 100000);
+  Glib::ustring data = benchmark_ass(count);
+
+  std::unique_ptr<Document> old_doc(new Document());
+  {
+    BenchmarkTimer timer("old reader", count, "dialogues");
+    Reader reader(data);
+    OldReader(old_doc.get()).open(reader);
+  }
+
+  std::unique_ptr<Document> doc(new Document());
+  {
+    BenchmarkTimer timer("streaming reader", count, "dialogues");
+    SubtitleFormatSystem::instance().open_from_data(
+        doc.get(), data, "Advanced Sub Station Alpha");
+  }
+
+  if (doc->subtitles().size() != count ||
+      old_doc->subtitles().size() != count) {
+    std::cerr << "Read " << doc->subtitles().size() << " and "
+              << old_doc->subtitles().size() << " of " << count
+              << " dialogues" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Subtitle a = old_doc->subtitles().get_first();
+  Subtitle b = doc->subtitles().get_first();
+  for (; a && b; ++a, ++b) {
+    std::map<Glib::ustring, Glib::ustring> va, vb;
+    a.get(va);
+    b.get(vb);
+    if (va != vb) {
+      std::cerr << "Different subtitle " << va["path"] << ": '" << va["text"]
+                << "' != '" << vb["text"] << "'" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  old_doc.reset();
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
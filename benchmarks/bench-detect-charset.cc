@@ -0,0 +1,136 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-detect-charset [COUNT]
+// Convert to UTF-8 a corpus of SubRip documents of COUNT subtitles (20000 by
+// default) written in legacy charsets (latin, central european, cyrillic,
+// greek, turkish, chinese and japanese):
+// - with the detection on a sample (Encoding::convert_to_utf8),
+// - with the trial conversion of the whole contents (the user encodings
+//   preferences, then all the encodings until one is valid),
+// and display how many documents are decoded to the original text.
+
+#include <iostream>
+#include <vector>
+#include "benchmark.h"
+#include "cfg.h"
+#include "encodings.h"
+#include "error.h"
+
+struct Sample {
+  const char *charset;
+  const char *text;
+};
+
+static const Sample corpus[] = {
+    {"ISO-8859-15", "Il était déjà là, à côté de la fenêtre. Ça va ?"},
+    {"WINDOWS-1252", "¿Qué pasó? ¡El niño está aquí, señor!"},
+    {"ISO-8859-2", "Příliš žluťoučký kůň úpěl ďábelské ódy."},
+    {"WINDOWS-1250", "Zażółć gęślą jaźń, powiedział ktoś."},
+    {"KOI8R", "Съешь же ещё этих мягких французских булок, да выпей чаю."},
+    {"WINDOWS-1251", "Я не знаю, что он сказал. Пойдём домой!"},
+    {"ISO-8859-7", "Ξεσκεπάζω την ψυχοφθόρα βδελυγμία. Τι κάνεις;"},
+    {"ISO-8859-9", "Pijamalı hasta yağız şoföre çabucak güvendi."},
+    {"GB18030", "我们今天晚上去看电影，好吗？你说什么？"},
+    {"SHIFT_JIS", "いろはにほへと、ちりぬるを。わかよたれそ、つねならむ。"},
+};
+
+// Return a SubRip document of count subtitles with the text.
+static Glib::ustring create_document(const char *text, guint count) {
+  Glib::ustring data;
+  for (guint i = 0; i < count; ++i) {
+    data += Glib::ustring::compose(
+        "%1\n00:00:01,000 --> 00:00:03,500\n%2\n\n", i + 1, text);
+  }
+  return data;
+}
+
+// The conversion by trial of all the charsets, without detection.
+static Glib::ustring convert_by_trial(const std::string &content,
+                                      Glib::ustring &charset) {
+  std::vector<Glib::ustring> charsets;
+  for (const auto &enc : cfg::get_string_list("encodings", "encodings")) {
+    charsets.push_back(enc);
+  }
+  EncodingInfo *infos = Encodings::get_encodings_info();
+  for (unsigned int i = 0; infos[i].name != NULL; ++i) {
+    charsets.push_back(infos[i].charset);
+  }
+
+  for (const auto &enc : charsets) {
+    try {
+      Glib::ustring utf8 = Encoding::convert_to_utf8_from_charset(content, enc);
+      charset = enc;
+      return utf8;
+    } catch (const EncodingConvertError &) {
+      // invalid, try with the next...
+    }
+  }
+  charset.clear();
+  return Glib::ustring();
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-detect-charset");
+
+  guint count = benchmark_count(argc, argv, 20000);
+
+  std::vector<Glib::ustring> texts;
+  std::vector<std::string> contents;
+  guint64 bytes = 0;
+  for (const auto &sample : corpus) {
+    texts.push_back(create_document(sample.text, count));
+    contents.push_back(Glib::convert(texts.back(), sample.charset, "UTF-8"));
+    bytes += contents.back().size();
+  }
+  const guint n = contents.size();
+
+  for (int method = 0; method < 2; ++method) {
+    std::vector<Glib::ustring> charsets(n);
+    guint found = 0;
+    {
+      BenchmarkTimer timer(method == 0 ? "detection" : "trial", bytes,
+                           "bytes");
+      for (guint i = 0; i < n; ++i) {
+        Glib::ustring utf8;
+        if (method == 0) {
+          try {
+            utf8 = Encoding::convert_to_utf8(contents[i], charsets[i]);
+          } catch (const EncodingConvertError &) {
+            charsets[i].clear();
+          }
+        } else {
+          utf8 = convert_by_trial(contents[i], charsets[i]);
+        }
+        if (utf8 == texts[i])
+          ++found;
+      }
+    }
+    for (guint i = 0; i < n; ++i) {
+      std::cout << "  " << corpus[i].charset << " -> "
+                << (charsets[i].empty() ? "(none)" : charsets[i]) << std::endl;
+    }
+    std::cout << Glib::ustring::compose("%1 of %2 documents decoded", found, n)
+              << std::endl;
+  }
+
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
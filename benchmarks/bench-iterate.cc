@@ -0,0 +1,87 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-iterate [COUNT]
+// Iterate over a document of COUNT subtitles (100000 by default) and read
+// their times, like the waveform renderers and the error checkers do.
+// The C++ allocations (operator new) are counted: a step of the iteration
+// must not allocate, the path of a Subtitle is only built on demand.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include "benchmark.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+
+static std::atomic<guint64> allocations(0);
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  void *ptr = std::malloc(size ? size : 1);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-iterate");
+
+  guint count = benchmark_count(argc, argv, 100000);
+
+  std::unique_ptr<Document> doc(new Document());
+  SubtitleFormatSystem::instance().open_from_data(
+      doc.get(), benchmark_subrip(count), "SubRip");
+
+  long duration = 0;
+  guint64 before = allocations;
+  {
+    BenchmarkTimer timer("iterate", count, "subtitles");
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      duration += (sub.get_end() - sub.get_start()).totalmsecs;
+    }
+  }
+  guint64 used = allocations - before;
+
+  std::cout << Glib::ustring::compose("allocations: %1 (%2 per subtitle)",
+                                      used, double(used) / count)
+            << std::endl;
+  std::cout << "(" << duration << ")" << std::endl;
+
+  // A few allocations are expected (first iter, ...), not one per step
+  if (used >= count) {
+    std::cerr << "Each step of the iteration allocates." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-load [COUNT]
+// Load a document of COUNT subtitles (100000 by default):
+// - open a SubRip document from memory,
+// - append the subtitles one by one outside a bulk edit, each change
+//   updates the gap with the previous subtitle (find_previous),
+// - walk the document backward (get_previous).
+// A quadratic find_previous makes the last two measures explode.
+
+#include <iostream>
+#include <memory>
+#include "benchmark.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-load");
+
+  guint count = benchmark_count(argc, argv, 100000);
+  Glib::ustring data = benchmark_subrip(count);
+
+  {
+    std::unique_ptr<Document> doc(new Document());
+    {
+      BenchmarkTimer timer("open SubRip", count, "subtitles");
+      SubtitleFormatSystem::instance().open_from_data(doc.get(), data,
+                                                      "SubRip");
+    }
+    if (doc->subtitles().size() != count) {
+      std::cerr << "open SubRip: " << doc->subtitles().size() << " of "
+                << count << " subtitles" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::unique_ptr<Document> doc(new Document());
+  Subtitles &subtitles = doc->subtitles();
+  {
+    BenchmarkTimer timer("append and set times", count, "subtitles");
+    for (guint i = 0; i < count; ++i) {
+      Subtitle sub = subtitles.append();
+      sub.set_start_and_end(SubtitleTime(i * 3000L),
+                            SubtitleTime(i * 3000L + 2500));
+    }
+  }
+
+  guint n = 0;
+  {
+    BenchmarkTimer timer("get_previous", count, "subtitles");
+    for (Subtitle sub = subtitles.get_last(); sub;
+         sub = subtitles.get_previous(sub)) {
+      ++n;
+    }
+  }
+  if (n != count) {
+    std::cerr << "get_previous: " << n << " of " << count << " subtitles"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-memory [COUNT]
+// Measure the columnar storage of the subtitles (SubtitleStore) with a
+// document of COUNT subtitles (100000 by default):
+// - the memory used per subtitle after the opening,
+// - the time to scan a column (the start and the text of all subtitles),
+// - the memory after renaming every subtitle with a unique name and back,
+//   twice: the released names must not stay in the pool of interned
+//   strings, the second time must reuse their place,
+// - an iter kept after the removal of its row is not valid anymore.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include "benchmark.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+
+static void print_memory(const Glib::ustring &name, Document *doc) {
+  gsize size = doc->get_subtitle_model()->memory_usage();
+  guint count = std::max<guint>(doc->subtitles().size(), 1);
+  std::cout << Glib::ustring::compose(
+                   "%1: %2 KiB, %3 bytes/subtitle", name, size / 1024,
+                   Glib::ustring::format(std::fixed, std::setprecision(1),
+                                         double(size) / count))
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-memory");
+
+  guint count = benchmark_count(argc, argv, 100000);
+
+  std::unique_ptr<Document> doc(new Document());
+  SubtitleFormatSystem::instance().open_from_data(
+      doc.get(), benchmark_ass(count), "Advanced Sub Station Alpha");
+
+  print_memory("open", doc.get());
+
+  guint64 bytes = 0;
+  long sum = 0;
+  {
+    BenchmarkTimer timer("scan start", count, "subtitles");
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      sum += sub.get_start().totalmsecs;
+    }
+  }
+  {
+    BenchmarkTimer timer("scan text", count, "subtitles");
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      bytes += sub.get_text().bytes();
+    }
+  }
+  std::cout << "(" << sum << ", " << bytes << " bytes of text)" << std::endl;
+
+  gsize used[2];
+  for (int round = 0; round < 2; ++round) {
+    DocumentBulkEdit bulk(doc.get());
+    guint i = 0;
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub, ++i) {
+      sub.set_name(Glib::ustring::compose("Name %1-%2", round, i));
+    }
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      sub.set_name("Actor");
+    }
+    used[round] = doc->get_subtitle_model()->memory_usage();
+  }
+  print_memory("unique names and back (x2)", doc.get());
+
+  if (used[1] > used[0]) {
+    std::cerr << "The names are not released: " << used[0] << " -> "
+              << used[1] << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Subtitle first = doc->subtitles().get_first();
+  doc->subtitles().remove(first);
+  doc->subtitles().append();
+  if (first) {
+    std::cerr << "An iter of a removed row is still valid." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-strip-tags [COUNT]
+// Count the characters per line of COUNT texts (100000 by default) with
+// HTML tags and ASS override blocks:
+// - with the old regex ("<.*?>|{.*?}") and std::istringstream,
+// - with the single pass of utility::get_characters_per_line,
+// the results must be the same.
+// Then read the characters per line and per second of a document of COUNT
+// subtitles, they are computed on the first read.
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "benchmark.h"
+#include "cfg.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+#include "utility.h"
+
+// The implementation replaced by the single pass.
+static std::vector<int> regex_characters_per_line(const Glib::ustring &text) {
+  static bool ignore_space = cfg::get_boolean("timing", "ignore-space");
+  static Glib::RefPtr<Glib::Regex> tag_pattern =
+      ignore_space ? Glib::Regex::create("<.*?>|{.*?}| ")
+                   : Glib::Regex::create("<.*?>|{.*?}");
+
+  std::vector<int> num_characters;
+  std::istringstream iss(
+      tag_pattern->replace(text, 0, "", static_cast<Glib::RegexMatchFlags>(0)));
+  std::string line;
+
+  while (std::getline(iss, line)) {
+    Glib::ustring::size_type len =
+        reinterpret_cast<Glib::ustring &>(line).size();
+    num_characters.push_back(len);
+  }
+  return num_characters;
+}
+
+static std::vector<Glib::ustring> create_texts(guint count) {
+  static const char *samples[] = {
+      "Subtitle %1\nThe second line of the subtitle",
+      "<i>Subtitle %1</i>\n<b>The second</b> line",
+      "{\\pos(960,100)\\i1}Sign %1{\\i0}",
+      "{\\an8}Subtitle %1 {with a comment}\n- Yes. < No >",
+      "Ça été créé à %1 h\nDéjà vu",
+      "Unclosed <tag %1\nand {brace",
+  };
+  const guint n = G_N_ELEMENTS(samples);
+
+  std::vector<Glib::ustring> texts;
+  texts.reserve(count);
+  for (guint i = 0; i < count; ++i) {
+    texts.push_back(Glib::ustring::compose(samples[i % n], i + 1));
+  }
+  return texts;
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-strip-tags");
+
+  guint count = benchmark_count(argc, argv, 100000);
+  std::vector<Glib::ustring> texts = create_texts(count);
+
+  std::vector<std::vector<int>> expected(count);
+  {
+    BenchmarkTimer timer("regex", count, "texts");
+    for (guint i = 0; i < count; ++i) {
+      expected[i] = regex_characters_per_line(texts[i]);
+    }
+  }
+
+  std::vector<std::vector<int>> results(count);
+  {
+    BenchmarkTimer timer("single pass", count, "texts");
+    for (guint i = 0; i < count; ++i) {
+      results[i] = utility::get_characters_per_line(texts[i]);
+    }
+  }
+
+  for (guint i = 0; i < count; ++i) {
+    if (results[i] != expected[i]) {
+      std::cerr << "Different characters per line: " << texts[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::unique_ptr<Document> doc(new Document());
+  SubtitleFormatSystem::instance().open_from_data(
+      doc.get(), benchmark_ass(count), "Advanced Sub Station Alpha");
+
+  gsize bytes = 0;
+  double cps = 0;
+  {
+    BenchmarkTimer timer("read cpl/cps", count, "subtitles");
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      bytes += sub.get_characters_per_line_text().bytes();
+      cps += sub.get_characters_per_second_text();
+    }
+  }
+  {
+    BenchmarkTimer timer("read cpl/cps (cached)", count, "subtitles");
+    for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+      bytes += sub.get_characters_per_line_text().bytes();
+      cps += sub.get_characters_per_second_text();
+    }
+  }
+  std::cout << "(" << bytes << ", " << cps << ")" << std::endl;
+
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
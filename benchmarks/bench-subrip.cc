@@ -0,0 +1,67 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// bench-subrip [COUNT]
+// Parse a synthetic SubRip document of COUNT cues (1000000 by default) and
+// save it back. The times of the first and the last cues are checked.
+
+#include <iostream>
+#include <memory>
+#include "benchmark.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+
+int main(int argc, char *argv[]) {
+  benchmark_init("bench-subrip");
+
+  guint count = benchmark_count(argc, argv, 1000000);
+  Glib::ustring data = benchmark_subrip(count);
+
+  std::unique_ptr<Document> doc(new Document());
+  {
+    BenchmarkTimer timer("parse", count, "cues");
+    SubtitleFormatSystem::instance().open_from_data(doc.get(), data, "SubRip");
+  }
+  std::cout << Glib::ustring::compose("%1 MiB", data.bytes() / (1024 * 1024))
+            << std::endl;
+
+  Subtitles subtitles = doc->subtitles();
+  if (subtitles.size() != count ||
+      subtitles.get_first().get_end().totalmsecs != 2500 ||
+      subtitles.get_last().get_start().totalmsecs != (count - 1) * 3000L) {
+    std::cerr << "parse: " << subtitles.size() << " of " << count
+              << " cues or wrong times" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Glib::ustring saved;
+  {
+    BenchmarkTimer timer("save", count, "cues");
+    SubtitleFormatSystem::instance().save_to_data(doc.get(), saved, "SubRip");
+  }
+  if (saved.bytes() == 0) {
+    std::cerr << "save: empty document" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  doc.reset();
+  benchmark_exit();
+  return EXIT_SUCCESS;
+}
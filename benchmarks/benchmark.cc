@@ -0,0 +1,141 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <config.h>
+#include <gtkmm/main.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include "benchmark.h"
+#include "extensionmanager.h"
+#include "utility.h"
+
+// Initialize gtkmm without display and load the subtitle format plugins.
+void benchmark_init(const char *name) {
+  bindtextdomain(GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
+  bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
+  textdomain(GETTEXT_PACKAGE);
+
+  // gtkmm types without display (the models of the document)
+  Gtk::Main::init_gtkmm_internals();
+
+  Glib::set_application_name(name);
+
+  // Only the subtitle formats, the other plugins need the user interface
+  ExtensionManager::instance().create_extensions("subtitleformat");
+}
+
+// Unload the plugins.
+void benchmark_exit() {
+  ExtensionManager::instance().destroy_extensions();
+}
+
+// Return the first argument as a number or default_value.
+guint benchmark_count(int argc, char *argv[], guint default_value) {
+  if (argc < 2)
+    return default_value;
+  guint value = utility::string_to_int(argv[1]);
+  return (value > 0) ? value : default_value;
+}
+
+// Display the time and the throughput of a measure.
+void benchmark_report(const Glib::ustring &name, gint64 usecs, guint64 count,
+                      const Glib::ustring &unit) {
+  double secs = std::max(usecs, gint64(1)) / double(G_USEC_PER_SEC);
+  std::cout << Glib::ustring::compose(
+                   "%1: %2 ms (%3 %4/s)", name,
+                   Glib::ustring::format(std::fixed, std::setprecision(1),
+                                         usecs / 1000.0),
+                   static_cast<guint64>(count / secs), unit)
+            << std::endl;
+}
+
+// h:mm:ss,mmm or h:mm:ss.cc
+static Glib::ustring format_time(long msecs, bool subrip) {
+  long h = msecs / 3600000;
+  long m = (msecs / 60000) % 60;
+  long s = (msecs / 1000) % 60;
+  long ms = msecs % 1000;
+
+  if (subrip)
+    return build_message("%02ld:%02ld:%02ld,%03ld", h, m, s, ms);
+  return build_message("%ld:%02ld:%02ld.%02ld", h, m, s, ms / 10);
+}
+
+// Return a SubRip document of count subtitles.
+Glib::ustring benchmark_subrip(guint count) {
+  Glib::ustring data;
+  data.reserve(count * 80);
+
+  for (guint i = 0; i < count; ++i) {
+    long start = i * 3000L;
+    data += Glib::ustring::compose(
+        "%1\n%2 --> %3\n", i + 1, format_time(start, true),
+        format_time(start + 2500, true));
+    if (i % 10 == 0)
+      data += Glib::ustring::compose("<i>Subtitle %1</i>\n", i + 1);
+    else
+      data += Glib::ustring::compose("Subtitle %1\n", i + 1);
+    data += "The second line of the subtitle\n\n";
+  }
+  return data;
+}
+
+// Return an Advanced SubStation Alpha document of count dialogues.
+Glib::ustring benchmark_ass(guint count) {
+  Glib::ustring data;
+  data.reserve(count * 120 + 1024);
+
+  data +=
+      "[Script Info]\n"
+      "ScriptType: v4.00+\n"
+      "PlayResX: 1920\n"
+      "PlayResY: 1080\n"
+      "\n"
+      "[V4+ Styles]\n"
+      "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+      "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, "
+      "ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, "
+      "Alignment, MarginL, MarginR, MarginV, Encoding\n"
+      "Style: Default,Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,"
+      "0,0,0,0,100,100,0,0,1,2,2,2,10,10,10,1\n"
+      "Style: Sign,Arial,40,&H0000FFFF,&H000000FF,&H00000000,&H00000000,"
+      "-1,0,0,0,100,100,0,0,1,2,0,8,10,10,10,1\n"
+      "\n"
+      "[Events]\n"
+      "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+      "Effect, Text\n";
+
+  for (guint i = 0; i < count; ++i) {
+    long start = i * 3000L;
+    bool sign = (i % 10 == 0);
+    data += Glib::ustring::compose(
+        "Dialogue: %1,%2,%3,%4,%5,0000,0000,0000,,", sign ? 1 : 0,
+        format_time(start, false), format_time(start + 2500, false),
+        sign ? "Sign" : "Default", sign ? "" : "Actor");
+    if (sign)
+      data += Glib::ustring::compose("{\\pos(960,100)\\i1}Sign %1{\\i0}\n",
+                                     i + 1);
+    else
+      data += Glib::ustring::compose(
+          "Subtitle %1, with a comma\\NThe second line\n", i + 1);
+  }
+  return data;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Helpers shared by the benchmark and check programs. They run without
+// display, like subtitleeditor-convert: only the subtitle format plugins
+// are loaded (SE_DEV=1 from the build directory, see Makefile.am).
+
+#include <glibmm.h>
+
+// Initialize gtkmm without display and load the subtitle format plugins.
+void benchmark_init(const char *name);
+
+// Unload the plugins.
+void benchmark_exit();
+
+// Return the first argument as a number or default_value.
+guint benchmark_count(int argc, char *argv[], guint default_value);
+
+// Display the time and the throughput of a measure:
+//   name: 123.4 ms (456789 unit/s)
+void benchmark_report(const Glib::ustring &name, gint64 usecs, guint64 count,
+                      const Glib::ustring &unit);
+
+// Return a SubRip document of count subtitles, with two lines of text and
+// some tags in each subtitle.
+Glib::ustring benchmark_subrip(guint count);
+
+// Return an Advanced SubStation Alpha document of count dialogues, with
+// override tags in some of them.
+Glib::ustring benchmark_ass(guint count);
+
+// Measure the time of a block:
+//   {
+//     BenchmarkTimer timer("open", n, "subtitles");
+//     ...
+//   }
+class BenchmarkTimer {
+ public:
+  BenchmarkTimer(const Glib::ustring &name, guint64 count,
+                 const Glib::ustring &unit)
+      : m_name(name),
+        m_unit(unit),
+        m_count(count),
+        m_start(g_get_monotonic_time()) {
+  }
+
+  ~BenchmarkTimer() {
+    benchmark_report(m_name, g_get_monotonic_time() - m_start, m_count,
+                     m_unit);
+  }
+
+ protected:
+  Glib::ustring m_name;
+  Glib::ustring m_unit;
+  guint64 m_count;
+  gint64 m_start;
+};
@@ -0,0 +1,218 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// check-ass [FILE...]
+// Round trip of Advanced SubStation Alpha documents: each document is
+// opened, saved and opened again, the script info, the styles and the
+// subtitles must be the same. Without argument, a built-in corpus is used
+// (commas and line breaks in the text, override blocks, "*Default" style,
+// partial or reordered Format lines, SSA "Actor" column, CRLF).
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+#include "benchmark.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+#include "utility.h"
+
+static const char *ASS = "Advanced Sub Station Alpha";
+
+static const char *STYLES =
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+    "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, "
+    "ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, "
+    "MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Default,Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,"
+    "0,0,0,0,100,100,0,0,1,2,2,2,10,10,10,1\n"
+    "Style: Sign,DejaVu Sans,40,&H0000FFFF,&H000000FF,&H00101010,&H00000000,"
+    "-1,-1,0,0,90,110,1.5,0,3,0,0,8,20,30,40,0\n"
+    "\n";
+
+static std::vector<Glib::ustring> create_corpus() {
+  std::vector<Glib::ustring> corpus;
+
+  // Commas, \N and \n, override blocks, "*Default", empty text and unicode
+  corpus.push_back(
+      Glib::ustring(
+          "[Script Info]\n"
+          "Title: Round trip\n"
+          "ScriptType: v4.00+\n"
+          "PlayResX: 1280\n"
+          "PlayResY: 720\n"
+          "\n") +
+      STYLES +
+      "[Events]\n"
+      "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+      "Effect, Text\n"
+      "Dialogue: 0,0:00:01.00,0:00:03.50,Default,Actor,0000,0000,0000,,"
+      "Hello, world, with commas\\NSecond line\n"
+      "Dialogue: 1,0:00:04.00,0:00:05.00,*Default,,0010,0020,0030,Scroll up;"
+      "10;20;,{\\pos(640,100)\\i1}Sign{\\i0}\\nsoft break\n"
+      "Dialogue: 2,0:00:05.10,0:00:06.20,Sign,Narrateur,0000,0000,0000,,"
+      "Ça été créé à l'été — « déjà vu »\n"
+      "Dialogue: 0,0:00:07.00,0:00:08.00,Default,,0000,0000,0000,,\n"
+      "Dialogue: 0,1:02:03.45,1:02:04.56,Default,,0000,0000,0000,,"
+      "{\\k20}ka{\\k30}ra{\\k40}o{\\k50}ke\n");
+
+  // Partial and reordered Format line, spaces after "Dialogue:"
+  corpus.push_back(
+      Glib::ustring(
+          "[Script Info]\n"
+          "ScriptType: v4.00+\n"
+          "WrapStyle: 0\n"
+          "\n") +
+      STYLES +
+      "[Events]\n"
+      "Format: Start, End, Style, Layer, Text\n"
+      "Dialogue:   0:00:01.00,0:00:02.00,Sign,3,Text, with {comma}\n"
+      "Dialogue: 0:00:02.00,0:00:03.00,Default,0,Last line\\N\n");
+
+  // SSA "Actor" column and "Marked", CRLF line breaks
+  Glib::ustring crlf =
+      Glib::ustring(
+          "[Script Info]\n"
+          "ScriptType: v4.00+\n"
+          "\n") +
+      STYLES +
+      "[Events]\n"
+      "Format: Marked, Start, End, Style, Actor, MarginL, MarginR, MarginV, "
+      "Effect, Text\n"
+      "Dialogue: Marked=0,0:00:01.00,0:00:02.00,Default,Bob,0000,0000,0000,,"
+      "Windows line\\Nbreaks\n";
+  Glib::ustring::size_type pos = 0;
+  while ((pos = crlf.find('\n', pos)) != Glib::ustring::npos) {
+    crlf.replace(pos, 1, "\r\n");
+    pos += 2;
+  }
+  corpus.push_back(crlf);
+
+  corpus.push_back(benchmark_ass(1000));
+  return corpus;
+}
+
+// The margins of the events are saved with 4 digits ("0" -> "0000").
+static bool is_same(const Glib::ustring &key, const Glib::ustring &a,
+                    const Glib::ustring &b) {
+  if (key.find("margin") == 0)
+    return utility::string_to_int(a) == utility::string_to_int(b);
+  return a == b;
+}
+
+// Return a message for the first difference or an empty string.
+static Glib::ustring compare(const Glib::ustring &what,
+                             std::map<Glib::ustring, Glib::ustring> &a,
+                             std::map<Glib::ustring, Glib::ustring> &b) {
+  for (const auto &value : a) {
+    if (!is_same(value.first, value.second, b[value.first]))
+      return Glib::ustring::compose("%1 %2: '%3' != '%4'", what, value.first,
+                                    value.second, b[value.first]);
+  }
+  return Glib::ustring();
+}
+
+static Glib::ustring compare(Document *a, Document *b) {
+  // The saved script info can have more keys (PlayRes)
+  Glib::ustring diff = compare("script info", a->get_script_info().data,
+                               b->get_script_info().data);
+  if (!diff.empty())
+    return diff;
+
+  if (a->styles().size() != b->styles().size())
+    return Glib::ustring::compose("%1 != %2 styles", a->styles().size(),
+                                  b->styles().size());
+  for (unsigned int i = 0; i < a->styles().size(); ++i) {
+    std::map<Glib::ustring, Glib::ustring> va, vb;
+    a->styles().get(i).get(va);
+    b->styles().get(i).get(vb);
+    diff = compare("style", va, vb);
+    if (!diff.empty())
+      return diff;
+  }
+
+  if (a->subtitles().size() != b->subtitles().size())
+    return Glib::ustring::compose("%1 != %2 subtitles", a->subtitles().size(),
+                                  b->subtitles().size());
+  Subtitle sa = a->subtitles().get_first();
+  Subtitle sb = b->subtitles().get_first();
+  for (; sa && sb; ++sa, ++sb) {
+    std::map<Glib::ustring, Glib::ustring> va, vb;
+    sa.get(va);
+    sb.get(vb);
+    diff = compare("subtitle", va, vb);
+    if (!diff.empty())
+      return diff;
+  }
+  return Glib::ustring();
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("check-ass");
+
+  std::vector<Glib::ustring> corpus;
+  std::vector<Glib::ustring> names;
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      corpus.push_back(Glib::file_get_contents(argv[i]));
+      names.push_back(argv[i]);
+    }
+  } else {
+    corpus = create_corpus();
+    for (guint i = 0; i < corpus.size(); ++i) {
+      names.push_back(Glib::ustring::compose("corpus %1", i + 1));
+    }
+  }
+
+  int failures = 0;
+  for (guint i = 0; i < corpus.size(); ++i) {
+    std::unique_ptr<Document> doc(new Document());
+    std::unique_ptr<Document> reopened(new Document());
+    Glib::ustring diff;
+    try {
+      SubtitleFormatSystem::instance().open_from_data(doc.get(), corpus[i],
+                                                      ASS);
+      Glib::ustring saved;
+      SubtitleFormatSystem::instance().save_to_data(doc.get(), saved, ASS);
+      SubtitleFormatSystem::instance().open_from_data(reopened.get(), saved,
+                                                      ASS);
+      if (doc->subtitles().size() == 0)
+        diff = "no subtitle";
+      else
+        diff = compare(doc.get(), reopened.get());
+    } catch (const std::exception &ex) {
+      diff = ex.what();
+    } catch (const Glib::Error &ex) {
+      diff = ex.what();
+    }
+
+    if (diff.empty()) {
+      std::cout << names[i] << ": ok (" << doc->subtitles().size()
+                << " subtitles)" << std::endl;
+    } else {
+      std::cerr << names[i] << ": " << diff << std::endl;
+      ++failures;
+    }
+  }
+
+  benchmark_exit();
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
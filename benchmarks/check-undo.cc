@@ -0,0 +1,116 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// check-undo [COUNT]
+// Undo history written in the spill file: with a limit of 1 MiB, a document
+// of COUNT subtitles (5000 by default) is edited several times (texts and
+// removed subtitles), the oldest undo entries are spilled. Each entry is
+// undone, the memory counted by the command system must be the sum of the
+// entries in memory and the document must come back to its first state.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "benchmark.h"
+#include "cfg.h"
+#include "document.h"
+#include "subtitleformatsystem.h"
+
+// The spilled edits stay below the limit of the spill file (4 MiB), no
+// entry is deleted.
+static const int EDITS = 4;
+
+static std::vector<Glib::ustring> get_texts(Document *doc) {
+  std::vector<Glib::ustring> texts;
+  for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+    texts.push_back(sub.get_text());
+  }
+  return texts;
+}
+
+// Return a message if the counted memory is not the sum of the entries.
+static Glib::ustring check_memory(Document *doc, const Glib::ustring &when) {
+  CommandSystem &commands = doc->get_command_system();
+  gsize counted = commands.get_undo_memory();
+  gsize computed = commands.compute_undo_memory();
+  if (counted == computed)
+    return Glib::ustring();
+  return Glib::ustring::compose("%1: %2 bytes counted, %3 bytes in memory",
+                                when, counted, computed);
+}
+
+int main(int argc, char *argv[]) {
+  benchmark_init("check-undo");
+
+  guint count = benchmark_count(argc, argv, 5000);
+
+  cfg::set_int("interface", "max-undo", 0);
+  cfg::set_int("interface", "max-undo-memory", 1);
+
+  std::unique_ptr<Document> doc(new Document());
+  SubtitleFormatSystem::instance().open_from_data(
+      doc.get(), benchmark_subrip(count), "SubRip");
+  std::vector<Glib::ustring> texts = get_texts(doc.get());
+
+  Glib::ustring error;
+  for (int edit = 0; edit < EDITS && error.empty(); ++edit) {
+    // a different description, the groups are not merged
+    doc->start_command(Glib::ustring::compose("Edit %1", edit));
+    if (edit % 3 == 2) {
+      std::vector<Subtitle> removed;
+      for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+        if (sub.get_num() % 2 == 0)
+          removed.push_back(sub);
+      }
+      doc->subtitles().remove(removed);
+    } else {
+      for (Subtitle sub = doc->subtitles().get_first(); sub; ++sub) {
+        sub.set_text(Glib::ustring::compose("Edit %1: %2", edit,
+                                            sub.get_text()));
+      }
+    }
+    doc->finish_command();
+    error = check_memory(doc.get(), Glib::ustring::compose("edit %1", edit));
+  }
+
+  // the oldest entries are spilled
+  if (error.empty() &&
+      doc->get_command_system().get_undo_memory() > 1024 * 1024)
+    error = "The undo history is not written in the spill file";
+
+  for (int edit = EDITS - 1; edit >= 0 && error.empty(); --edit) {
+    doc->get_command_system().undo();
+    error = check_memory(doc.get(), Glib::ustring::compose("undo %1", edit));
+  }
+
+  if (error.empty() && get_texts(doc.get()) != texts)
+    error = "The document is not restored by the undo";
+
+  doc.reset();
+  benchmark_exit();
+
+  if (!error.empty()) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "undo of " << EDITS << " edits of " << count
+            << " subtitles: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -240,17 +240,22 @@ class ChangeFrameratePlugin : public Action {
 
     doc->start_command(_("Change Framerate"));
 
-    Subtitles subtitles = doc->subtitles();
+    {
+      DocumentBulkEdit bulk(doc);
 
-    Subtitle subtitle = subtitles.get_first();
+      Subtitles subtitles = doc->subtitles();
 
-    while (subtitle) {
-      SubtitleTime start = change_fps(subtitle.get_start(), src_fps, dest_fps);
-      SubtitleTime end = change_fps(subtitle.get_end(), src_fps, dest_fps);
+      Subtitle subtitle = subtitles.get_first();
 
-      subtitle.set_start_and_end(start, end);
+      while (subtitle) {
+        SubtitleTime start =
+            change_fps(subtitle.get_start(), src_fps, dest_fps);
+        SubtitleTime end = change_fps(subtitle.get_end(), src_fps, dest_fps);
 
-      ++subtitle;
+        subtitle.set_start_and_end(start, end);
+
+        ++subtitle;
+      }
     }
 
     doc->emit_signal("subtitle-time-changed");
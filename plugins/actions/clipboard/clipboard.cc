@@ -591,7 +591,7 @@ class ClipboardPlugin : public Action {
     // FIXME tomas-kitone: this is a clumsy implementation.
     // I think we should add a show_subtitle( Subtitle &sub ) function to class
     // SubtitleView or at least get_iter() or get_path() to class Subtitle
-    SubtitleView *view = reinterpret_cast<SubtitleView *>(doc->widget());
+    SubtitleView *view = dynamic_cast<SubtitleView *>(doc->get_view());
     if (view != NULL) {
       int sub_num = new_subtitles[0].get_num() - 1;
       Gtk::TreeModel::Path sub_path =
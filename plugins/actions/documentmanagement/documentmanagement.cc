@@ -309,13 +309,9 @@ class DocumentManagementPlugin : public Action {
       already->flash_message(_("I am already open"));
       return false;
     }
-    // Don't need to catch error, create_from_file catch and
-    // display errors messages if needs.
-    Document *doc = Document::create_from_file(uri, charset);
-    if (!doc)
-      return false;
-
-    se::documents::append(doc);
+    // Opened by a thread, the document is added to se::documents when it's
+    // ready. The errors messages are displayed if needs.
+    get_subtitleeditor_window()->open_documents({uri}, charset);
     return true;
   }
 
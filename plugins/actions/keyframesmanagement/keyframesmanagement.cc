@@ -21,6 +21,7 @@
 #include <extension/action.h>
 #include <gui/dialogfilechooser.h>
 #include <keyframes.h>
+#include <mediacache.h>
 #include <player.h>
 #include <utility.h>
 
@@ -187,13 +188,15 @@ class KeyframesManagementPlugin : public Action {
     // don't update if is playing or paused
     if (msg == Player::STREAM_READY || msg == Player::STATE_NONE)
       update_ui();
+    if (msg == Player::STREAM_READY)
+      open_from_cache_for_player();
     else if (msg == Player::KEYFRAME_CHANGED)
       on_keyframes_changed();
   }
 
   void on_keyframes_changed() {
     Glib::RefPtr<KeyFrames> kf = player()->get_keyframes();
-    if (kf)
+    if (kf && !media_cache::contains(kf->get_uri()))
       add_in_recent_manager(kf->get_uri());
     update_ui();
   }
@@ -241,12 +244,18 @@ class KeyframesManagementPlugin : public Action {
       ui.hide();
       Glib::RefPtr<KeyFrames> kf = KeyFrames::create_from_file(ui.get_uri());
       if (!kf)
+        kf = open_from_cache(ui.get_uri());
+      if (!kf) {
         // FIXME: until old code is FIXED, use by default the frame method
         kf = generate_keyframes_from_file_using_frame(ui.get_uri());
+        if (kf)
+          store_in_cache(kf, "kf-frame");
+      }
 
       if (kf) {
         player()->set_keyframes(kf);
-        add_in_recent_manager(kf->get_uri());
+        if (!media_cache::contains(kf->get_uri()))
+          add_in_recent_manager(kf->get_uri());
       }
     }
   }
@@ -326,15 +335,72 @@ class KeyframesManagementPlugin : public Action {
     }
   }
 
+  // The keyframes of each generation method have their own entry in the
+  // cache: "kf" (generate) and "kf-frame" (generate using frame).
+
+  // Return the keyframes of the media from the cache entry ext or NULL.
+  Glib::RefPtr<KeyFrames> open_from_cache(const Glib::ustring &media_uri,
+                                          const Glib::ustring &ext) {
+    Glib::ustring uri = media_cache::lookup(media_uri, ext);
+    if (uri.empty())
+      return Glib::RefPtr<KeyFrames>(NULL);
+    return KeyFrames::create_from_file(uri);
+  }
+
+  // Return the keyframes of the media from the cache, whatever the method,
+  // or NULL.
+  Glib::RefPtr<KeyFrames> open_from_cache(const Glib::ustring &media_uri) {
+    Glib::RefPtr<KeyFrames> kf = open_from_cache(media_uri, "kf");
+    if (!kf)
+      kf = open_from_cache(media_uri, "kf-frame");
+    return kf;
+  }
+
+  // The player opens a media, use the keyframes of the cache if the current
+  // ones are for another media.
+  void open_from_cache_for_player() {
+    Glib::ustring uri = player()->get_uri();
+    if (uri.empty())
+      return;
+
+    Glib::RefPtr<KeyFrames> current = player()->get_keyframes();
+    if (current && current->get_video_uri() == uri)
+      return;
+
+    Glib::RefPtr<KeyFrames> kf = open_from_cache(uri);
+    if (kf)
+      player()->set_keyframes(kf);
+  }
+
+  // Write the keyframes in the cache entry ext and trim it.
+  // Return false if the cache is disabled or on error.
+  bool store_in_cache(const Glib::RefPtr<KeyFrames> &kf,
+                      const Glib::ustring &ext) {
+    Glib::ustring uri = media_cache::get_store_uri(kf->get_video_uri(), ext);
+    if (uri.empty() || !kf->save(uri))
+      return false;
+
+    media_cache::trim();
+    return true;
+  }
+
   void on_generate() {
     Glib::ustring uri = get_subtitleeditor_window()->get_player()->get_uri();
     if (uri.empty())
       return;
 
-    Glib::RefPtr<KeyFrames> kf = generate_keyframes_from_file(uri);
+    Glib::RefPtr<KeyFrames> kf = open_from_cache(uri, "kf");
+    if (kf) {
+      player()->set_keyframes(kf);
+      return;
+    }
+
+    kf = generate_keyframes_from_file(uri);
     if (kf) {
       player()->set_keyframes(kf);
-      on_save();
+      // Kept in the cache, otherwise ask where to save it
+      if (!store_in_cache(kf, "kf"))
+        on_save();
     }
   }
 
@@ -343,10 +409,18 @@ class KeyframesManagementPlugin : public Action {
     if (uri.empty())
       return;
 
-    Glib::RefPtr<KeyFrames> kf = generate_keyframes_from_file_using_frame(uri);
+    Glib::RefPtr<KeyFrames> kf = open_from_cache(uri, "kf-frame");
+    if (kf) {
+      player()->set_keyframes(kf);
+      return;
+    }
+
+    kf = generate_keyframes_from_file_using_frame(uri);
     if (kf) {
       player()->set_keyframes(kf);
-      on_save();
+      // Kept in the cache, otherwise ask where to save it
+      if (!store_in_cache(kf, "kf-frame"))
+        on_save();
     }
   }
 
@@ -186,6 +186,8 @@ class MoveSubtitlesPlugin : public Action {
     if (selection.empty())
       return false;
 
+    DocumentBulkEdit bulk(doc);
+
     if (doc->get_edit_timing_mode() == TIME) {
       SubtitleTime time(diff);
 
@@ -211,6 +213,8 @@ class MoveSubtitlesPlugin : public Action {
     if (selection.empty())
       return false;
 
+    DocumentBulkEdit bulk(doc);
+
     if (doc->get_edit_timing_mode() == TIME) {
       SubtitleTime time(diff);
 
@@ -32,6 +32,7 @@ class InterfacePage : public PreferencePage {
     init_widget(xml, "check-ask-to-save-on-exit", "interface",
                 "ask-to-save-on-exit");
     init_widget(xml, "spin-max-undo", "interface", "max-undo");
+    init_widget(xml, "spin-max-undo-memory", "interface", "max-undo-memory");
 
     init_widget(xml, "check-center-subtitle", "subtitle-view",
                 "property-alignment-center");
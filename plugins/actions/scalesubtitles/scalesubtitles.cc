@@ -103,7 +103,11 @@ class DialogScaleSubtitles : public Gtk::Dialog {
         }
 
         // Apply the scale
-        scale_range(timing_mode, subbegin, subend, src1, dest1, src2, dest2);
+        {
+          DocumentBulkEdit bulk(doc);
+          scale_range(timing_mode, subbegin, subend, src1, dest1, src2,
+                      dest2);
+        }
 
         doc->emit_signal("subtitle-time-changed");
         doc->finish_command();
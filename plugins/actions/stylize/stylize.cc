@@ -162,7 +162,7 @@ class StylizeSelectedSubtitlesPlugin : public Action {
 
     doc->start_command(_("Set style to selection"));
     for (guint i = 0; i < selection.size(); ++i)
-      selection[i].set("style", name);
+      selection[i].set_style(name);
     doc->finish_command();
   }
 
@@ -20,6 +20,7 @@
 
 #include <extension/action.h>
 #include <gtkmm_utility.h>
+#include <subtitleview.h>
 #include <utility.h>
 #include <memory>
 
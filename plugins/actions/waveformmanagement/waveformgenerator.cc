@@ -18,183 +18,319 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <gst/app/gstappsink.h>
+#include <gst/audio/audio.h>
 #include <gstreamermm.h>
-#include <gtkmm.h>
+#include <math.h>
 #include <utility.h>
-#include <waveform.h>
-#include <iomanip>
-#include <iostream>
-#include "mediadecoder.h"
-
-class WaveformGenerator : public Gtk::Dialog, public MediaDecoder {
- public:
-  WaveformGenerator(const Glib::ustring &uri, Glib::RefPtr<Waveform> &wf)
-      : Gtk::Dialog(_("Generate Waveform"), true),
-        MediaDecoder(1000),
-        m_duration(GST_CLOCK_TIME_NONE),
-        m_n_channels(0) {
-    se_dbg_msg(SE_DBG_PLUGINS, "uri=%s", uri.c_str());
-
-    set_border_width(12);
-    set_default_size(300, -1);
-    get_vbox()->pack_start(m_progressbar, false, false);
-    add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
-    m_progressbar.set_text(_("Waiting..."));
-    show_all();
-
-    try {
-      create_pipeline(uri);
-
-      if (run() == Gtk::RESPONSE_OK) {
-        wf = Glib::RefPtr<Waveform>(new Waveform);
-        wf->m_duration = m_duration / GST_MSECOND;
-        wf->m_n_channels = m_n_channels;
-        for (guint i = 0; i < m_n_channels; ++i)
-          wf->m_channels[i] =
-              std::vector<double>(m_values[i].begin(), m_values[i].end());
-        wf->m_video_uri = uri;
-      }
-    } catch (const std::runtime_error &ex) {
-      std::cerr << ex.what() << std::endl;
-    }
-  }
+#include <algorithm>
+#include "waveformgenerator.h"
+
+// The interval of a peak in msecs (the default interval of the old "level"
+// element, the waveforms keep the same resolution).
+#define PEAK_INTERVAL 100
 
-  // Create audio bin
-  Glib::RefPtr<Gst::Element> create_element(
-      const Glib::ustring &structure_name) {
-    se_dbg_msg(SE_DBG_PLUGINS, "structure_name=%s", structure_name.c_str());
-    try {
-      // We only need and want create the video sink
-      if (structure_name.find("audio") == Glib::ustring::npos)
-        return Glib::RefPtr<Gst::Element>(NULL);
-
-      Glib::RefPtr<Gst::Bin> audiobin = Glib::RefPtr<Gst::Bin>::cast_dynamic(
-          Gst::Parse::create_bin("audioconvert ! "
-                                 // "audioresample ! "
-                                 // "audio/x-raw-float, channels=1 ! "
-                                 "level name=level ! "
-                                 "fakesink name=asink",
-                                 true));
-      // Set the new sink tp READY as well
-      Gst::StateChangeReturn retst = audiobin->set_state(Gst::STATE_READY);
-      if (retst == Gst::STATE_CHANGE_FAILURE)
-        std::cerr << "Could not change state of new sink: " << retst
-                  << std::endl;
-
-      return Glib::RefPtr<Gst::Element>::cast_dynamic(audiobin);
-    } catch (std::runtime_error &ex) {
-      se_dbg_msg(SE_DBG_PLUGINS, "runtime_error=%s", ex.what());
-      std::cerr << "create_audio_bin: " << ex.what() << std::endl;
+// Add the squares of the channels [first, first + n) of the interleaved
+// frames to sums. Each channel is summed with four independent accumulators,
+// the loop has no dependency between the iterations and can be vectorized.
+static void add_squares(const float *data, gsize n_frames, guint stride,
+                        guint first, guint n, double *sums) {
+  for (guint c = 0; c < n; ++c) {
+    const float *src = data + first + c;
+    float a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    gsize i = 0;
+    for (; i + 4 <= n_frames; i += 4, src += 4 * stride) {
+      a0 += src[0] * src[0];
+      a1 += src[stride] * src[stride];
+      a2 += src[2 * stride] * src[2 * stride];
+      a3 += src[3 * stride] * src[3 * stride];
     }
-    return Glib::RefPtr<Gst::Element>(NULL);
+    for (; i < n_frames; ++i, src += stride) a0 += src[0] * src[0];
+
+    sums[c] += static_cast<double>(a0) + a1 + a2 + a3;
   }
+}
 
-  // BUS MESSAGE
-  bool on_bus_message(const Glib::RefPtr<Gst::Bus> &bus,
-                      const Glib::RefPtr<Gst::Message> &msg) {
-    MediaDecoder::on_bus_message(bus, msg);
+WaveformGenerator::WaveformGenerator(const Glib::ustring &uri)
+    : MediaDecoder(500), m_uri(uri), m_waveform(new Waveform) {
+  se_dbg_msg(SE_DBG_PLUGINS, "uri=%s", uri.c_str());
+}
 
-    if (msg->get_message_type() == Gst::MESSAGE_ELEMENT) {
-      if (msg->get_structure().get_name() == "level")
-        return on_bus_message_element_level(msg);
-    }
-    return true;
+// Stop the pipeline and wait the end of the worker.
+WaveformGenerator::~WaveformGenerator() {
+  join_worker(true);
+}
+
+Glib::ustring WaveformGenerator::get_uri() const {
+  return m_uri;
+}
+
+// Start the decoding.
+void WaveformGenerator::start() {
+  try {
+    create_pipeline(m_uri);
+  } catch (const std::runtime_error &ex) {
+    std::cerr << ex.what() << std::endl;
   }
+}
 
-  // Update the progress bar
-  bool on_timeout() {
-    se_dbg(SE_DBG_PLUGINS);
+Glib::RefPtr<Waveform> WaveformGenerator::get_waveform() {
+  return m_waveform;
+}
 
-    if (!m_pipeline)
-      return false;
+bool WaveformGenerator::is_finished() const {
+  return m_finished;
+}
 
-    Gst::Format fmt = Gst::FORMAT_TIME;
-    gint64 pos = 0, len = 0;
-    if (m_pipeline->query_position(fmt, pos) &&
-        m_pipeline->query_duration(fmt, len)) {
-      double percent = static_cast<double>(pos) / static_cast<double>(len);
+sigc::signal<void> &WaveformGenerator::signal_progress() {
+  return m_signal_progress;
+}
 
-      percent = CLAMP(percent, 0.0, 1.0);
+sigc::signal<void, bool> &WaveformGenerator::signal_finished() {
+  return m_signal_finished;
+}
 
-      m_progressbar.set_fraction(percent);
-      m_progressbar.set_text(time_to_string(pos) + " / " + time_to_string(len));
+// Create audio bin
+Glib::RefPtr<Gst::Element> WaveformGenerator::create_element(
+    const Glib::ustring &structure_name) {
+  se_dbg_msg(SE_DBG_PLUGINS, "structure_name=%s", structure_name.c_str());
+  try {
+    // We only need and want create the audio sink (the first one)
+    if (structure_name.find("audio") == Glib::ustring::npos || m_appsink)
+      return Glib::RefPtr<Gst::Element>(NULL);
 
-      return pos != len;
-    }
+    // Native float samples, not synchronized on the clock: the stream is
+    // decoded as fast as possible
+    Glib::ustring description = Glib::ustring::compose(
+        "audioconvert ! "
+        "audio/x-raw, format=%1, layout=interleaved ! "
+        "appsink name=asink sync=false max-buffers=64",
+        GST_AUDIO_NE(F32));
+
+    Glib::RefPtr<Gst::Bin> audiobin = Glib::RefPtr<Gst::Bin>::cast_dynamic(
+        Gst::Parse::create_bin(description, true));
+
+    m_appsink = audiobin->get_element("asink");
 
-    return true;
+    // Set the new sink tp READY as well
+    Gst::StateChangeReturn retst = audiobin->set_state(Gst::STATE_READY);
+    if (retst == Gst::STATE_CHANGE_FAILURE)
+      std::cerr << "Could not change state of new sink: " << retst
+                << std::endl;
+
+    return Glib::RefPtr<Gst::Element>::cast_dynamic(audiobin);
+  } catch (std::runtime_error &ex) {
+    se_dbg_msg(SE_DBG_PLUGINS, "runtime_error=%s", ex.what());
+    std::cerr << "create_audio_bin: " << ex.what() << std::endl;
+  }
+  return Glib::RefPtr<Gst::Element>(NULL);
+}
+
+// Start the worker when the appsink is linked and PAUSED.
+void WaveformGenerator::on_pad_added(const Glib::RefPtr<Gst::Pad> &newpad) {
+  MediaDecoder::on_pad_added(newpad);
+
+  if (m_appsink && m_thread == nullptr) {
+    m_thread = Glib::Threads::Thread::create(
+        sigc::mem_fun(*this, &WaveformGenerator::run_worker));
   }
+}
+
+// Publish the new peaks.
+bool WaveformGenerator::on_timeout() {
+  se_dbg(SE_DBG_PLUGINS);
+
+  if (!m_pipeline)
+    return false;
+
+  publish();
+  return true;
+}
+
+void WaveformGenerator::on_work_finished() {
+  se_dbg(SE_DBG_PLUGINS);
+
+  if (m_finished)
+    return;
+
+  // The stream is at the end, the worker returns when the appsink is empty
+  join_worker(false);
+  publish();
+
+  // set duration to position at eos
+  Gst::Format fmt = Gst::FORMAT_TIME;
+  gint64 pos = 0;
+
+  if (m_pipeline && m_pipeline->query_position(fmt, pos))
+    m_waveform->m_duration = pos / GST_MSECOND;
+
+  destroy_pipeline();
+
+  finish(m_waveform->get_n_channels() > 0);
+}
+
+void WaveformGenerator::on_work_cancel() {
+  se_dbg(SE_DBG_PLUGINS);
 
-  bool on_bus_message_element_level(Glib::RefPtr<Gst::Message> msg) {
-    se_dbg_msg(SE_DBG_PLUGINS, "type='%s' name='%s'",
-               GST_MESSAGE_TYPE_NAME(msg->gobj()),
-               GST_OBJECT_NAME(GST_MESSAGE_SRC(msg->gobj())));
-
-    Gst::Structure structure = msg->get_structure();
-    const GValue *array_val =
-        gst_structure_get_value(GST_STRUCTURE(structure.gobj()), "rms");
-    GValueArray *rms_arr =
-        static_cast<GValueArray *>(g_value_get_boxed(array_val));
-
-    gint num_channels = rms_arr->n_values;
-
-    guint first_channel, last_channel;
-    if (num_channels >= 6) {
-      first_channel = 1;
-      last_channel = 3;
-    } else if (num_channels == 5) {
-      first_channel = 1;
-      last_channel = 2;
-    } else if (num_channels == 2) {
-      first_channel = 0;
-      last_channel = 1;
-    } else {
-      first_channel = last_channel = 0;
+  if (m_finished)
+    return;
+
+  join_worker(true);
+  destroy_pipeline();
+
+  finish(false);
+}
+
+// Set the state and emit signal_finished.
+void WaveformGenerator::finish(bool complete) {
+  if (complete)
+    m_waveform->set_complete();
+
+  m_finished = true;
+  m_signal_finished.emit(complete);
+}
+
+// Give the new peaks of the worker to the waveform (main loop).
+// The waveform is initialized with the first peaks: the channels and the
+// duration of the stream, all the timeline is pending.
+void WaveformGenerator::publish() {
+  {
+    Glib::Threads::Mutex::Lock lock(m_mutex);
+
+    if (m_n_channels == 0 || m_values[0].empty())
+      return;
+
+    gint64 interval = PEAK_INTERVAL * GST_MSECOND;
+
+    if (m_waveform->get_n_channels() == 0) {
+      m_waveform->m_video_uri = m_uri;
+      m_waveform->m_n_channels = m_n_channels;
+      m_waveform->m_duration = m_stream_duration / GST_MSECOND;
+      m_waveform->set_pending((m_stream_duration + interval - 1) / interval);
     }
-    // build the number of channels
-    m_n_channels = last_channel - first_channel + 1;
-
-    // get peak from channels
-    for (guint c = first_channel, i = 0; c <= last_channel; ++c, ++i) {
-      double peak =
-          pow(10, g_value_get_double(g_value_array_get_nth(rms_arr, c)) / 20);
-      m_values[i].push_back(peak);
+
+    for (guint i = 0; i < m_n_channels; ++i) {
+      m_waveform->append_channel(i, m_values[i].data(), m_values[i].size());
+      m_values[i].clear();
     }
-    return true;
   }
 
-  void on_work_finished() {
-    se_dbg(SE_DBG_PLUGINS);
+  // Unknown duration, the timeline grows with the peaks
+  if (m_waveform->get_size() == m_waveform->get_ready_size()) {
+    m_waveform->m_duration =
+        std::max<gint64>(m_waveform->m_duration,
+                         m_waveform->get_ready_size() * PEAK_INTERVAL);
+  }
 
-    // set duration to position at eos
-    Gst::Format fmt = Gst::FORMAT_TIME;
-    gint64 pos = 0;
+  m_signal_progress.emit();
+}
 
-    if (m_pipeline && m_pipeline->query_position(fmt, pos)) {
-      m_duration = pos;
-      response(Gtk::RESPONSE_OK);
-    } else {
-      GST_ELEMENT_ERROR(
-          m_pipeline->gobj(), STREAM, FAILED,
-          (_("Could not determinate the duration of the stream.")), (NULL));
-    }
+// Wait for the end of the worker. With cancel the pipeline is stopped
+// first (no more pad-added), the appsink is flushed and the worker
+// returns. Otherwise the stream is at the end, the worker returns when
+// the appsink is empty.
+void WaveformGenerator::join_worker(bool cancel) {
+  if (cancel && m_pipeline)
+    m_pipeline->set_state(Gst::STATE_NULL);
+
+  if (m_thread == nullptr)
+    return;
+
+  m_thread->join();
+  m_thread = nullptr;
+}
+
+// The worker thread: pull the samples until the end of the stream (or
+// the pipeline is stopped).
+void WaveformGenerator::run_worker() {
+  se_dbg(SE_DBG_PLUGINS);
+
+  GstAppSink *appsink = GST_APP_SINK(m_appsink->gobj());
+
+  GstSample *sample = nullptr;
+  while ((sample = gst_app_sink_pull_sample(appsink)) != nullptr) {
+    process_sample(sample);
+    gst_sample_unref(sample);
   }
 
-  void on_work_cancel() {
-    se_dbg(SE_DBG_PLUGINS);
+  // The last interval
+  if (m_bucket_filled > 0)
+    push_bucket();
+
+  se_dbg_msg(SE_DBG_PLUGINS, "end of the worker");
+}
+
+// Setup the channels from the format of the first sample.
+bool WaveformGenerator::setup(GstSample *sample) {
+  GstAudioInfo info;
+  if (!gst_audio_info_from_caps(&info, gst_sample_get_caps(sample)))
+    return false;
+
+  m_stride = GST_AUDIO_INFO_CHANNELS(&info);
+  m_bucket_frames =
+      std::max(1, GST_AUDIO_INFO_RATE(&info) * PEAK_INTERVAL / 1000);
 
-    response(Gtk::RESPONSE_CANCEL);
+  guint n_channels = 1;
+  if (m_stride >= 6) {
+    m_first_channel = 1;
+    n_channels = 3;
+  } else if (m_stride == 5) {
+    m_first_channel = 1;
+    n_channels = 2;
+  } else if (m_stride == 2) {
+    m_first_channel = 0;
+    n_channels = 2;
+  } else {
+    m_first_channel = 0;
   }
 
- protected:
-  Gtk::ProgressBar m_progressbar;
-  guint64 m_duration;
-  guint m_n_channels;
-  std::list<gdouble> m_values[3];
-};
-
-Glib::RefPtr<Waveform> generate_waveform_from_file(const Glib::ustring &uri) {
-  Glib::RefPtr<Waveform> wf;
-  WaveformGenerator ui(uri, wf);
-  return wf;
+  gint64 len = 0;
+  if (!gst_element_query_duration(m_appsink->gobj(), GST_FORMAT_TIME, &len) ||
+      len < 0)
+    len = 0;
+
+  Glib::Threads::Mutex::Lock lock(m_mutex);
+  m_n_channels = n_channels;
+  m_stream_duration = len;
+  return true;
+}
+
+// Add the samples of the buffer to the intervals.
+void WaveformGenerator::process_sample(GstSample *sample) {
+  if (m_stride == 0 && !setup(sample))
+    return;
+
+  GstBuffer *buffer = gst_sample_get_buffer(sample);
+  GstMapInfo map;
+  if (buffer == nullptr || !gst_buffer_map(buffer, &map, GST_MAP_READ))
+    return;
+
+  const float *data = reinterpret_cast<const float *>(map.data);
+  gsize n_frames = map.size / (sizeof(float) * m_stride);
+
+  for (gsize pos = 0; pos < n_frames;) {
+    gsize count =
+        std::min<gsize>(n_frames - pos, m_bucket_frames - m_bucket_filled);
+
+    add_squares(data + pos * m_stride, count, m_stride, m_first_channel,
+                m_n_channels, m_sums);
+
+    pos += count;
+    m_bucket_filled += count;
+    if (m_bucket_filled == m_bucket_frames)
+      push_bucket();
+  }
+
+  gst_buffer_unmap(buffer, &map);
+}
+
+// Add the RMS of the current interval to the peaks.
+void WaveformGenerator::push_bucket() {
+  Glib::Threads::Mutex::Lock lock(m_mutex);
+
+  for (guint i = 0; i < m_n_channels; ++i) {
+    m_values[i].push_back(sqrt(m_sums[i] / m_bucket_filled));
+    m_sums[i] = 0;
+  }
+  m_bucket_filled = 0;
 }
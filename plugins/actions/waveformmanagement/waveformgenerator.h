@@ -0,0 +1,120 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gst/gst.h>
+#include <waveform.h>
+#include <vector>
+#include "mediadecoder.h"
+
+// Generate the waveform of a media progressively.
+// The samples are pulled from an appsink by a worker thread which computes
+// the RMS of each interval. The peaks are published in the waveform by the
+// main loop (signal_progress), it can be displayed and used while the rest
+// of the stream is decoded.
+// ex:
+//   generator->signal_progress().connect(...);
+//   generator->signal_finished().connect(...);
+//   generator->start();
+class WaveformGenerator : public MediaDecoder {
+ public:
+  explicit WaveformGenerator(const Glib::ustring &uri);
+
+  // Stop the pipeline and wait the end of the worker.
+  ~WaveformGenerator();
+
+  Glib::ustring get_uri() const;
+
+  // Start the decoding.
+  void start();
+
+  // The waveform being generated. Its channels and its duration are set by
+  // the first signal_progress.
+  Glib::RefPtr<Waveform> get_waveform();
+
+  // Return true when the generation is done (after signal_finished).
+  bool is_finished() const;
+
+  // Emitted by the main loop when new peaks are published.
+  sigc::signal<void> &signal_progress();
+
+  // Emitted by the main loop at the end, true if the waveform is complete.
+  sigc::signal<void, bool> &signal_finished();
+
+ protected:
+  // Create the audio bin (the first audio stream only).
+  Glib::RefPtr<Gst::Element> create_element(
+      const Glib::ustring &structure_name);
+
+  // Start the worker when the appsink is linked and PAUSED.
+  void on_pad_added(const Glib::RefPtr<Gst::Pad> &newpad);
+
+  // Publish the new peaks.
+  bool on_timeout();
+
+  void on_work_finished();
+
+  void on_work_cancel();
+
+  // Set the state and emit signal_finished.
+  void finish(bool complete);
+
+  // Give the new peaks of the worker to the waveform (main loop).
+  void publish();
+
+  // Wait for the end of the worker.
+  void join_worker(bool cancel);
+
+  // The worker thread.
+  void run_worker();
+
+  // Setup the channels from the format of the first sample.
+  bool setup(GstSample *sample);
+
+  // Add the samples of the buffer to the intervals.
+  void process_sample(GstSample *sample);
+
+  // Add the RMS of the current interval to the peaks.
+  void push_bucket();
+
+ protected:
+  Glib::ustring m_uri;
+  Glib::RefPtr<Waveform> m_waveform;
+  bool m_finished{false};
+  sigc::signal<void> m_signal_progress;
+  sigc::signal<void, bool> m_signal_finished;
+
+  // Shared by the worker and the main loop
+  Glib::Threads::Mutex m_mutex;
+  guint m_n_channels{0};
+  gint64 m_stream_duration{0};
+  // The peaks not yet published
+  std::vector<double> m_values[Waveform::MAX_CHANNELS];
+
+  // The worker, only it uses the values below until join_worker
+  Glib::RefPtr<Gst::Element> m_appsink;
+  Glib::Threads::Thread *m_thread{nullptr};
+  guint m_stride{0};
+  guint m_first_channel{0};
+  gsize m_bucket_frames{0};
+  gsize m_bucket_filled{0};
+  double m_sums[Waveform::MAX_CHANNELS]{0, 0, 0};
+};
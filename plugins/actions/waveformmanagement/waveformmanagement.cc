@@ -21,12 +21,12 @@
 #include <extension/action.h>
 #include <gtkmm.h>
 #include <gui/dialogfilechooser.h>
+#include <mediacache.h>
 #include <player.h>
 #include <utility.h>
 #include <waveformmanager.h>
-
-// Declared in waveformgenerator.cc
-Glib::RefPtr<Waveform> generate_waveform_from_file(const Glib::ustring& uri);
+#include <memory>
+#include "waveformgenerator.h"
 
 class WaveformManagement : public Action {
  public:
@@ -37,6 +37,7 @@ class WaveformManagement : public Action {
   }
 
   ~WaveformManagement() {
+    m_generator.reset();
     deactivate();
   }
 
@@ -237,7 +238,11 @@ class WaveformManagement : public Action {
 
     bool has_document = (get_current_document() != NULL);
 
-    action_group->get_action("waveform/save")->set_sensitive(has_waveform);
+    // The waveform can't be saved while it is generated
+    bool is_complete =
+        has_waveform && get_waveform_manager()->get_waveform()->is_complete();
+
+    action_group->get_action("waveform/save")->set_sensitive(is_complete);
     action_group->get_action("waveform/close")->set_sensitive(has_waveform);
     action_group->get_action("waveform/zoom-in")->set_sensitive(has_waveform);
     action_group->get_action("waveform/zoom-out")->set_sensitive(has_waveform);
@@ -258,8 +263,19 @@ class WaveformManagement : public Action {
 
   void on_waveform_changed() {
     Glib::RefPtr<Waveform> wf = get_waveform_manager()->get_waveform();
-    if (wf)
+    if (wf && !media_cache::contains(wf->get_uri()))
       add_in_recent_manager(wf->get_uri());
+
+    // The waveform being generated was displayed and it's closed or
+    // replaced. Before its first peaks, the generation goes on whatever the
+    // user does with the other waveforms.
+    if (m_generator && !m_generator->is_finished()) {
+      if (wf && m_generator->get_waveform() == wf)
+        m_generator_displayed = true;
+      else if (m_generator_displayed)
+        m_generator.reset();
+    }
+
     update_ui();
   }
 
@@ -274,6 +290,9 @@ class WaveformManagement : public Action {
             ->set_sensitive(has_player_file);
         action_group->get_action("waveform/generate-dummy")
             ->set_sensitive(has_player_file);
+
+        if (msg == Player::STREAM_READY)
+          open_from_cache_for_player();
       } break;
       default:
         break;
@@ -302,13 +321,10 @@ class WaveformManagement : public Action {
         get_waveform_manager()->set_waveform(wf);
         add_in_recent_manager(wf->get_uri());
         update_player_from_waveform();
+      } else if (open_from_cache(uri)) {
+        update_player_from_waveform();
       } else {
-        wf = generate_waveform_from_file(uri);
-        if (wf) {
-          get_waveform_manager()->set_waveform(wf);
-          on_save_waveform();
-          update_player_from_waveform();
-        }
+        generate_waveform(uri);
       }
     }
   }
@@ -317,15 +333,117 @@ class WaveformManagement : public Action {
   void on_generate_from_player_file() {
     Glib::ustring uri = get_subtitleeditor_window()->get_player()->get_uri();
     if (uri.empty() == false) {
-      // get_waveform_manager()->generate_waveform(uri);
-      Glib::RefPtr<Waveform> wf = generate_waveform_from_file(uri);
-      if (wf) {
-        get_waveform_manager()->set_waveform(wf);
-        on_save_waveform();
-      }
+      if (!open_from_cache(uri))
+        generate_waveform(uri);
+    }
+  }
+
+  // Open the waveform of the media from the cache.
+  // Return false if there's no entry.
+  bool open_from_cache(const Glib::ustring& media_uri) {
+    Glib::ustring uri = media_cache::lookup(media_uri, "wf");
+    if (uri.empty())
+      return false;
+
+    Glib::RefPtr<Waveform> wf = Waveform::create_from_file(uri);
+    if (!wf)
+      return false;
+
+    get_waveform_manager()->set_waveform(wf);
+    return true;
+  }
+
+  // The player opens a media, use the waveform of the cache if the current
+  // one is for another media.
+  void open_from_cache_for_player() {
+    Glib::ustring uri = get_subtitleeditor_window()->get_player()->get_uri();
+    if (uri.empty())
+      return;
+
+    Glib::RefPtr<Waveform> wf = get_waveform_manager()->get_waveform();
+    if (wf && wf->get_video_uri() == uri)
+      return;
+
+    if (m_generator && !m_generator->is_finished() &&
+        m_generator->get_uri() == uri)
+      return;
+
+    open_from_cache(uri);
+  }
+
+  // Write the waveform in the cache and trim it.
+  // Return false if the cache is disabled or on error.
+  bool store_in_cache(const Glib::RefPtr<Waveform>& wf) {
+    Glib::ustring uri = media_cache::get_store_uri(wf->get_video_uri(), "wf");
+    if (uri.empty() || !wf->save(uri))
+      return false;
+
+    media_cache::trim();
+    return true;
+  }
+
+  // Start the generation of the waveform of the media (a previous one is
+  // cancelled). The waveform is displayed with the first peaks and updated
+  // until the end, the rest of the timeline is pending.
+  void generate_waveform(const Glib::ustring& uri) {
+    se_dbg_msg(SE_DBG_PLUGINS, "uri=%s", uri.c_str());
+
+    m_generator.reset(new WaveformGenerator(uri));
+    m_generator_displayed = false;
+    m_generator->signal_progress().connect(
+        sigc::mem_fun(*this, &WaveformManagement::on_generator_progress));
+    m_generator->signal_finished().connect(
+        sigc::mem_fun(*this, &WaveformManagement::on_generator_finished));
+    m_generator->start();
+  }
+
+  // New peaks are available.
+  void on_generator_progress() {
+    WaveformManager* wm = get_waveform_manager();
+    Glib::RefPtr<Waveform> wf = m_generator->get_waveform();
+
+    if (wm->get_waveform() == wf) {
+      wm->update_waveform();
+    } else {
+      // The first peaks
+      wm->set_waveform(wf);
+      update_player_from_waveform();
     }
   }
 
+  // The generator is deleted by the main loop, not in its own signal.
+  void on_generator_finished(bool complete) {
+    se_dbg_msg(SE_DBG_PLUGINS, "complete=%d", complete);
+
+    WaveformManager* wm = get_waveform_manager();
+    Glib::RefPtr<Waveform> wf = m_generator->get_waveform();
+
+    Glib::signal_idle().connect_once(
+        sigc::mem_fun(*this, &WaveformManagement::on_generator_done));
+
+    if (!complete) {
+      if (wm->get_waveform() == wf)
+        wm->set_waveform(Glib::RefPtr<Waveform>(NULL));
+      return;
+    }
+
+    if (wm->get_waveform() != wf)
+      wm->set_waveform(wf);
+    else
+      wm->update_waveform();
+
+    update_ui();
+
+    // Kept in the cache, otherwise ask where to save it
+    if (!store_in_cache(wf))
+      on_save_waveform();
+  }
+
+  void on_generator_done() {
+    if (m_generator && m_generator->is_finished())
+      m_generator.reset();
+  }
+
   // Generate an Sine Waveform
   void on_generate_dummy() {
     Player* player = get_subtitleeditor_window()->get_player();
@@ -340,7 +458,7 @@ class WaveformManagement : public Action {
 
     // Create Sine Waveform
     int second = SubtitleTime(0, 0, 1, 0).totalmsecs;
-    wf->m_channels[0].resize(wf->m_duration);
+    std::vector<double> peaks(wf->m_duration);
 
     double freq = (wf->m_duration % second) / 2;
     double amp = 0.5;
@@ -349,8 +467,9 @@ class WaveformManagement : public Action {
 
     for (unsigned int i = 1; i <= wf->m_duration; ++i) {
       double a = amp - (amp * (i % second) * 0.001);
-      wf->m_channels[0][i - 1] = a * sin(rfreq * (i / rate));
+      peaks[i - 1] = a * sin(rfreq * (i / rate));
     }
+    wf->set_channel(0, peaks);
 
     get_waveform_manager()->set_waveform(wf);
   }
@@ -523,6 +642,9 @@ class WaveformManagement : public Action {
  protected:
   Gtk::UIManager::ui_merge_id ui_id;
   Glib::RefPtr<Gtk::ActionGroup> action_group;
+  std::unique_ptr<WaveformGenerator> m_generator;
+  // The waveform of the generator has been displayed
+  bool m_generator_displayed{false};
 };
 
 REGISTER_EXTENSION(WaveformManagement)
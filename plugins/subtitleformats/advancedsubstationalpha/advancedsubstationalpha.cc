@@ -24,8 +24,11 @@
 #include <gtkmm_utility.h>
 #include <utility.h>
 #include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <memory>
+#include <string>
+#include <vector>
 
 class DialogAdvancedSubStationAlphaPreferences : public Gtk::Dialog {
  protected:
@@ -138,163 +141,352 @@ class AdvancedSubStationAlpha : public SubtitleFormatIO {
     }
   }
 
-  void open(Reader &file) {
-    std::vector<Glib::ustring> lines = file.get_lines();
+  // The sections of the file
+  enum Section { SECTION_NONE, SCRIPT_INFO, STYLES, EVENTS, SECTION_OTHER };
+
+  // The columns of [Events] read by subtitleeditor
+  enum EventColumn {
+    EVENT_UNKNOWN = -1,
+    EVENT_LAYER,
+    EVENT_START,
+    EVENT_END,
+    EVENT_STYLE,
+    EVENT_NAME,
+    EVENT_MARGIN_L,
+    EVENT_MARGIN_R,
+    EVENT_MARGIN_V,
+    EVENT_EFFECT,
+    EVENT_TEXT
+  };
+
+  // The columns of [V4+ Styles] and the key of the style
+  enum StyleValue { STYLE_TEXT, STYLE_COLOR, STYLE_BOOL };
 
-    read_script_info(lines);
-    read_styles(lines);
-    read_events(lines);
+  struct StyleColumn {
+    const char *format;
+    const char *key;
+    StyleValue value;
+  };
+
+  static const StyleColumn *get_style_columns() {
+    static const StyleColumn columns[] = {
+        {"Name", "name", STYLE_TEXT},
+        {"Fontname", "font-name", STYLE_TEXT},
+        {"Fontsize", "font-size", STYLE_TEXT},
+        {"PrimaryColour", "primary-color", STYLE_COLOR},
+        {"SecondaryColour", "secondary-color", STYLE_COLOR},
+        {"OutlineColour", "outline-color", STYLE_COLOR},
+        {"TertiaryColour", "outline-color", STYLE_COLOR},
+        {"BackColour", "shadow-color", STYLE_COLOR},
+        {"Bold", "bold", STYLE_BOOL},
+        {"Italic", "italic", STYLE_BOOL},
+        {"Underline", "underline", STYLE_BOOL},
+        {"StrikeOut", "strikeout", STYLE_BOOL},
+        {"ScaleX", "scale-x", STYLE_TEXT},
+        {"ScaleY", "scale-y", STYLE_TEXT},
+        {"Spacing", "spacing", STYLE_TEXT},
+        {"Angle", "angle", STYLE_TEXT},
+        {"BorderStyle", "border-style", STYLE_TEXT},
+        {"Outline", "outline", STYLE_TEXT},
+        {"Shadow", "shadow", STYLE_TEXT},
+        {"Alignment", "alignment", STYLE_TEXT},
+        {"MarginL", "margin-l", STYLE_TEXT},
+        {"MarginR", "margin-r", STYLE_TEXT},
+        {"MarginV", "margin-v", STYLE_TEXT},
+        {"Encoding", "encoding", STYLE_TEXT},
+        {NULL, NULL, STYLE_TEXT}};
+    return columns;
   }
 
-  void save(Writer &file) {
-    write_script_info(file);
-    write_styles(file);
-    write_events(file);
+  static const char *get_styles_format() {
+    return "Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+           "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, "
+           "ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, "
+           "Alignment, MarginL, MarginR, MarginV, Encoding";
   }
 
-  // Read the block [Script Info]
-  void read_script_info(const std::vector<Glib::ustring> &lines) {
-    se_dbg_msg(SE_DBG_IO, "read script info...");
+  static const char *get_events_format() {
+    return "Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+           "Effect, Text";
+  }
 
+  // The file is read in one pass, line by line. The lines of Style and
+  // Dialogue are split on the commas following the order of the Format
+  // line of their section (or the default order).
+  void open(Reader &file) {
     ScriptInfo &script_info = document()->get_script_info();
+    Styles styles = document()->styles();
+    Subtitles subtitles = document()->subtitles();
 
-    Glib::RefPtr<Glib::Regex> re = Glib::Regex::create("^(.*?):\\s(.*?)$");
-    Glib::RefPtr<Glib::Regex> re_block = Glib::Regex::create("^\\[.*\\]$");
-
-    bool read = false;
-
-    for (const auto &line : lines) {
-      // We want to only read the scrip info block
-      if (read) {
-        if (re_block->match(line))
-          return;  // new block, stop reading
-      } else if (line.find("[Script Info]") != Glib::ustring::npos) {
-        // This is the beginning of the script info block, start reading
-        read = true;
-      }
-
-      if (!read)
+    std::vector<int> style_columns = parse_style_format(
+        get_styles_format(), get_styles_format() + strlen(get_styles_format()));
+    std::vector<int> event_columns = parse_event_format(
+        get_events_format(), get_events_format() + strlen(get_events_format()));
+    std::vector<Reader::Line> fields;
+
+    Section section = SECTION_NONE;
+    bool script_info_read = false;
+
+    Reader::Line line;
+    while (file.getline(line)) {
+      const char *begin = line.data;
+      const char *end = line.data + line.size;
+
+      if (is_block(line)) {
+        if (section == SCRIPT_INFO)
+          script_info_read = true;
+        section = get_section(line);
+        if (section == SCRIPT_INFO && script_info_read)
+          section = SECTION_OTHER;
         continue;
-      if (!re->match(line))
-        continue;
-
-      std::vector<Glib::ustring> group = re->split(line);
-
-      if (group.size() == 1)
+      }
+      // The script info block can follow a BOM or some garbage
+      if (section != SCRIPT_INFO && !script_info_read &&
+          g_strstr_len(begin, line.size, "[Script Info]")) {
+        section = SCRIPT_INFO;
         continue;
+      }
 
-      Glib::ustring key = group[1];
-      Glib::ustring value = group[2];
-
-      script_info.data[key] = value;
+      if (section == SCRIPT_INFO) {
+        read_script_info(script_info, begin, end);
+      } else if (skip_prefix(begin, end, "Format:")) {
+        if (section == STYLES)
+          style_columns = parse_style_format(begin, end);
+        else if (section == EVENTS)
+          event_columns = parse_event_format(begin, end);
+      } else if (skip_prefix(begin, end, "Style:")) {
+        if (split_fields(begin, end, style_columns.size(), false, fields))
+          read_style(styles.append(), style_columns, fields);
+      } else if (skip_prefix(begin, end, "Dialogue:")) {
+        if (split_fields(begin, end, event_columns.size(), true, fields))
+          read_event(subtitles.append(), event_columns, fields);
+      }
     }
   }
 
-  // Read the block [V4+ Styles]
-  void read_styles(const std::vector<Glib::ustring> &lines) {
-    se_dbg_msg(SE_DBG_IO, "read style...");
-
-    Styles styles = document()->styles();
-
-    Glib::RefPtr<Glib::Regex> re = Glib::Regex::create(
-        "^Style:\\s*"
-        "([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,"
-        "]*"
-        "),([^,]*),"
-        "([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,]*),([^,"
-        "]*"
-        "),([^,]*),"
-        "([^,]*),([^,]*),([^,]*)$");
-
-    for (const auto &line : lines) {
-      if (!re->match(line))
-        continue;
-
-      std::vector<Glib::ustring> group = re->split(line);
-      if (group.size() == 1)
-        continue;
-
-      Style style = styles.append();
-
-      style.set("name", group[1]);
-
-      style.set("font-name", group[2]);
-      style.set("font-size", group[3]);
-
-      style.set("primary-color", from_ass_color(group[4]));
-      style.set("secondary-color", from_ass_color(group[5]));
-      style.set("outline-color", from_ass_color(group[6]));
-      style.set("shadow-color", from_ass_color(group[7]));
-
-      style.set("bold", from_ass_bool(group[8]));
-      style.set("italic", from_ass_bool(group[9]));
-      style.set("underline", from_ass_bool(group[10]));
-      style.set("strikeout", from_ass_bool(group[11]));
-
-      style.set("scale-x", group[12]);
-      style.set("scale-y", group[13]);
+  void save(Writer &file) {
+    write_script_info(file);
+    write_styles(file);
+    write_events(file);
+  }
 
-      style.set("spacing", group[14]);
-      style.set("angle", group[15]);
+  // A line "[...]", beginning of a block
+  static bool is_block(const Reader::Line &line) {
+    return line.size >= 2 && line.data[0] == '[' &&
+           line.data[line.size - 1] == ']';
+  }
 
-      style.set("border-style", group[16]);
-      style.set("outline", group[17]);
-      style.set("shadow", group[18]);
+  static Section get_section(const Reader::Line &line) {
+    std::string name(line.data, line.size);
+    if (name == "[Script Info]")
+      return SCRIPT_INFO;
+    if (name == "[V4+ Styles]" || name == "[V4 Styles]")
+      return STYLES;
+    if (name == "[Events]")
+      return EVENTS;
+    return SECTION_OTHER;
+  }
 
-      style.set("alignment", group[19]);
+  // If the line starts with prefix, move begin after it and the spaces.
+  static bool skip_prefix(const char *&begin, const char *end,
+                          const char *prefix) {
+    gsize size = strlen(prefix);
+    if (static_cast<gsize>(end - begin) < size ||
+        strncmp(begin, prefix, size) != 0)
+      return false;
+    begin += size;
+    while (begin < end && g_ascii_isspace(*begin)) {
+      ++begin;
+    }
+    return true;
+  }
 
-      style.set("margin-l", group[20]);
-      style.set("margin-r", group[21]);
-      style.set("margin-v", group[22]);
+  // Split the line in count fields separated by commas.
+  // If rest is true, the last field takes the rest of the line (text),
+  // otherwise the line must have exactly count fields.
+  static bool split_fields(const char *begin, const char *end, gsize count,
+                           bool rest, std::vector<Reader::Line> &fields) {
+    fields.clear();
+    if (count == 0)
+      return false;
 
-      style.set("encoding", group[23]);
+    const char *p = begin;
+    while (fields.size() + 1 < count) {
+      const char *comma =
+          static_cast<const char *>(memchr(p, ',', end - p));
+      if (comma == NULL)
+        return false;
+      fields.push_back({p, static_cast<gsize>(comma - p)});
+      p = comma + 1;
     }
+    if (!rest && memchr(p, ',', end - p) != NULL)
+      return false;
+    fields.push_back({p, static_cast<gsize>(end - p)});
+    return true;
   }
 
-  // Read the block [Events]
-  void read_events(const std::vector<Glib::ustring> &lines) {
-    se_dbg_msg(SE_DBG_IO, "read events...");
+  // Return the names of a Format line, without spaces.
+  static std::vector<std::string> split_format(const char *begin,
+                                               const char *end) {
+    std::vector<std::string> names;
+    const char *p = begin;
+    for (;;) {
+      const char *comma =
+          static_cast<const char *>(memchr(p, ',', end - p));
+      const char *stop = comma ? comma : end;
+      const char *first = p;
+      const char *last = stop;
+      while (first < last && g_ascii_isspace(*first)) {
+        ++first;
+      }
+      while (last > first && g_ascii_isspace(last[-1])) {
+        --last;
+      }
+      names.push_back(std::string(first, last));
+      if (comma == NULL)
+        break;
+      p = comma + 1;
+    }
+    return names;
+  }
 
-    Subtitles subtitles = document()->subtitles();
+  // Return the index in get_style_columns() of each column (or -1).
+  static std::vector<int> parse_style_format(const char *begin,
+                                             const char *end) {
+    const StyleColumn *columns = get_style_columns();
+    std::vector<int> indexes;
+    for (const auto &name : split_format(begin, end)) {
+      int index = -1;
+      for (int i = 0; columns[i].format != NULL; ++i) {
+        if (g_ascii_strcasecmp(name.c_str(), columns[i].format) == 0) {
+          index = i;
+          break;
+        }
+      }
+      indexes.push_back(index);
+    }
+    return indexes;
+  }
 
-    Glib::RefPtr<Glib::Regex> re = Glib::Regex::create(
-        "^Dialogue:\\s*([^,]*),([^,]*),([^,]*),\\**([^,]*),([^,]*),([^,]*),(["
-        "^,"
-        "]*),([^,]*),([^,]*),(.*)$");
+  // Return the EventColumn of each column.
+  static std::vector<int> parse_event_format(const char *begin,
+                                             const char *end) {
+    static const char *names[] = {"Layer",   "Start",   "End",
+                                  "Style",   "Name",    "MarginL",
+                                  "MarginR", "MarginV", "Effect",
+                                  "Text",    NULL};
+    std::vector<int> columns;
+    for (const auto &name : split_format(begin, end)) {
+      int column = EVENT_UNKNOWN;
+      for (int i = 0; names[i] != NULL; ++i) {
+        if (g_ascii_strcasecmp(name.c_str(), names[i]) == 0) {
+          column = i;
+          break;
+        }
+      }
+      // SSA
+      if (g_ascii_strcasecmp(name.c_str(), "Actor") == 0)
+        column = EVENT_NAME;
+      columns.push_back(column);
+    }
+    return columns;
+  }
 
-    for (const auto &line : lines) {
-      if (!re->match(line))
-        continue;
+  // Read a line "key: value" of the block [Script Info]
+  void read_script_info(ScriptInfo &script_info, const char *begin,
+                        const char *end) {
+    for (const char *p = begin; p + 1 < end; ++p) {
+      if (*p == ':' && g_ascii_isspace(p[1])) {
+        script_info.data[Glib::ustring(begin, p)] = Glib::ustring(p + 2, end);
+        return;
+      }
+    }
+  }
 
-      std::vector<Glib::ustring> group = re->split(line);
-      if (group.size() == 1)
+  // Read a line "Style:" of the block [V4+ Styles]
+  void read_style(Style style, const std::vector<int> &columns,
+                  const std::vector<Reader::Line> &fields) {
+    const StyleColumn *style_columns = get_style_columns();
+    for (gsize i = 0; i < columns.size(); ++i) {
+      if (columns[i] < 0)
         continue;
 
-      Subtitle sub = subtitles.append();
-
-      // start, end times
-      sub.set_start_and_end(from_ass_time(group[2]), from_ass_time(group[3]));
-
-      // style
-      sub.set_style(group[4]);
-
-      // name
-      sub.set_name(group[5]);
+      const StyleColumn &column = style_columns[columns[i]];
+      Glib::ustring value = fields[i].str();
+      if (column.value == STYLE_COLOR)
+        value = from_ass_color(value);
+      else if (column.value == STYLE_BOOL)
+        value = from_ass_bool(value);
 
-      // margin lrv
-      sub.set_margin_l(group[6]);
-      sub.set_margin_r(group[7]);
-      sub.set_margin_v(group[8]);
-
-      // effect
-      sub.set_effect((group[9]));
+      style.set(column.key, value);
+    }
+  }
 
-      // text
-      utility::replace(group[10], "\\n", "\n");
-      utility::replace(group[10], "\\N", "\n");
+  // Read a line "Dialogue:" of the block [Events]
+  void read_event(Subtitle sub, const std::vector<int> &columns,
+                  const std::vector<Reader::Line> &fields) {
+    SubtitleTime start, end;
+    for (gsize i = 0; i < columns.size(); ++i) {
+      const Reader::Line &field = fields[i];
+      switch (columns[i]) {
+        case EVENT_LAYER:
+          sub.set_layer(field.str());
+          break;
+        case EVENT_START:
+          start = from_ass_time(field);
+          break;
+        case EVENT_END:
+          end = from_ass_time(field);
+          break;
+        case EVENT_STYLE: {
+          // Old scripts use "*Default"
+          Reader::Line style = field;
+          while (style.size > 0 && style.data[0] == '*') {
+            ++style.data;
+            --style.size;
+          }
+          sub.set_style(style.str());
+        } break;
+        case EVENT_NAME:
+          sub.set_name(field.str());
+          break;
+        case EVENT_MARGIN_L:
+          sub.set_margin_l(field.str());
+          break;
+        case EVENT_MARGIN_R:
+          sub.set_margin_r(field.str());
+          break;
+        case EVENT_MARGIN_V:
+          sub.set_margin_v(field.str());
+          break;
+        case EVENT_EFFECT:
+          sub.set_effect(field.str());
+          break;
+        case EVENT_TEXT:
+          sub.set_text(from_ass_text(field));
+          break;
+        default:
+          break;
+      }
+    }
+    sub.set_start_and_end(start, end);
+  }
 
-      sub.set_text(group[10]);
+  // Convert the text from ASS to SE, the line breaks \n and \N are replaced
+  // by a newline.
+  static Glib::ustring from_ass_text(const Reader::Line &field) {
+    std::string text;
+    text.reserve(field.size);
+    const char *end = field.data + field.size;
+    for (const char *p = field.data; p < end; ++p) {
+      if (*p == '\\' && p + 1 < end && (p[1] == 'n' || p[1] == 'N')) {
+        text += '\n';
+        ++p;
+      } else {
+        text += *p;
+      }
     }
+    return text;
   }
 
   // Write the block [Script Info]
@@ -330,14 +522,7 @@ class AdvancedSubStationAlpha : public SubtitleFormatIO {
   // Write the block [V4+ Styles]
   void write_styles(Writer &file) {
     file.write("[V4+ Styles]\n");
-    file.write(
-        "Format: "
-        "Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
-        "OutlineColour, "
-        "BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, "
-        "Spacing, Angle, "
-        "BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, "
-        "Encoding\n");
+    file.write(Glib::ustring("Format: ") + get_styles_format() + "\n");
 
     // Default style if it's empty
     if (document()->styles().size() == 0) {
@@ -405,9 +590,7 @@ class AdvancedSubStationAlpha : public SubtitleFormatIO {
   void write_events(Writer &file) {
     file.write("[Events]\n");
     // format:
-    file.write(
-        "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
-        "Effect, Text\n");
+    file.write(Glib::ustring("Format: ") + get_events_format() + "\n");
 
     Glib::RefPtr<Glib::Regex> re_intelligent_linebreak =
         Glib::Regex::create("\n(?=-\\s.*)", Glib::REGEX_MULTILINE);
@@ -454,7 +637,30 @@ class AdvancedSubStationAlpha : public SubtitleFormatIO {
                          time.seconds(), hundredths);
   }
 
-  // Convert time from ASS to SE
+  // Convert time from ASS to SE, "h:mm:ss.cc" is read without sscanf.
+  SubtitleTime from_ass_time(const Reader::Line &field) {
+    const char *p = field.data;
+    const char *end = field.data + field.size;
+    const char separators[] = {':', ':', '.'};
+    int values[4];
+    for (int i = 0; i < 4; ++i) {
+      if (i > 0) {
+        if (p == end || *p != separators[i - 1])
+          return from_ass_time(field.str());
+        ++p;
+      }
+      const char *first = p;
+      values[i] = 0;
+      while (p < end && g_ascii_isdigit(*p) && p - first < 9) {
+        values[i] = values[i] * 10 + (*p - '0');
+        ++p;
+      }
+      if (p == first)
+        return from_ass_time(field.str());
+    }
+    return SubtitleTime(values[0], values[1], values[2], values[3] * 10);
+  }
+
   SubtitleTime from_ass_time(const Glib::ustring &t) {
     int h, m, s, ms;
     if (std::sscanf(t.c_str(), "%d:%d:%d.%d", &h, &m, &s, &ms) == 4)
@@ -528,8 +734,12 @@ class AdvancedSubStationAlpha : public SubtitleFormatIO {
   }
 
   bool get_screen_resolution(guint &width, guint &height) {
-    Glib::RefPtr<Gdk::Screen> screen =
-        Gdk::Display::get_default()->get_default_screen();
+    // Without display (subtitleeditor-convert)
+    Glib::RefPtr<Gdk::Display> display = Gdk::Display::get_default();
+    if (!display)
+      return false;
+
+    Glib::RefPtr<Gdk::Screen> screen = display->get_default_screen();
     if (!screen)
       return false;
 
@@ -37,66 +37,123 @@ class SubRip : public SubtitleFormatIO {
     int start[4], end[4];
     Subtitles subtitles = document()->subtitles();
 
-    Glib::ustring line;
+    Reader::Line line;
 
     while (file.getline(line)) {
-      // Read the subtitle time "start --> end"
-      if (re_time->match(line)) {
-        std::vector<Glib::ustring> group = re_time->split(line);
-
-        start[0] = utility::string_to_int(group[1]);
-        start[1] = utility::string_to_int(group[2]);
-        start[2] = utility::string_to_int(group[3]);
-        start[3] = utility::string_to_int(group[4]);
-
-        end[0] = utility::string_to_int(group[5]);
-        end[1] = utility::string_to_int(group[6]);
-        end[2] = utility::string_to_int(group[7]);
-        end[3] = utility::string_to_int(group[8]);
-
-        Glib::ustring text;
-        int count = 0;
-
-        // Read the text lines
-        while (file.getline(line) && !line.empty()) {
-          if (count > 0)
-            text += '\n';
-
-          text += line;
-
-          ++count;
-        }
-
-        // Append a subtitle
-        Subtitle sub = subtitles.append();
-
-        sub.set_text(text);
-        sub.set_start_and_end(
-            SubtitleTime(start[0], start[1], start[2], start[3]),
-            SubtitleTime(end[0], end[1], end[2], end[3]));
-      } else {
-        se_dbg_msg(SE_DBG_PLUGINS, "can not match time line: '%s'",
-                   line.c_str());
+      // Read the subtitle time "start --> end", the regex is only used for
+      // the odd lines with an arrow (not for the numbers)
+      if (!parse_time_line(line.data, line.data + line.size, start, end) &&
+          (!has_arrow(line) ||
+           !parse_time_line(re_time, line.str(), start, end))) {
+        se_dbg_msg(SE_DBG_PLUGINS, "can not match time line: '%.*s'",
+                   static_cast<int>(line.size), line.data);
+        continue;
       }
+
+      Glib::ustring text;
+      int count = 0;
+
+      // Read the text lines
+      while (file.getline(line) && !line.empty()) {
+        if (count > 0)
+          text += '\n';
+
+        text.append(line.data, line.data + line.size);
+
+        ++count;
+      }
+
+      // Append a subtitle
+      Subtitle sub = subtitles.append();
+
+      sub.set_text(text);
+      sub.set_start_and_end(
+          SubtitleTime(start[0], start[1], start[2], start[3]),
+          SubtitleTime(end[0], end[1], end[2], end[3]));
+    }
+  }
+
+  // Return true if the line contains "-->".
+  static bool has_arrow(const Reader::Line &line) {
+    return g_strstr_len(line.data, line.size, "-->") != NULL;
+  }
+
+  // Read a number of (at most 9) ASCII digits.
+  static bool parse_number(const char *&p, const char *end, int &value) {
+    const char *first = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9' && p - first < 9) {
+      value = value * 10 + (*p - '0');
+      ++p;
     }
+    return p > first && (p == end || *p < '0' || *p > '9');
+  }
+
+  // Read "h:m:s,ms" to time.
+  static bool parse_time(const char *&p, const char *end, int time[4]) {
+    const char separators[] = {':', ':', ','};
+    for (int i = 0; i < 4; ++i) {
+      if (!parse_number(p, end, time[i]))
+        return false;
+      if (i < 3) {
+        if (p == end || *p != separators[i])
+          return false;
+        ++p;
+      }
+    }
+    return true;
+  }
+
+  // Fast path, read "start --> end" at the beginning of the line without
+  // allocation. Only the well formed lines (ASCII digits, a space or a tab
+  // around the arrow) are read, the others are left to the regex.
+  static bool parse_time_line(const char *p, const char *end, int start[4],
+                              int stop[4]) {
+    if (!parse_time(p, end, start))
+      return false;
+    if (end - p < 5 || (p[0] != ' ' && p[0] != '\t') || p[1] != '-' ||
+        p[2] != '-' || p[3] != '>' || (p[4] != ' ' && p[4] != '\t'))
+      return false;
+    p += 5;
+    return parse_time(p, end, stop);
+  }
+
+  // Slow path, read "start --> end" with the regex (unicode digits or spaces).
+  static bool parse_time_line(const Glib::RefPtr<Glib::Regex> &re_time,
+                              const Glib::ustring &line, int start[4],
+                              int stop[4]) {
+    if (!re_time->match(line))
+      return false;
+
+    std::vector<Glib::ustring> group = re_time->split(line);
+
+    start[0] = utility::string_to_int(group[1]);
+    start[1] = utility::string_to_int(group[2]);
+    start[2] = utility::string_to_int(group[3]);
+    start[3] = utility::string_to_int(group[4]);
+
+    stop[0] = utility::string_to_int(group[5]);
+    stop[1] = utility::string_to_int(group[6]);
+    stop[2] = utility::string_to_int(group[7]);
+    stop[3] = utility::string_to_int(group[8]);
+    return true;
   }
 
   void save(Writer &file) {
     unsigned int count = 1;
     for (Subtitle sub = document()->subtitles().get_first(); sub;
          ++sub, ++count) {
-      Glib::ustring text = sub.get_text();
-
-      file.write(Glib::ustring::compose("%1\n%2 --> %3\n%4\n\n", count,
-                                        time_to_subrip(sub.get_start()),
-                                        time_to_subrip(sub.get_end()), text));
+      // "%1\n%2 --> %3\n%4\n\n" without temporary strings
+      file.write_int(count);
+      file.write('\n');
+      file.write_time(sub.get_start(), ',');
+      file.write(" --> ");
+      file.write_time(sub.get_end(), ',');
+      file.write('\n');
+      file.write(sub.get_text());
+      file.write("\n\n");
     }
   }
-
-  Glib::ustring time_to_subrip(const SubtitleTime &t) {
-    return build_message("%02i:%02i:%02i,%03i", t.hours(), t.minutes(),
-                         t.seconds(), t.mseconds());
-  }
 };
 
 class SubRipPlugin : public SubtitleFormat {
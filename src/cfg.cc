@@ -19,6 +19,7 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <glibmm.h>
+#include <memory>
 #include "cfg.h"
 #include "defaultcfg.h"
 #include "utility.h"
@@ -33,12 +34,16 @@ using std::cerr;
 using std::endl;
 using std::map;
 
+// The configuration is used by the main loop and by the threads which open
+// the documents (DocumentLoader): the keyfile is protected by a mutex and the
+// signals are always emitted in the main loop.
 class Configuration {
   typedef signal<void, ustring, ustring> SignalChanged;
   typedef map<ustring, SignalChanged> SignalGroup;
 
  public:
-  Configuration() {
+  // Created by the first use, in the main thread (startup)
+  Configuration() : m_main_thread(g_thread_self()) {
   }
 
   ~Configuration() {
@@ -49,6 +54,11 @@ class Configuration {
     return m_signals;
   }
 
+  // Lock the mutex before the use of the keyfile
+  Glib::Threads::RecMutex &mutex() {
+    return m_mutex;
+  }
+
   Glib::KeyFile &keyfile() {
     if (!m_keyfile_initialized) {
       load();
@@ -56,6 +66,10 @@ class Configuration {
     return m_keyfile;
   }
 
+  bool is_main_thread() const {
+    return g_thread_self() == m_main_thread;
+  }
+
  protected:
   void load() {
     auto file = get_config_dir("config");
@@ -95,6 +109,8 @@ class Configuration {
   }
 
  protected:
+  GThread *m_main_thread;
+  Glib::Threads::RecMutex m_mutex;
   bool m_keyfile_initialized{false};
   Glib::KeyFile m_keyfile;
   SignalGroup m_signals;
@@ -109,18 +125,47 @@ Glib::KeyFile &keyfile() {
   return configuration().keyfile();
 }
 
+// Lock the keyfile for the scope.
+class Lock {
+ public:
+  Lock() : m_lock(configuration().mutex()) {
+  }
+
+ protected:
+  Glib::Threads::RecMutex::Lock m_lock;
+};
+
+// A change made by a thread, emitted later by the main loop.
+struct Changed {
+  ustring group;
+  ustring key;
+  ustring value;
+};
+
+static gboolean on_emit_changed(gpointer data) {
+  std::unique_ptr<Changed> changed(static_cast<Changed *>(data));
+  configuration().signals()[changed->group](changed->key, changed->value);
+  return G_SOURCE_REMOVE;
+}
+
 // connect a signal to the group, notify when a key change
 sigc::signal<void, ustring, ustring> &signal_changed(const ustring &group) {
   return configuration().signals()[group];
 }
 
 // emit a signal on the only to the group
+// The slots are called by the main loop if the change is made by a thread.
 void emit_signal_changed(const ustring &g, const ustring &k, const ustring &v) {
+  if (!configuration().is_main_thread()) {
+    g_idle_add(on_emit_changed, new Changed{g, k, v});
+    return;
+  }
   configuration().signals()[g](k, v);
 }
 
 // check if a key exists on the group
 bool has_key(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().has_key(group, key);
   } catch (const KeyFileError &ex) {
@@ -131,32 +176,40 @@ bool has_key(const ustring &group, const ustring &key) {
 
 // return the keys of the group
 vector<ustring> get_keys(const ustring &group) {
+  Lock lock;
   return keyfile().get_keys(group);
 }
 
 // check if a group exists
 bool has_group(const ustring &group) {
+  Lock lock;
   return keyfile().has_group(group);
 }
 
 // remove the group and associated keys
 void remove_group(const ustring &group) {
+  Lock lock;
   keyfile().remove_group(group);
 }
 
 // set a comment to the key
 void set_comment(const ustring &g, const ustring &k, const ustring &v) {
+  Lock lock;
   keyfile().set_comment(g, k, v);
 }
 
 // set the string value to the key
 void set_string(const ustring &g, const ustring &k, const ustring &v) {
-  keyfile().set_string(g, k, v);
+  {
+    Lock lock;
+    keyfile().set_string(g, k, v);
+  }
   emit_signal_changed(g, k, v);
 }
 
 // return a string value of the key
 ustring get_string(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().get_string(group, key);
   } catch (const KeyFileError &ex) {
@@ -168,6 +221,7 @@ ustring get_string(const ustring &group, const ustring &key) {
 // set the string values to the key
 void set_string_list(const ustring &g, const ustring &k,
                      const vector<ustring> &v) {
+  Lock lock;
   keyfile().set_string_list(g, k, v);
   // FIXME: join strings and emit signal
   // emit_signal_changed(g, k, v);
@@ -175,6 +229,7 @@ void set_string_list(const ustring &g, const ustring &k,
 
 // return a strings value of the key
 vector<ustring> get_string_list(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().get_string_list(group, key);
   } catch (const KeyFileError &ex) {
@@ -185,12 +240,16 @@ vector<ustring> get_string_list(const ustring &group, const ustring &key) {
 
 // set the boolean value to the key
 void set_boolean(const ustring &g, const ustring &k, const bool &v) {
-  keyfile().set_boolean(g, k, v);
+  {
+    Lock lock;
+    keyfile().set_boolean(g, k, v);
+  }
   emit_signal_changed(g, k, to_string(v));
 }
 
 // return a boolean value of the key
 bool get_boolean(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().get_boolean(group, key);
   } catch (const KeyFileError &ex) {
@@ -201,12 +260,16 @@ bool get_boolean(const ustring &group, const ustring &key) {
 
 // set the integer value to the key
 void set_int(const ustring &g, const ustring &k, const int &v) {
-  keyfile().set_integer(g, k, v);
+  {
+    Lock lock;
+    keyfile().set_integer(g, k, v);
+  }
   emit_signal_changed(g, k, to_string(v));
 }
 
 // return a integer value of the key
 int get_int(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().get_integer(group, key);
   } catch (const KeyFileError &ex) {
@@ -217,12 +280,16 @@ int get_int(const ustring &group, const ustring &key) {
 
 // set the double value to the key
 void set_double(const ustring &g, const ustring &k, const double &v) {
-  keyfile().set_double(g, k, v);
+  {
+    Lock lock;
+    keyfile().set_double(g, k, v);
+  }
   emit_signal_changed(g, k, to_string(v));
 }
 
 // return a double value of the key
 double get_double(const ustring &group, const ustring &key) {
+  Lock lock;
   try {
     return keyfile().get_double(group, key);
   } catch (const KeyFileError &ex) {
@@ -39,10 +39,31 @@ Glib::ustring Command::description() const {
   return m_description;
 }
 
+// Return an estimation of the memory used by the command (bytes).
+gsize Command::memory_usage() const {
+  return sizeof(Command) + m_description.bytes();
+}
+
+// By default the commands can't be merged.
+bool Command::can_merge(const Command * /*cmd*/) const {
+  return false;
+}
+
+void Command::merge(Command * /*cmd*/) {
+}
+
+// By default the command stays in memory.
+gsize Command::spill(CommandSpillFile & /*file*/) {
+  return 0;
+}
+
+void Command::unspill(CommandSpillFile & /*file*/) {
+}
+
 SubtitleModelPtr Command::get_document_subtitle_model() {
   return document()->get_subtitle_model();
 }
 
-SubtitleViewPtr Command::get_document_subtitle_view() {
-  return document()->get_subtitle_view();
+DocumentView *Command::get_document_view() {
+  return document()->get_view();
 }
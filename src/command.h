@@ -22,9 +22,10 @@
 
 #include <glibmm.h>
 
+class CommandSpillFile;
 class Document;
+class DocumentView;
 class SubtitleModel;
-class SubtitleView;
 
 class Command {
  public:
@@ -39,10 +40,29 @@ class Command {
 
   Glib::RefPtr<SubtitleModel> get_document_subtitle_model();
 
-  SubtitleView* get_document_subtitle_view();
+  // Return the view of the document or NULL.
+  DocumentView* get_document_view();
 
   Glib::ustring description() const;
 
+  // Return an estimation of the memory used by the command (bytes).
+  virtual gsize memory_usage() const;
+
+  // Return true if cmd can be merged in this command (consecutive edits of
+  // the same values).
+  virtual bool can_merge(const Command *cmd) const;
+
+  // Merge cmd in this command, the command keeps its old values and takes
+  // the new values of cmd. cmd can be deleted after.
+  virtual void merge(Command *cmd);
+
+  // Write the data of the command in the file and release them from the
+  // memory. Return the number of bytes written (0 if nothing is spilled).
+  virtual gsize spill(CommandSpillFile &file);
+
+  // Read back the data written by spill().
+  virtual void unspill(CommandSpillFile &file);
+
  protected:
   Document* m_document;
   Glib::ustring m_description;
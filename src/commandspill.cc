@@ -0,0 +1,170 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "commandspill.h"
+#include "debug.h"
+#include "error.h"
+
+// The released space at the start of the file is reclaimed from this size
+// (bytes).
+static const gint64 COMPACT_MIN_SIZE = 16 * 1024 * 1024;
+
+CommandSpillFile::CommandSpillFile() {
+}
+
+CommandSpillFile::~CommandSpillFile() {
+  if (m_file == nullptr)
+    return;
+
+  fclose(m_file);
+}
+
+// Create the file if needed.
+void CommandSpillFile::open() {
+  if (m_file != nullptr)
+    return;
+
+  gchar *filename = nullptr;
+  GError *error = nullptr;
+  int fd = g_file_open_tmp("subtitleeditor-undo-XXXXXX", &filename, &error);
+  if (fd == -1) {
+    std::string msg = error->message;
+    g_error_free(error);
+    throw IOFileError(msg);
+  }
+
+  m_filename = filename;
+  g_free(filename);
+
+  // The file is removed now, it's only reachable by the descriptor and it
+  // disappears even if the application crashes
+  g_unlink(m_filename.c_str());
+
+  m_file = fdopen(fd, "w+b");
+  if (m_file == nullptr) {
+    ::close(fd);
+    throw IOFileError("Failed to open the undo file " + m_filename);
+  }
+  se_dbg_msg(SE_DBG_COMMAND, "undo file: %s", m_filename.c_str());
+}
+
+// Append the data to the file and return its offset.
+gint64 CommandSpillFile::write(const void *data, gsize size) {
+  open();
+
+  gint64 offset = m_base + m_end;
+  if (size == 0)
+    return offset;
+
+  if (fseeko(m_file, m_end, SEEK_SET) != 0 ||
+      fwrite(data, 1, size, m_file) != size || fflush(m_file) != 0)
+    throw IOFileError("Failed to write the undo file " + m_filename);
+
+  m_end += size;
+  return offset;
+}
+
+// Read size bytes at offset.
+void CommandSpillFile::read(gint64 offset, void *data, gsize size) {
+  if (size == 0)
+    return;
+
+  gint64 start = offset - m_base;
+  if (m_file == nullptr || start < m_start ||
+      start + static_cast<gint64>(size) > m_end)
+    throw IOFileError("Invalid read of the undo file");
+
+  if (fseeko(m_file, start, SEEK_SET) != 0 ||
+      fread(data, 1, size, m_file) != size)
+    throw IOFileError("Failed to read the undo file " + m_filename);
+}
+
+// The first size bytes of the data are no longer used.
+void CommandSpillFile::release_front(gsize size) {
+  m_start += std::min(static_cast<gint64>(size), m_end - m_start);
+
+  if (m_start == m_end)
+    truncate();
+  else
+    compact();
+}
+
+// The last size bytes of the data are no longer used.
+void CommandSpillFile::release_back(gsize size) {
+  m_end -= std::min(static_cast<gint64>(size), m_end - m_start);
+  truncate();
+}
+
+// Return the number of bytes used in the file.
+gsize CommandSpillFile::size() const {
+  return static_cast<gsize>(m_end - m_start);
+}
+
+// Truncate the file after the data, or to 0 when nothing is used.
+void CommandSpillFile::truncate() {
+  if (m_file == nullptr)
+    return;
+
+  if (m_start == m_end) {
+    m_base += m_end;
+    m_start = m_end = 0;
+  }
+  if (ftruncate(fileno(m_file), m_end) != 0)
+    se_dbg_msg(SE_DBG_COMMAND, "failed to truncate the undo file");
+}
+
+// Move the data to the start of the file when the released space before
+// them is larger than the data. The two ranges don't overlap, the data
+// stay where they are if the copy fails.
+void CommandSpillFile::compact() {
+  gint64 used = m_end - m_start;
+  if (m_file == nullptr || m_start < COMPACT_MIN_SIZE || m_start < used)
+    return;
+
+  std::vector<char> buffer(std::min<gint64>(used, 1024 * 1024));
+  for (gint64 done = 0; done < used;) {
+    gsize size = static_cast<gsize>(
+        std::min<gint64>(used - done, static_cast<gint64>(buffer.size())));
+    if (fseeko(m_file, m_start + done, SEEK_SET) != 0 ||
+        fread(&buffer[0], 1, size, m_file) != size ||
+        fseeko(m_file, done, SEEK_SET) != 0 ||
+        fwrite(&buffer[0], 1, size, m_file) != size) {
+      g_warning("Failed to compact the undo file %s", m_filename.c_str());
+      return;
+    }
+    done += size;
+  }
+  if (fflush(m_file) != 0) {
+    g_warning("Failed to compact the undo file %s", m_filename.c_str());
+    return;
+  }
+
+  se_dbg_msg(SE_DBG_COMMAND, "undo file compacted: %lu bytes moved",
+             static_cast<unsigned long>(used));
+
+  m_base += m_start;
+  m_start = 0;
+  m_end = used;
+  truncate();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <glibmm.h>
+#include <cstdio>
+#include <string>
+
+// Temporary file where the old undo entries are written when the undo
+// history uses too much memory (CommandSystem::limit_undo_memory).
+// The data are appended and released in order, from the front (the oldest
+// entry is deleted) or from the back (the newest entry is read back). The
+// space released at the front is reclaimed by moving the data to the start
+// of the file, the offsets don't change. The file is removed as soon as
+// it's created, only the descriptor keeps it.
+class CommandSpillFile {
+ public:
+  CommandSpillFile();
+  ~CommandSpillFile();
+
+  // Append the data to the file and return its offset.
+  // Throw an IOFileError on failure.
+  gint64 write(const void *data, gsize size);
+
+  // Read size bytes at offset.
+  // Throw an IOFileError on failure.
+  void read(gint64 offset, void *data, gsize size);
+
+  // The first size bytes of the data are no longer used.
+  void release_front(gsize size);
+
+  // The last size bytes of the data are no longer used.
+  void release_back(gsize size);
+
+  // Return the number of bytes used in the file.
+  gsize size() const;
+
+ protected:
+  // Create the file if needed.
+  void open();
+
+  // Truncate the file after the data, or to 0 when nothing is used.
+  void truncate();
+
+  // Move the data to the start of the file when the released space before
+  // them is larger than the data.
+  void compact();
+
+ protected:
+  FILE *m_file{nullptr};
+  std::string m_filename;
+  // The data are between m_start and m_end in the file, m_base is the
+  // offset returned by write() for the first byte of the file
+  gint64 m_base{0};
+  gint64 m_start{0};
+  gint64 m_end{0};
+};
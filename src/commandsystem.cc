@@ -18,17 +18,80 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <atomic>
 #include "cfg.h"
 #include "commandsystem.h"
 #include "document.h"
 #include "utility.h"
 
+// Maximum delay between two commands merged by merge_last_command()
+// (microseconds).
+static const gint64 MERGE_DELAY = G_USEC_PER_SEC;
+
+// The spill file holds at most this number of times the memory limit of the
+// undo history, the oldest spilled commands are deleted beyond.
+static const gsize SPILL_MEMORY_RATIO = 4;
+
+// The limits of the undo stack ("interface" config), shared by all the
+// documents. Only one connection to the config signal, the documents can be
+// created and deleted by many threads (subtitleeditor-convert).
+class UndoLimits {
+ public:
+  static UndoLimits &instance() {
+    static UndoLimits limits;
+    return limits;
+  }
+
+  // Maximum number of commands, 0 for no limit
+  guint max_stack() const {
+    return m_max_stack;
+  }
+
+  // Maximum memory of the undo stack (bytes), 0 for no limit
+  gsize max_memory() const {
+    return m_max_memory;
+  }
+
+ protected:
+  UndoLimits() {
+    set_max_stack(cfg::get_int("interface", "max-undo"));
+    set_max_memory(cfg::get_int("interface", "max-undo-memory"));
+
+    cfg::signal_changed("interface")
+        .connect(sigc::mem_fun(*this, &UndoLimits::on_config_changed));
+  }
+
+  void set_max_stack(int max) {
+    m_max_stack = static_cast<guint>(std::max(max, 0));
+  }
+
+  // max is in MiB
+  void set_max_memory(int max) {
+    m_max_memory = static_cast<gsize>(std::max(max, 0)) * 1024 * 1024;
+  }
+
+  void on_config_changed(const Glib::ustring &key, const Glib::ustring &value) {
+    if (key == "max-undo")
+      set_max_stack(utility::string_to_int(value));
+    else if (key == "max-undo-memory")
+      set_max_memory(utility::string_to_int(value));
+  }
+
+ protected:
+  std::atomic<guint> m_max_stack{0};
+  std::atomic<gsize> m_max_memory{0};
+};
+
 class SubtitleSelectionCommand : public Command {
  public:
   explicit SubtitleSelectionCommand(Document *doc)
       : Command(doc, _("Subtitle Selection")) {
-    std::vector<Gtk::TreeModel::Path> rows =
-        get_document_subtitle_view()->get_selection()->get_selected_rows();
+    DocumentView *view = get_document_view();
+    if (view == nullptr)
+      return;
+
+    std::vector<Gtk::TreeModel::Path> rows = view->get_selected_rows();
 
     m_paths.resize(rows.size());
 
@@ -37,25 +100,81 @@ class SubtitleSelectionCommand : public Command {
   }
 
   void execute() {
-    Glib::RefPtr<Gtk::TreeSelection> selection =
-        get_document_subtitle_view()->get_selection();
-
-    selection->unselect_all();
-    for (unsigned int i = 0; i < m_paths.size(); ++i)
-      selection->select(Gtk::TreePath(m_paths[i]));
+    select_paths();
   }
 
   void restore() {
-    Glib::RefPtr<Gtk::TreeSelection> selection =
-        get_document_subtitle_view()->get_selection();
+    select_paths();
+  }
 
-    selection->unselect_all();
+  // Replace the selection of the view by the paths.
+  void select_paths() {
+    DocumentView *view = get_document_view();
+    if (view == nullptr)
+      return;
+
+    view->unselect_all_rows();
     for (unsigned int i = 0; i < m_paths.size(); ++i)
-      selection->select(Gtk::TreePath(m_paths[i]));
+      view->select_row(Gtk::TreePath(m_paths[i]));
+  }
+
+  gsize memory_usage() const {
+    gsize size = Command::memory_usage();
+    for (const auto &path : m_paths) {
+      size += sizeof(Glib::ustring) + path.bytes();
+    }
+    return size;
+  }
+
+  // The selections are merged if they are the same.
+  bool can_merge(const Command *cmd) const {
+    const SubtitleSelectionCommand *selection =
+        dynamic_cast<const SubtitleSelectionCommand *>(cmd);
+    return selection != NULL && m_spill_offset == -1 &&
+           selection->m_spill_offset == -1 && m_paths == selection->m_paths;
+  }
+
+  void merge(Command * /*cmd*/) {
+  }
+
+  // The paths are written separated by a new line.
+  gsize spill(CommandSpillFile &file) {
+    if (m_spill_offset != -1 || m_paths.empty())
+      return 0;
+
+    std::string data;
+    for (const auto &path : m_paths) {
+      data += path.raw();
+      data += '\n';
+    }
+
+    m_spill_offset = file.write(data.data(), data.size());
+    m_spill_size = data.size();
+    std::vector<Glib::ustring>().swap(m_paths);
+    return m_spill_size;
+  }
+
+  void unspill(CommandSpillFile &file) {
+    if (m_spill_offset == -1)
+      return;
+
+    std::string data(m_spill_size, '\0');
+    gint64 offset = m_spill_offset;
+    m_spill_offset = -1;
+    file.read(offset, &data[0], m_spill_size);
+
+    std::string::size_type start = 0, end = 0;
+    while ((end = data.find('\n', start)) != std::string::npos) {
+      m_paths.push_back(data.substr(start, end - start));
+      start = end + 1;
+    }
   }
 
  protected:
   std::vector<Glib::ustring> m_paths;
+  // offset of the paths in the spill file or -1
+  gint64 m_spill_offset{-1};
+  gsize m_spill_size{0};
 };
 
 CommandGroup::CommandGroup(const Glib::ustring &description)
@@ -76,6 +195,14 @@ void CommandGroup::add(Command *cmd) {
   se_dbg(SE_DBG_COMMAND);
 
   m_stack.push_back(cmd);
+  m_memory_usage = 0;
+}
+
+// Return the last command of the group or NULL.
+Command *CommandGroup::back() {
+  if (m_stack.empty())
+    return NULL;
+  return m_stack.back();
 }
 
 void CommandGroup::execute() {
@@ -94,44 +221,85 @@ void CommandGroup::restore() {
   }
 }
 
-// Constructor
-// get the maximum stack to config
-CommandSystem::CommandSystem(Document &doc) : m_document(doc) {
-  m_max_undo_stack = cfg::get_int("interface", "max-undo");
+// The size is computed once, a group doesn't change after finish().
+gsize CommandGroup::memory_usage() const {
+  if (m_memory_usage != 0)
+    return m_memory_usage;
 
-  cfg::signal_changed("interface")
-      .connect(
-          sigc::mem_fun(*this, &CommandSystem::on_config_interface_changed));
+  gsize size = Command::memory_usage();
+  for (const auto &cmd : m_stack) {
+    size += cmd->memory_usage();
+  }
+  m_memory_usage = size;
+  return size;
 }
 
-CommandSystem::~CommandSystem() {
-  clear();
+// The groups can be merged if they have the same description and if each
+// command can be merged with the command at the same position.
+bool CommandGroup::can_merge(const Command *cmd) const {
+  const CommandGroup *group = dynamic_cast<const CommandGroup *>(cmd);
+  if (group == NULL || group->m_description != m_description ||
+      group->m_stack.size() != m_stack.size())
+    return false;
+
+  auto it = group->m_stack.begin();
+  for (const auto &command : m_stack) {
+    if (!command->can_merge(*it++))
+      return false;
+  }
+  return true;
 }
 
-void CommandSystem::on_config_interface_changed(const Glib::ustring &key,
-                                                const Glib::ustring &value) {
-  if (key == "max-undo") {
-    int max = utility::string_to_int(value);
+void CommandGroup::merge(Command *cmd) {
+  CommandGroup *group = static_cast<CommandGroup *>(cmd);
 
-    m_max_undo_stack = max;
+  auto it = group->m_stack.begin();
+  for (const auto &command : m_stack) {
+    command->merge(*it++);
   }
+  m_memory_usage = 0;
 }
 
-// efface les piles undo/redo
-void CommandSystem::clear() {
-  // on efface la pile undo
-  while (!m_undo_stack.empty()) {
-    Command *cmd = m_undo_stack.back();
-
-    m_undo_stack.pop_back();
+gsize CommandGroup::spill(CommandSpillFile &file) {
+  gsize size = 0;
+  for (const auto &cmd : m_stack) {
+    size += cmd->spill(file);
+  }
+  m_memory_usage = 0;
+  return size;
+}
 
-    delete cmd;
+void CommandGroup::unspill(CommandSpillFile &file) {
+  for (const auto &cmd : m_stack) {
+    cmd->unspill(file);
   }
+  m_memory_usage = 0;
+}
 
-  // on efface la pile redo
+// Constructor
+// The limits of the undo stack come from the config (UndoLimits), they are
+// applied by the next command.
+CommandSystem::CommandSystem(Document &doc) : m_document(doc) {
+  UndoLimits::instance();
+}
+
+CommandSystem::~CommandSystem() {
+  clear();
+}
+
+// efface les piles undo/redo
+void CommandSystem::clear() {
+  clearUndo();
   clearRedo();
 }
 
+void CommandSystem::clearUndo() {
+  while (!m_undo_stack.empty()) {
+    delete_oldest_undo_command();
+  }
+  m_undo_memory = 0;
+}
+
 void CommandSystem::clearRedo() {
   while (!m_redo_stack.empty()) {
     Command *cmd = m_redo_stack.back();
@@ -156,24 +324,153 @@ void CommandSystem::add(Command *cmd) {
     group->add(cmd);
   } else {
     m_undo_stack.push_back(cmd);
+    m_undo_memory += cmd->memory_usage();
+    merge_last_command();
   }
 
-  if (m_max_undo_stack != 0) {
-    while (m_undo_stack.size() > m_max_undo_stack) {
-      Command *tmp = m_undo_stack.front();
-      m_undo_stack.pop_front();
-      delete tmp;
+  guint max_undo_stack = UndoLimits::instance().max_stack();
+  if (max_undo_stack != 0) {
+    while (m_undo_stack.size() > max_undo_stack) {
+      delete_oldest_undo_command();
     }
   }
+
+  if (!m_is_recording)
+    limit_undo_memory();
+}
+
+// Merge the last command of the undo stack in the previous one if they are
+// consecutive edits of the same values (ex: typing in a cell, a boundary
+// dragged in the waveform or the times nudged with the keyboard). The
+// previous command keeps its old values and takes the new values.
+void CommandSystem::merge_last_command() {
+  gint64 now = g_get_monotonic_time();
+  gint64 last = m_last_command_time;
+  m_last_command_time = now;
+
+  if (now - last > MERGE_DELAY || m_undo_stack.size() < 2)
+    return;
+
+  Command *cmd = m_undo_stack.back();
+  Command *previous = m_undo_stack[m_undo_stack.size() - 2];
+
+  // a spilled command is not merged
+  if (m_undo_stack.size() - 2 < m_spilled.size() || !previous->can_merge(cmd))
+    return;
+
+  se_dbg_msg(SE_DBG_COMMAND, "merge '%s'", cmd->description().c_str());
+
+  gsize size = previous->memory_usage() + cmd->memory_usage();
+
+  previous->merge(cmd);
+  m_undo_stack.pop_back();
+  delete cmd;
+
+  m_undo_memory -= std::min(m_undo_memory, size);
+  m_undo_memory += previous->memory_usage();
+}
+
+// Delete the oldest command of the undo stack, release its data in the spill
+// file.
+void CommandSystem::delete_oldest_undo_command() {
+  Command *cmd = m_undo_stack.front();
+  m_undo_stack.pop_front();
+
+  if (!m_spilled.empty()) {
+    m_spill_file.release_front(m_spilled.front());
+    m_spilled.pop_front();
+  } else if (!m_is_recording || !m_undo_stack.empty()) {
+    // the current group is not counted
+    m_undo_memory -= std::min(m_undo_memory, cmd->memory_usage());
+  }
+  delete cmd;
+}
+
+// Read back the data of the last command of the undo stack, it must be
+// spilled. Return false if it failed, the command is partly restored.
+bool CommandSystem::unspill_last_command() {
+  Command *cmd = m_undo_stack.back();
+
+  bool done = true;
+  try {
+    cmd->unspill(m_spill_file);
+    // the command is in memory again, undo() subtracts it
+    m_undo_memory += cmd->memory_usage();
+  } catch (const std::exception &ex) {
+    g_warning("Failed to read back the undo entry '%s': %s",
+              cmd->description().c_str(), ex.what());
+    done = false;
+  }
+  m_spill_file.release_back(m_spilled.back());
+  m_spilled.pop_back();
+  return done;
+}
+
+// Write the oldest commands in the spill file while the undo stack uses more
+// memory than the limit of the config. The spilled commands are always the
+// first ones of the stack, the newest commands stay in memory and the
+// current group is never spilled. The oldest spilled commands are deleted
+// when the spill file is larger than SPILL_MEMORY_RATIO times the limit.
+void CommandSystem::limit_undo_memory() {
+  gsize max_undo_memory = UndoLimits::instance().max_memory();
+  if (max_undo_memory == 0)
+    return;
+
+  gsize count = m_undo_stack.size();
+  if (m_is_recording && count > 0)
+    --count;
+
+  while (m_undo_memory > max_undo_memory && m_spilled.size() < count) {
+    Command *cmd = m_undo_stack[m_spilled.size()];
+    gsize cmd_size = cmd->memory_usage();
+
+    // A command which can't be spilled (nothing written) stays in memory,
+    // it's not counted anymore. After a failure, the command can be partly
+    // spilled, it's read back by the undo.
+    gsize before = m_spill_file.size();
+    bool failed = false;
+    try {
+      cmd->spill(m_spill_file);
+    } catch (const std::exception &ex) {
+      g_warning("Failed to write the undo entry '%s': %s",
+                cmd->description().c_str(), ex.what());
+      failed = true;
+    }
+    m_spilled.push_back(m_spill_file.size() - before);
+    m_undo_memory -= std::min(m_undo_memory, cmd_size);
+    if (failed)
+      break;
+  }
+
+  while (!m_spilled.empty() &&
+         m_spill_file.size() > max_undo_memory * SPILL_MEMORY_RATIO) {
+    delete_oldest_undo_command();
+  }
+
+  se_dbg_msg(SE_DBG_COMMAND, "undo memory: %lu bytes, spilled: %lu bytes",
+             static_cast<unsigned long>(m_undo_memory),
+             static_cast<unsigned long>(m_spill_file.size()));
 }
 
 void CommandSystem::undo() {
   if (m_undo_stack.empty())
     return;
 
+  // A command which can't be read back completely is never replayed, the
+  // older commands can't be undone without it
+  if (m_undo_stack.size() <= m_spilled.size() && !unspill_last_command()) {
+    clearUndo();
+    m_document.flash_message(
+        _("The undo history could not be read back, it has been cleared."));
+    m_signal_changed();
+    return;
+  }
+
   Command *cmd = m_undo_stack.back();
 
   m_undo_stack.pop_back();
+  m_undo_memory -= std::min(m_undo_memory, cmd->memory_usage());
+  m_last_command_time = 0;
 
   // m_document.flash_message(_("Undo: %s"), cmd->description().c_str());
   cmd->restore();
@@ -190,11 +487,15 @@ void CommandSystem::redo() {
   Command *cmd = m_redo_stack.back();
 
   m_redo_stack.pop_back();
+  m_last_command_time = 0;
 
   // m_document.flash_message(_("Redo: %s"), cmd->description().c_str());
   cmd->execute();
 
   m_undo_stack.push_back(cmd);
+  m_undo_memory += cmd->memory_usage();
+
+  limit_undo_memory();
 
   m_signal_changed();
 }
@@ -213,12 +514,40 @@ bool CommandSystem::is_recording() {
   return m_is_recording;
 }
 
+// Return the last command added to the current group or NULL if it's not
+// recording.
+Command *CommandSystem::get_last_command() {
+  if (!m_is_recording || m_undo_stack.empty())
+    return NULL;
+
+  CommandGroup *group = dynamic_cast<CommandGroup *>(m_undo_stack.back());
+  if (group == NULL)
+    return NULL;
+  return group->back();
+}
+
 void CommandSystem::finish() {
-  if (m_is_recording)
+  if (m_is_recording) {
     add(new SubtitleSelectionCommand(&m_document));
 
+    m_is_recording = false;
+    // the group is finished, it's counted now
+    if (!m_undo_stack.empty())
+      m_undo_memory += m_undo_stack.back()->memory_usage();
+    merge_last_command();
+
+    if (!m_undo_stack.empty()) {
+      Command *group = m_undo_stack.back();
+      se_dbg_msg(SE_DBG_COMMAND, "undo memory of '%s': %lu bytes",
+                 group->description().c_str(),
+                 static_cast<unsigned long>(group->memory_usage()));
+    }
+  }
+
   m_is_recording = false;
 
+  limit_undo_memory();
+
   m_signal_changed();
 }
 
@@ -239,3 +568,22 @@ Glib::ustring CommandSystem::get_redo_description() {
 sigc::signal<void> &CommandSystem::signal_changed() {
   return m_signal_changed;
 }
+
+// Return the memory counted for the undo stack (bytes).
+gsize CommandSystem::get_undo_memory() const {
+  return m_undo_memory;
+}
+
+// Return the memory of the commands of the undo stack which are in memory,
+// except the current group. It must be the same as get_undo_memory().
+gsize CommandSystem::compute_undo_memory() const {
+  gsize count = m_undo_stack.size();
+  if (m_is_recording && count > 0)
+    --count;
+
+  gsize size = 0;
+  for (gsize i = m_spilled.size(); i < count; ++i) {
+    size += m_undo_stack[i]->memory_usage();
+  }
+  return size;
+}
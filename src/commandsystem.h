@@ -23,6 +23,7 @@
 #include <deque>
 #include <list>
 #include "command.h"
+#include "commandspill.h"
 
 class Document;
 
@@ -33,11 +34,25 @@ class CommandGroup : public Command {
 
   void add(Command *cmd);
 
+  // Return the last command of the group or NULL.
+  Command *back();
+
   void restore();
   void execute();
 
+  // The size is computed once, a group doesn't change after finish().
+  gsize memory_usage() const;
+
+  bool can_merge(const Command *cmd) const;
+  void merge(Command *cmd);
+
+  gsize spill(CommandSpillFile &file);
+  void unspill(CommandSpillFile &file);
+
  protected:
   std::list<Command *> m_stack;
+  // 0 if not computed
+  mutable gsize m_memory_usage{0};
 };
 
 class CommandSystem {
@@ -76,18 +91,53 @@ class CommandSystem {
   // emit with undo/redo/start/finish
   sigc::signal<void> &signal_changed();
 
+  // Return the memory counted for the undo stack (bytes).
+  gsize get_undo_memory() const;
+
+  // Return the memory of the commands of the undo stack which are in memory,
+  // except the current group. It must be the same as get_undo_memory().
+  gsize compute_undo_memory() const;
+
  protected:
+  // Return the last command added to the current group or NULL if it's not
+  // recording.
+  Command *get_last_command();
+
+  void clearUndo();
+
   void clearRedo();
 
-  void on_config_interface_changed(const Glib::ustring &name,
-                                   const Glib::ustring &value);
+  // Merge the last command of the undo stack in the previous one if they are
+  // consecutive edits of the same values.
+  void merge_last_command();
+
+  // Delete the oldest command of the undo stack, release its data in the
+  // spill file.
+  void delete_oldest_undo_command();
+
+  // Read back the data of the last command of the undo stack, it must be
+  // spilled. Return false if it failed.
+  bool unspill_last_command();
+
+  // Write the oldest commands in the spill file while the undo stack uses
+  // more memory than the limit of the config. The current group is never
+  // spilled.
+  void limit_undo_memory();
 
  protected:
   Document &m_document;
-  int m_max_undo_stack{10};
   bool m_is_recording{false};
+  // Time of the last command (g_get_monotonic_time), 0 after undo/redo
+  gint64 m_last_command_time{0};
   std::deque<Command *> m_undo_stack;
   std::deque<Command *> m_redo_stack;
 
+  // The size of the data of the first commands of the undo stack, which are
+  // in the spill file
+  CommandSpillFile m_spill_file;
+  std::deque<gsize> m_spilled;
+  // Memory of the other commands of the undo stack, except the current group
+  gsize m_undo_memory{0};
+
   sigc::signal<void> m_signal_changed;
 };
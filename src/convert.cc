@@ -0,0 +1,369 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// subtitleeditor-convert
+// Convert subtitle files without user interface, ex:
+//   subtitleeditor-convert --format=SubRip --output-dir=out *.ass
+// Only the subtitle format plugins are loaded, the documents are opened and
+// saved by SubtitleFormatSystem on a pool of threads.
+
+#include <config.h>
+#include <gtkmm/main.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "document.h"
+#include "error.h"
+#include "extension/subtitleformat.h"
+#include "extensionmanager.h"
+#include "subtitleformatsystem.h"
+#include "utility.h"
+
+class ConvertOptionGroup : public Glib::OptionGroup {
+ public:
+  ConvertOptionGroup()
+      : Glib::OptionGroup("subtitleeditor-convert", "description...",
+                          "help...") {
+    set_translation_domain(GETTEXT_PACKAGE);
+
+    // FILES...
+    Glib::OptionEntry entryFiles;
+    entryFiles.set_long_name(G_OPTION_REMAINING);
+    entryFiles.set_description(G_OPTION_REMAINING);
+    entryFiles.set_arg_description(_("[FILE...]"));
+    add_entry(entryFiles, files);
+
+    // format
+    Glib::OptionEntry entryFormat;
+    entryFormat.set_long_name("format");
+    entryFormat.set_short_name('f');
+    entryFormat.set_description("subtitle format of the output files");
+    entryFormat.set_arg_description(_("FORMAT"));
+    add_entry(entryFormat, format);
+
+    // encoding
+    Glib::OptionEntry entryEncoding;
+    entryEncoding.set_long_name("encoding");
+    entryEncoding.set_short_name('e');
+    entryEncoding.set_description("encoding of the output files");
+    entryEncoding.set_arg_description(_("ENCODING"));
+    add_entry(entryEncoding, encoding);
+
+    // input encoding
+    Glib::OptionEntry entryInputEncoding;
+    entryInputEncoding.set_long_name("input-encoding");
+    entryInputEncoding.set_short_name('i');
+    entryInputEncoding.set_description(
+        "encoding used to open files (automatic detection by default)");
+    entryInputEncoding.set_arg_description(_("ENCODING"));
+    add_entry(entryInputEncoding, input_encoding);
+
+    // newline
+    Glib::OptionEntry entryNewline;
+    entryNewline.set_long_name("newline");
+    entryNewline.set_short_name('n');
+    entryNewline.set_description(
+        "newline of the output files (Unix, Windows or Macintosh)");
+    entryNewline.set_arg_description(_("NEWLINE"));
+    add_entry(entryNewline, newline);
+
+    // output directory
+    Glib::OptionEntry entryOutput;
+    entryOutput.set_long_name("output-dir");
+    entryOutput.set_short_name('o');
+    entryOutput.set_description(
+        "directory of the output files (the directory of the input file by "
+        "default)");
+    entryOutput.set_arg_description(_("DIRECTORY"));
+    add_entry_filename(entryOutput, output_dir);
+
+    // jobs
+    Glib::OptionEntry entryJobs;
+    entryJobs.set_long_name("jobs");
+    entryJobs.set_short_name('j');
+    entryJobs.set_description(
+        "number of files converted at the same time (number of processors by "
+        "default)");
+    entryJobs.set_arg_description(_("N"));
+    add_entry(entryJobs, jobs);
+
+    // list formats
+    Glib::OptionEntry entryList;
+    entryList.set_long_name("list-formats");
+    entryList.set_short_name('l');
+    entryList.set_description("display the supported subtitle formats");
+    add_entry(entryList, list_formats);
+  }
+
+ public:
+  std::vector<Glib::ustring> files;
+
+  Glib::ustring format;
+  Glib::ustring encoding;
+  Glib::ustring input_encoding;
+  Glib::ustring newline;
+  std::string output_dir;
+  int jobs{0};
+  bool list_formats{false};
+};
+
+// The conversion of one file.
+struct ConvertJob {
+  Glib::ustring input;
+  Glib::ustring output;
+  Glib::ustring error;
+  guint subtitles{0};
+  goffset bytes{0};
+  gint64 usecs{0};
+};
+
+class Converter {
+ public:
+  explicit Converter(const ConvertOptionGroup &options) : m_options(options) {
+  }
+
+  // Convert all the files with the pool of threads.
+  // Return the number of failures.
+  int run(const std::vector<Glib::ustring> &files) {
+    m_jobs.resize(files.size());
+    for (gsize i = 0; i < files.size(); ++i) {
+      m_jobs[i].input =
+          Gio::File::create_for_commandline_arg(files[i])->get_uri();
+    }
+
+    int count = m_options.jobs > 0 ? m_options.jobs : g_get_num_processors();
+    count = std::max(1, std::min<int>(count, m_jobs.size()));
+
+    gint64 start = g_get_monotonic_time();
+
+    std::vector<Glib::Threads::Thread *> threads;
+    for (int i = 0; i < count; ++i) {
+      threads.push_back(Glib::Threads::Thread::create(
+          sigc::mem_fun(*this, &Converter::worker)));
+    }
+    for (auto thread : threads) {
+      thread->join();
+    }
+
+    return report(g_get_monotonic_time() - start);
+  }
+
+ protected:
+  // Convert the files until there is no more job.
+  void worker() {
+    for (;;) {
+      ConvertJob *job = nullptr;
+      {
+        Glib::Threads::Mutex::Lock lock(m_mutex);
+        if (m_next >= m_jobs.size())
+          return;
+        job = &m_jobs[m_next++];
+      }
+      convert(*job);
+      print(*job);
+    }
+  }
+
+  // Open and save the file, the document is never attached to a view.
+  void convert(ConvertJob &job) {
+    gint64 start = g_get_monotonic_time();
+
+    // Without view the document doesn't use any widget
+    std::unique_ptr<Document> doc(new Document());
+    doc->set_owned_by_worker(true);
+
+    try {
+      auto file = Gio::File::create_for_uri(job.input);
+      job.bytes = file->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE)->get_size();
+
+      SubtitleFormatSystem &sfs = SubtitleFormatSystem::instance();
+      sfs.open_from_uri(doc.get(), job.input, m_options.input_encoding);
+
+      Glib::ustring format =
+          m_options.format.empty() ? doc->getFormat() : m_options.format;
+      Glib::ustring charset =
+          m_options.encoding.empty() ? doc->getCharset() : m_options.encoding;
+      Glib::ustring newline =
+          m_options.newline.empty() ? doc->getNewLine() : m_options.newline;
+
+      job.output = get_output_uri(file, format);
+      if (job.output == job.input)
+        throw IOFileError(_("The output file is the input file."));
+
+      sfs.save_to_uri(doc.get(), job.output, format, charset, newline);
+
+      job.subtitles = doc->subtitles().size();
+    } catch (const std::exception &ex) {
+      job.error = ex.what();
+    } catch (const Glib::Error &ex) {
+      job.error = ex.what();
+    }
+
+    job.usecs = g_get_monotonic_time() - start;
+  }
+
+  // Return the uri of the output file, the extension of the input is
+  // replaced by the extension of the format.
+  Glib::ustring get_output_uri(const Glib::RefPtr<Gio::File> &input,
+                               const Glib::ustring &format) {
+    Glib::ustring basename = input->get_basename();
+    Glib::ustring::size_type dot = basename.rfind('.');
+    if (dot != Glib::ustring::npos && dot > 0)
+      basename = basename.substr(0, dot);
+
+    Glib::ustring ext =
+        SubtitleFormatSystem::instance().get_extension_of_format(format);
+    if (!ext.empty())
+      basename += "." + ext;
+
+    if (!m_options.output_dir.empty())
+      return Gio::File::create_for_commandline_arg(m_options.output_dir)
+          ->get_child(basename)
+          ->get_uri();
+    return input->get_parent()->get_child(basename)->get_uri();
+  }
+
+  // Display the result and the throughput of the job.
+  void print(const ConvertJob &job) {
+    Glib::Threads::Mutex::Lock lock(m_mutex);
+
+    if (!job.error.empty()) {
+      std::cerr << job.input << ": " << job.error << std::endl;
+      return;
+    }
+
+    double secs = std::max(job.usecs, gint64(1)) / double(G_USEC_PER_SEC);
+    std::cout << Glib::ustring::compose(
+                     "%1 -> %2: %3 subtitles, %4 KiB in %5 ms (%6 "
+                     "subtitles/s)",
+                     job.input, job.output, job.subtitles,
+                     Glib::ustring::format(std::fixed, std::setprecision(1),
+                                           job.bytes / 1024.0),
+                     Glib::ustring::format(std::fixed, std::setprecision(1),
+                                           job.usecs / 1000.0),
+                     static_cast<guint64>(job.subtitles / secs))
+              << std::endl;
+  }
+
+  // Display the throughput of all the files.
+  // Return the number of failures.
+  int report(gint64 usecs) {
+    int failed = 0;
+    guint64 subtitles = 0;
+    goffset bytes = 0;
+    for (const auto &job : m_jobs) {
+      if (!job.error.empty()) {
+        ++failed;
+        continue;
+      }
+      subtitles += job.subtitles;
+      bytes += job.bytes;
+    }
+
+    double secs = std::max(usecs, gint64(1)) / double(G_USEC_PER_SEC);
+    std::cout << Glib::ustring::compose(
+                     "%1 files converted, %2 failed: %3 subtitles, %4 MiB in "
+                     "%5 s (%6 files/s, %7 subtitles/s, %8 MiB/s)",
+                     m_jobs.size() - failed, failed, subtitles,
+                     Glib::ustring::format(std::fixed, std::setprecision(2),
+                                           bytes / 1048576.0),
+                     Glib::ustring::format(std::fixed, std::setprecision(2),
+                                           secs),
+                     Glib::ustring::format(std::fixed, std::setprecision(1),
+                                           (m_jobs.size() - failed) / secs),
+                     static_cast<guint64>(subtitles / secs),
+                     Glib::ustring::format(std::fixed, std::setprecision(2),
+                                           bytes / 1048576.0 / secs))
+              << std::endl;
+    return failed;
+  }
+
+ protected:
+  const ConvertOptionGroup &m_options;
+  // Protects m_next and the output
+  Glib::Threads::Mutex m_mutex;
+  std::vector<ConvertJob> m_jobs;
+  gsize m_next{0};
+};
+
+int main(int argc, char *argv[]) {
+  bindtextdomain(GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
+  bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
+  textdomain(GETTEXT_PACKAGE);
+
+  // gtkmm types without display (the models of the document)
+  Gtk::Main::init_gtkmm_internals();
+
+  Glib::set_application_name("subtitleeditor-convert");
+
+  ConvertOptionGroup options;
+  try {
+    Glib::OptionContext context(_(" - convert subtitles files"));
+    context.set_main_group(options);
+    context.parse(argc, argv);
+  } catch (const Glib::Error &ex) {
+    std::cerr << "Error loading options : " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Only the subtitle formats, the other plugins need the user interface
+  ExtensionManager::instance().create_extensions("subtitleformat");
+
+  SubtitleFormatSystem &sfs = SubtitleFormatSystem::instance();
+
+  if (options.list_formats) {
+    for (const auto &info : sfs.get_infos()) {
+      std::cout << info.name << " (" << info.extension << ")" << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (options.files.empty()) {
+    std::cerr << _("No file to convert.") << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!options.format.empty() && !sfs.is_supported(options.format)) {
+    std::cerr << build_message(_("Couldn't create the subtitle format '%s'."),
+                               options.format.c_str())
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The first instances register the types and write the default config
+  // of the formats, before the threads
+  delete new Document();
+  for (auto info :
+       ExtensionManager::instance().get_info_list_from_categorie(
+           "subtitleformat")) {
+    auto sf = dynamic_cast<SubtitleFormat *>(info->get_extension());
+    if (info->get_active() && sf)
+      delete sf->create();
+  }
+
+  Converter converter(options);
+  int failed = converter.run(options.files);
+
+  ExtensionManager::instance().destroy_extensions();
+
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
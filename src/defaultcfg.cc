@@ -72,6 +72,10 @@ void get_default_config(
   config["waveform-renderer"]["color-text"] = "#FFFFFFFF";
   config["waveform-renderer"]["color-player-position"] = "#FFFFFFFF";
 
+  // [media-cache]
+  config["media-cache"]["enabled"] = "true";
+  config["media-cache"]["max-size"] = "512";
+
   // [interface]
   config["interface"]["use-dynamic-keyboard-shortcuts"] = "true";
   config["interface"]["maximize-window"] = "false";
@@ -79,7 +83,8 @@ void get_default_config(
   config["interface"]["ask-to-save-on-exit"] = "false";
   config["interface"]["create-backup-copy"] = "false";
   config["interface"]["autosave-minutes"] = "10";
-  config["interface"]["max-undo"] = "20";
+  config["interface"]["max-undo"] = "0";
+  config["interface"]["max-undo-memory"] = "256";
 
   // [encodings]
   config["encodings"]["encodings"] = "ISO-8859-15;UTF-8";
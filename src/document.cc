@@ -18,17 +18,10 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-#include <gtkmm.h>
-#include <ctime>
-#include <iostream>
-#include <memory>
+#include <algorithm>
 #include "cfg.h"
 #include "document.h"
 #include "documents.h"
-#include "encodings.h"
-#include "error.h"
-#include "gui/comboboxencoding.h"
-#include "gui/dialogutility.h"
 #include "subtitleformatsystem.h"
 #include "utility.h"
 
@@ -97,11 +90,43 @@ Document::Document(Document &src, bool copy_subtitles)
 
 // Destructor
 Document::~Document() {
+  delete m_bulk_edit_command;
 }
 
-// Return the subtitle view widget (Gtk::TreeView)
+// Return the subtitle view widget (Gtk::TreeView) or NULL if there is no view.
 Gtk::Widget *Document::widget() {
-  return get_subtitle_view();
+  if (m_view == nullptr)
+    return nullptr;
+  return m_view->widget();
+}
+
+// Attach the view of the document (the document doesn't own it).
+// NULL detach the current view.
+void Document::attach_view(DocumentView *view) {
+  se_dbg(SE_DBG_APP);
+
+  m_view = view;
+
+  // The model stays detached until the end of the bulk edit
+  if (m_view != nullptr && is_bulk_editing())
+    m_view->detach_model();
+}
+
+// Return the view of the document or NULL.
+DocumentView *Document::get_view() {
+  return m_view;
+}
+
+// A document owned by a worker thread (DocumentLoader, convert) doesn't emit
+// the global signals of se::documents. The owner clears it before the
+// document is given to the main loop (se::documents::append).
+void Document::set_owned_by_worker(bool state) {
+  m_owned_by_worker = state;
+}
+
+// Return true if the document is owned by a worker thread.
+bool Document::is_owned_by_worker() const {
+  return m_owned_by_worker;
 }
 
 // Define the full filename of the document.
@@ -180,41 +205,6 @@ void Document::open(const Glib::ustring &uri) {
   SubtitleFormatSystem::instance().open_from_uri(this, uri, getCharset());
 }
 
-// Try to save the document to the file.
-// The format, charset and newline used are the document values.
-// The document name will be renamed from the uri.
-// An error dialog will be display if needed.
-// Return true if it succeeds or false.
-bool Document::save(const Glib::ustring &uri) {
-  Glib::ustring basename =
-      Glib::path_get_basename(Glib::filename_from_uri(uri));
-  Glib::ustring format = getFormat();
-  Glib::ustring charset = getCharset();
-  Glib::ustring newline = getNewLine();
-
-  try {
-    SubtitleFormatSystem::instance().save_to_uri(this, uri, format, charset,
-                                                 newline);
-    return true;
-  } catch (const EncodingConvertError &ex) {
-    Glib::ustring title = build_message(
-        _("Could not save the file \"%s\" using the character coding %s."),
-        basename.c_str(), Encodings::get_label_from_charset(charset).c_str());
-    Glib::ustring msg =
-        _("The document contains one or more characters "
-          "that cannot be encoded using the specified character coding.");
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
-    dialog.run();
-  } catch (const std::exception &ex) {
-    dialog_error(_("Save Document Failed."), ex.what());
-  } catch (const Glib::Exception &ex) {
-    dialog_error(_("Save Document Failed."), ex.what());
-  }
-  return false;
-}
-
 // Return the subtitle model.
 // A Gtk Model is used internally to avoid duplicate data.
 Glib::RefPtr<SubtitleModel> Document::get_subtitle_model() {
@@ -232,22 +222,6 @@ ScriptInfo &Document::get_script_info() {
   return m_scriptInfo;
 }
 
-// Return the (Gtk) subtitle view of the document.
-SubtitleView *Document::get_subtitle_view() {
-  if (m_subtitleView == nullptr)
-    create_subtitle_view();
-
-  return m_subtitleView;
-}
-
-// Create an attach the subtitle view of the document.
-void Document::create_subtitle_view() {
-  se_dbg(SE_DBG_APP);
-
-  m_subtitleView = manage(new SubtitleView(*this));
-  m_subtitleView->show();
-}
-
 // Display a message to the user. (statusbar)
 void Document::message(const gchar *format, ...) {
   va_list args;
@@ -306,11 +280,23 @@ void Document::start_command(const Glib::ustring &description) {
   CommandSystem::start(description);
 }
 
-void Document::add_command(Command *cmd) {
+// first_row is the first row inserted, moved or removed by the command.
+// During a bulk edit, the pending changes are kept in the same undo entry if
+// they are all before this row.
+void Document::add_command(Command *cmd, unsigned int first_row) {
+  // Keep the order of the commands: the pending changes of the bulk edit
+  // come first, unless the command doesn't move their rows. Then the undo
+  // restores them before the command and the redo applies them after it,
+  // their rows are the same.
+  if (m_bulk_edit_command != nullptr &&
+      m_bulk_edit_command->has_changes_from(first_row))
+    flush_bulk_edit_command();
   CommandSystem::add(cmd);
 }
 
 void Document::finish_command() {
+  flush_bulk_edit_command();
+
   if (CommandSystem::is_recording()) {
     CommandSystem::finish();
 
@@ -322,6 +308,89 @@ CommandSystem &Document::get_command_system() {
   return *this;
 }
 
+// Begin a bulk edit, the view is detached until the last commit.
+void Document::begin_bulk_edit() {
+  se_dbg_msg(SE_DBG_APP, "depth=%d", m_bulk_edit_depth);
+
+  if (m_bulk_edit_depth++ > 0)
+    return;
+
+  if (m_view != nullptr)
+    m_view->detach_model();
+}
+
+// Finish a bulk edit. The last commit records the undo entry, updates the
+// computed values of the subtitles, attaches the view and emits the signals.
+void Document::commit_bulk_edit() {
+  se_dbg_msg(SE_DBG_APP, "depth=%d", m_bulk_edit_depth);
+
+  g_return_if_fail(m_bulk_edit_depth > 0);
+
+  if (--m_bulk_edit_depth > 0)
+    return;
+
+  flush_bulk_edit_command();
+
+  m_subtitles.update_computed_values(m_bulk_edit_first_row,
+                                     m_bulk_edit_last_row);
+  m_bulk_edit_first_row = G_MAXUINT;
+  m_bulk_edit_last_row = 0;
+
+  if (m_view != nullptr)
+    m_view->attach_model();
+
+  std::vector<std::string> signals;
+  signals.swap(m_bulk_edit_signals);
+  for (const auto &name : signals) {
+    emit_signal(name);
+  }
+}
+
+// Return true between begin_bulk_edit and commit_bulk_edit.
+bool Document::is_bulk_editing() {
+  return m_bulk_edit_depth > 0;
+}
+
+// Remember that the times of the rows [first, last] have changed during the
+// bulk edit.
+void Document::mark_bulk_edit_changed(unsigned int first, unsigned int last) {
+  m_bulk_edit_first_row = std::min(m_bulk_edit_first_row, first);
+  m_bulk_edit_last_row = std::max(m_bulk_edit_last_row, last);
+}
+
+// Return the undo entry of the changes of the subtitles (created if needed).
+// During a bulk edit it's the entry of the bulk edit, otherwise the last
+// command of the group if it's a journal.
+SubtitleJournal *Document::get_subtitle_journal() {
+  if (is_bulk_editing()) {
+    if (m_bulk_edit_command == nullptr)
+      m_bulk_edit_command = new SubtitleJournal(this, _("Bulk edit"), true);
+    return m_bulk_edit_command;
+  }
+
+  SubtitleJournal *journal =
+      dynamic_cast<SubtitleJournal *>(CommandSystem::get_last_command());
+  if (journal == nullptr || journal->is_merging()) {
+    journal = new SubtitleJournal(this, _("Subtitle edited"));
+    add_command(journal);
+  }
+  return journal;
+}
+
+// Add the undo entry of the current bulk edit to the command system.
+void Document::flush_bulk_edit_command() {
+  if (m_bulk_edit_command == nullptr)
+    return;
+
+  SubtitleJournal *cmd = m_bulk_edit_command;
+  m_bulk_edit_command = nullptr;
+
+  if (cmd->empty() || !CommandSystem::is_recording())
+    delete cmd;
+  else
+    CommandSystem::add(cmd);
+}
+
 // The document has changed (start_command and finish_command are used)
 // after save the document toggle state of false
 // the signal "document-changed" is used after any change
@@ -384,96 +453,6 @@ FRAMERATE Document::get_framerate() {
   return m_framerate;
 }
 
-// Create a new document from an uri, if the charset is empty then it will try
-// to auto detect the good value. This function display a dialog ask or error if
-// needed. Return a new document or NULL.
-Document *Document::create_from_file(const Glib::ustring &uri,
-                                     const Glib::ustring &charset) {
-  se_dbg_msg(SE_DBG_APP, "uri=%s charset=%s", uri.c_str(), charset.c_str());
-
-  Glib::ustring filename = Glib::filename_from_uri(uri);
-  Glib::ustring basename = Glib::path_get_basename(filename);
-  Glib::ustring label_charset = Encodings::get_label_from_charset(charset);
-
-  try {
-    Document *doc = new Document;
-    doc->setCharset(charset);
-    doc->open(uri);
-    return doc;
-  } catch (const UnrecognizeFormatError &ex) {
-    Glib::ustring title = build_message(
-        _("Could not recognize the subtitle format for the file \"%s\"."),
-        basename.c_str());
-    Glib::ustring msg = _(
-        "Please check that the file contains subtitles in a supported format.");
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
-    dialog.run();
-  } catch (const EncodingConvertError &ex) {
-    Glib::ustring title, msg;
-
-    if (charset.empty()) {
-      title = build_message(_("Could not open automatically the file \"%s\"."),
-                            basename.c_str());
-      msg =
-          _("Subtitle Editor was not able to automatically determine the file "
-            "encoding. "
-            "Select a different character coding from the menu and try again.");
-    } else {
-      title = build_message(
-          _("Could not open the file \"%s\" using the character coding %s."),
-          basename.c_str(), Encodings::get_label_from_charset(charset).c_str());
-      msg =
-          _("Select a different character coding from the menu and try again.");
-    }
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
-    dialog.add_button(Gtk::Stock::OPEN, Gtk::RESPONSE_OK);
-
-    Gtk::Label labelEncoding(_("Character Coding:"), 1.0, 0.5);
-    ComboBoxEncoding comboEncoding(false);
-
-    Gtk::HBox hbox(false, 6);
-    dialog.get_vbox()->pack_start(hbox, false, false);
-    hbox.pack_start(labelEncoding);
-    hbox.pack_start(comboEncoding);
-
-    dialog.show_all();
-    if (dialog.run() == Gtk::RESPONSE_OK) {
-      dialog.hide();
-
-      return Document::create_from_file(uri, comboEncoding.get_value());
-    }
-  } catch (const std::exception &ex) {
-    Glib::ustring title =
-        build_message(_("Could not open the file \"%s\""), basename.c_str());
-    Glib::ustring msg = ex.what();
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
-    dialog.run();
-  } catch (const Glib::Exception &ex) {
-    Glib::ustring title =
-        build_message(_("Could not open the file \"%s\""), basename.c_str());
-    Glib::ustring msg = ex.what();
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
-    dialog.run();
-  } catch (...) {
-    Glib::ustring title =
-        build_message(_("Could not open the file \"%s\""), basename.c_str());
-    Glib::ustring msg = _("An unknown error occurred while opening the file.");
-
-    ErrorDialog dialog(title, msg);
-    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
-    dialog.run();
-  }
-  return nullptr;
-}
-
 // Return a signal connector from his name.
 sigc::signal<void> &Document::get_signal(const std::string &name) {
   return m_signal[name];
@@ -481,15 +460,28 @@ sigc::signal<void> &Document::get_signal(const std::string &name) {
 
 // Emit a signal from his name.
 void Document::emit_signal(const std::string &name) {
+  // Delayed to the end of the bulk edit, emitted only once
+  if (m_bulk_edit_depth > 0) {
+    if (std::find(m_bulk_edit_signals.begin(), m_bulk_edit_signals.end(),
+                  name) == m_bulk_edit_signals.end())
+      m_bulk_edit_signals.push_back(name);
+    return;
+  }
+
   se_dbg_msg(SE_DBG_APP, "signal named '%s'", name.c_str());
 
   m_signal[name].emit();
 
-  se::documents::signal_modified().emit(this, name);
+  // The slots of the user interface run in the main loop
+  if (!m_owned_by_worker)
+    se::documents::signal_modified().emit(this, name);
 }
 
 // Return the name of the current column focus.
 // (start, end, duration, text, translation ...)
+// Empty without view.
 Glib::ustring Document::get_current_column_name() {
-  return m_subtitleView->get_current_column_name();
+  if (m_view == nullptr)
+    return Glib::ustring();
+  return m_view->get_current_column_name();
 }
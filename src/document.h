@@ -25,29 +25,43 @@
 #include <string>
 #include <vector>
 #include "commandsystem.h"
+#include "documentview.h"
 #include "scriptinfo.h"
 #include "stylemodel.h"
 #include "styles.h"
+#include "subtitlejournal.h"
 #include "subtitles.h"
-#include "subtitleview.h"
 #include "timeutility.h"
 
+class DocumentLoader;
+
 typedef Glib::RefPtr<SubtitleModel> SubtitleModelPtr;
-typedef SubtitleView *SubtitleViewPtr;
 typedef std::vector<Document *> DocumentList;
 
-// A Document is the base of all, it represent the model (SubtitleModel) and the
-// view (SubtitleView), the metadata like the subtitle format of the document,
-// the character coding, the timing mode... all is there. Every  action on
-// subtitles begin from this class.
+// A Document is the base of all, it represent the model (SubtitleModel), the
+// metadata like the subtitle format of the document, the character coding, the
+// timing mode... all is there. Every  action on subtitles begin from this
+// class.
+// The view (SubtitleView) is optional, it's attached by the user interface.
+// A document without view doesn't use any widget and can be used outside the
+// main thread, it's marked as owned by a worker (set_owned_by_worker).
 class Document : protected CommandSystem {
  public:
   // Create a new document from an uri, if the charset is empty then it will try
   // to auto detect the good value. This function display a dialog ask or error
   // if needed. Return a new document or NULL.
+  // (user interface, gui/documentui.cc)
   static Document *create_from_file(
       const Glib::ustring &uri, const Glib::ustring &charset = Glib::ustring());
 
+  // Return the document opened by the loader (finished) or NULL.
+  // The errors are displayed like create_from_file, nothing is displayed if
+  // the loader has been cancelled. If the user asks to try again with another
+  // character coding, other_charset is set.
+  // (user interface, gui/documentui.cc)
+  static Document *create_from_loader(DocumentLoader &loader,
+                                      Glib::ustring &other_charset);
+
   // Constructor
   // The default values of the document are sets from the user config.
   Document();
@@ -71,6 +85,7 @@ class Document : protected CommandSystem {
   // The document name will be renamed from the uri.
   // An error dialog will be display if needed.
   // Return true if it succeeds or false.
+  // (user interface, gui/documentui.cc)
   bool save(const Glib::ustring &filename);
 
   // Define the subtitle format of the document.
@@ -155,14 +170,56 @@ class Document : protected CommandSystem {
   // change subtitle...
   // finish_command();
   void start_command(const Glib::ustring &description);
-  void add_command(Command *cmd);
+
+  // first_row is the first row inserted, moved or removed by the command.
+  // During a bulk edit, the pending changes are kept in the same undo entry
+  // if they are all before this row.
+  void add_command(Command *cmd, unsigned int first_row = 0);
   void finish_command();
 
   CommandSystem &get_command_system();
 
-  // Return the subtitle view widget (SubtitleView -> Gtk::TreeView)
+  // Bulk edit
+  // begin_bulk_edit();
+  // change many subtitles...
+  // commit_bulk_edit();
+  // Until the commit the view is detached from the model, the gaps and the
+  // characters per line/second of the subtitles are not updated, the changes
+  // of the subtitles share one undo entry and the signals are emitted only
+  // once by the commit. It can be nested, only the last commit does the work.
+  // Prefer DocumentBulkEdit.
+  void begin_bulk_edit();
+  void commit_bulk_edit();
+
+  // Return true between begin_bulk_edit and commit_bulk_edit.
+  bool is_bulk_editing();
+
+  // Remember that the times of the rows [first, last] have changed during
+  // the bulk edit, the commit updates only the gaps from the lowest to the
+  // highest changed row (and the next one). Without range all the rows
+  // (rows inserted, deleted or reordered).
+  void mark_bulk_edit_changed(unsigned int first = 0,
+                              unsigned int last = G_MAXUINT);
+
+  // Return the subtitle view widget (SubtitleView -> Gtk::TreeView) or NULL
+  // if there is no view.
   Gtk::Widget *widget();
 
+  // Attach the view of the document (the document doesn't own it).
+  // NULL detach the current view.
+  void attach_view(DocumentView *view);
+
+  // Return the view of the document or NULL.
+  DocumentView *get_view();
+
+  // A document owned by a worker thread (DocumentLoader, convert) doesn't
+  // emit the global signals of se::documents. The owner clears it before
+  // the document is given to the main loop (se::documents::append).
+  void set_owned_by_worker(bool state);
+
+  // Return true if the document is owned by a worker thread.
+  bool is_owned_by_worker() const;
+
   // Define the timing mode of the document.
   // This is the internal timing mode (frame or time) used
   // to represent subtitle.
@@ -221,6 +278,7 @@ class Document : protected CommandSystem {
 
   // Return the name of the current column focus.
   // (start, end, duration, text, translation ...)
+  // Empty without view.
   Glib::ustring get_current_column_name();
 
  protected:
@@ -233,11 +291,13 @@ class Document : protected CommandSystem {
   // A Gtk Model is used internally to avoid duplicate data.
   SubtitleModelPtr get_subtitle_model();
 
-  // Return the (Gtk) subtitle view of the document.
-  SubtitleViewPtr get_subtitle_view();
+  // Return the undo entry of the changes of the subtitles (created if
+  // needed). During a bulk edit it's the entry of the bulk edit, otherwise
+  // the last command of the group if it's a journal.
+  SubtitleJournal *get_subtitle_journal();
 
-  // Create an attach the subtitle view of the document.
-  void create_subtitle_view();
+  // Add the undo entry of the current bulk edit to the command system.
+  void flush_bulk_edit_command();
 
  protected:
   // Name of the document (ex: "toto.srt")
@@ -267,8 +327,10 @@ class Document : protected CommandSystem {
   ScriptInfo m_scriptInfo;
   // StyleModel attached to the document
   Glib::RefPtr<StyleModel> m_styleModel;
-  // SubtitleView attached to the document
-  SubtitleView *m_subtitleView{nullptr};
+  // View attached to the document (SubtitleView) or NULL
+  DocumentView *m_view{nullptr};
+  // The global signals (se::documents) are not emitted by a worker
+  bool m_owned_by_worker{false};
   // SubtitleModel attached to the document
   Glib::RefPtr<SubtitleModel> m_subtitleModel;
   //
@@ -279,4 +341,26 @@ class Document : protected CommandSystem {
   sigc::signal<void, Glib::ustring> m_signal_message;
   // signal connector to display a flash message (~3s) to the ui
   sigc::signal<void, Glib::ustring> m_signal_flash_message;
+  // bulk edit (begin_bulk_edit/commit_bulk_edit)
+  int m_bulk_edit_depth{0};
+  SubtitleJournal *m_bulk_edit_command{nullptr};
+  std::vector<std::string> m_bulk_edit_signals;
+  unsigned int m_bulk_edit_first_row{G_MAXUINT};
+  unsigned int m_bulk_edit_last_row{0};
+};
+
+// Scoped bulk edit of a document.
+// begin_bulk_edit in the constructor, commit_bulk_edit in the destructor.
+class DocumentBulkEdit {
+ public:
+  explicit DocumentBulkEdit(Document *doc) : m_document(doc) {
+    m_document->begin_bulk_edit();
+  }
+
+  ~DocumentBulkEdit() {
+    m_document->commit_bulk_edit();
+  }
+
+ protected:
+  Document *m_document;
 };
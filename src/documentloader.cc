@@ -0,0 +1,125 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "debug.h"
+#include "documentloader.h"
+#include "error.h"
+#include "subtitleformatsystem.h"
+
+// If charset is empty, the automatically detection is used.
+DocumentLoader::DocumentLoader(const Glib::ustring &uri,
+                               const Glib::ustring &charset)
+    : m_uri(uri), m_charset(charset) {
+  // Created by the main loop, the document has no view and is only used by
+  // the thread until the end
+  m_document.reset(new Document);
+  m_document->set_owned_by_worker(true);
+  m_document->setCharset(charset);
+
+  m_dispatcher.connect(
+      sigc::mem_fun(*this, &DocumentLoader::on_thread_finished));
+}
+
+// Cancel and wait the end of the thread.
+// The document is deleted if it has not been taken.
+DocumentLoader::~DocumentLoader() {
+  if (m_thread != nullptr) {
+    m_progress.cancel();
+    m_thread->join();
+  }
+}
+
+Glib::ustring DocumentLoader::get_uri() const {
+  return m_uri;
+}
+
+Glib::ustring DocumentLoader::get_charset() const {
+  return m_charset;
+}
+
+// The progress of the reading (fraction of the file).
+TaskProgress &DocumentLoader::get_progress() {
+  return m_progress;
+}
+
+// Start the thread.
+void DocumentLoader::start() {
+  se_dbg_msg(SE_DBG_APP, "uri=%s charset=%s", m_uri.c_str(),
+             m_charset.c_str());
+
+  g_return_if_fail(m_thread == nullptr && !m_finished);
+
+  m_thread = Glib::Threads::Thread::create(
+      sigc::mem_fun(*this, &DocumentLoader::run));
+}
+
+// Ask the thread to stop, signal_finished is still emitted.
+void DocumentLoader::cancel() {
+  m_progress.cancel();
+}
+
+// Return true when the thread is done (after signal_finished).
+bool DocumentLoader::is_finished() const {
+  return m_finished;
+}
+
+// Return the document, the caller owns it.
+// Exceptions: the exception of the thread.
+Document *DocumentLoader::take_document() {
+  g_return_val_if_fail(m_finished, nullptr);
+
+  if (m_error) {
+    std::exception_ptr error = m_error;
+    m_error = nullptr;
+    m_document.reset();
+    std::rethrow_exception(error);
+  }
+  // given to the main loop, it can be appended to se::documents
+  m_document->set_owned_by_worker(false);
+  return m_document.release();
+}
+
+// Emitted in the main loop when the thread is done.
+sigc::signal<void> &DocumentLoader::signal_finished() {
+  return m_signal_finished;
+}
+
+// The thread
+void DocumentLoader::run() {
+  try {
+    SubtitleFormatSystem::instance().open_from_uri(
+        m_document.get(), m_uri, m_charset, Glib::ustring(), &m_progress);
+    m_progress.set_fraction(1);
+  } catch (...) {
+    m_error = std::current_exception();
+  }
+  m_dispatcher.emit();
+}
+
+// Called in the main loop by the dispatcher.
+void DocumentLoader::on_thread_finished() {
+  se_dbg_msg(SE_DBG_APP, "uri=%s", m_uri.c_str());
+
+  m_thread->join();
+  m_thread = nullptr;
+  m_finished = true;
+
+  m_signal_finished.emit();
+}
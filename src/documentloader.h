@@ -0,0 +1,91 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <glibmm.h>
+#include <exception>
+#include <memory>
+#include "document.h"
+#include "taskprogress.h"
+
+// Open a document on a thread.
+// The document is created without view by the main loop, read and parsed by
+// the thread, then given back in the main loop by signal_finished.
+// The thread reads and writes the configuration only through cfg, which is
+// locked and emits its signals in the main loop.
+// ex:
+//   loader->signal_finished().connect(...);
+//   loader->start();
+//   ...
+//   Document *doc = loader->take_document();  // in the finished callback
+class DocumentLoader {
+ public:
+  // If charset is empty, the automatically detection is used.
+  DocumentLoader(const Glib::ustring &uri, const Glib::ustring &charset);
+
+  // Cancel and wait the end of the thread.
+  // The document is deleted if it has not been taken.
+  ~DocumentLoader();
+
+  Glib::ustring get_uri() const;
+
+  Glib::ustring get_charset() const;
+
+  // The progress of the reading (fraction of the file).
+  TaskProgress &get_progress();
+
+  // Start the thread.
+  void start();
+
+  // Ask the thread to stop, signal_finished is still emitted.
+  void cancel();
+
+  // Return true when the thread is done (after signal_finished).
+  bool is_finished() const;
+
+  // Return the document, the caller owns it. It is no longer owned by a
+  // worker, the global signals are emitted.
+  // Exceptions: the exception of the thread (UnrecognizeFormatError,
+  // EncodingConvertError, IOFileError, CancelledError, Glib::Error...)
+  Document *take_document();
+
+  // Emitted in the main loop when the thread is done.
+  sigc::signal<void> &signal_finished();
+
+ protected:
+  // The thread
+  void run();
+
+  // Called in the main loop by the dispatcher.
+  void on_thread_finished();
+
+ protected:
+  Glib::ustring m_uri;
+  Glib::ustring m_charset;
+  TaskProgress m_progress;
+  std::unique_ptr<Document> m_document;
+  // The exception of the thread
+  std::exception_ptr m_error;
+  Glib::Threads::Thread *m_thread{nullptr};
+  Glib::Dispatcher m_dispatcher;
+  bool m_finished{false};
+  sigc::signal<void> m_signal_finished;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtkmm/treemodel.h>
+#include <vector>
+
+namespace Gtk {
+class Widget;
+}
+
+// The view of a document (SubtitleView) seen by the document.
+// A document doesn't need a view, the user interface creates it and calls
+// Document::attach_view. Without view the document doesn't use any widget,
+// it can be created and used outside the main thread (convert, loading...).
+// The selection of the subtitles belongs to the view, without view it's
+// always empty.
+class DocumentView {
+ public:
+  virtual ~DocumentView() {
+  }
+
+  // Return the widget of the view.
+  virtual Gtk::Widget *widget() = 0;
+
+  // Return the selected rows.
+  virtual std::vector<Gtk::TreeModel::Path> get_selected_rows() = 0;
+
+  virtual void select_row(const Gtk::TreeIter &iter) = 0;
+  virtual void select_row(const Gtk::TreeModel::Path &path) = 0;
+  virtual void unselect_row(const Gtk::TreeIter &iter) = 0;
+  virtual bool is_row_selected(const Gtk::TreeIter &iter) = 0;
+  virtual void select_all_rows() = 0;
+  virtual void unselect_all_rows() = 0;
+
+  // Select the row and set the cursor on it.
+  virtual void select_and_set_cursor(const Gtk::TreeIter &iter,
+                                     bool start_editing = false) = 0;
+
+  // Return the name of the current column focus.
+  // (start, end, duration, text, translation ...)
+  virtual Glib::ustring get_current_column_name() = 0;
+
+  // Detach the model from the view (bulk edit).
+  // The selection and the cursor are kept.
+  virtual void detach_model() = 0;
+
+  // Attach again the model and restore the selection and the cursor.
+  virtual void attach_model() = 0;
+};
@@ -18,6 +18,11 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include "cfg.h"
 #include "encodings.h"
 #include "error.h"
@@ -139,70 +144,341 @@ EncodingInfo *Encodings::get_encodings_info() {
   return encodings_info;
 }
 
+// Detection of the charset by statistics.
+// Each candidate decodes a sample of the contents, the decoded characters are
+// scored (common letters, coherent words and case, unusual symbols...) and
+// only the best charset is used to convert the whole contents.
+
+// Size of the sample used by the detection
+static const gsize DETECTION_SAMPLE_SIZE = 64 * 1024;
+
+// Return a set of the characters of the UTF-8 string.
+static std::unordered_set<gunichar> make_char_set(const char *chars) {
+  std::unordered_set<gunichar> set;
+  for (const char *p = chars; *p; p = g_utf8_next_char(p)) {
+    set.insert(g_utf8_get_char(p));
+  }
+  return set;
+}
+
+// Accented latin letters frequently used (lowercase).
+static const std::unordered_set<gunichar> &common_latin_letters() {
+  static const auto set = make_char_set(
+      "éèàáíóúçñüöäßêôâãõåøæ"
+      "čšžřěýłąęśćżńůışğ");
+  return set;
+}
+
+// The most frequent letters of the other alphabets (cyrillic, greek, hebrew,
+// arabic and thai).
+static const std::unordered_set<gunichar> &frequent_letters() {
+  static const auto set = make_char_set(
+      "оеаинтсрвлОЕАИНТСРВЛ"
+      "αοιετνσςηκυπΑΟΙΕΤΝΣΗΚΥΠ"
+      "יוהלאמרתבשנ"
+      "اليمونهربتع"
+      "านรอกเงมยลวด");
+  return set;
+}
+
+// The most frequent chinese, japanese and korean characters.
+static const std::unordered_set<gunichar> &frequent_cjk_chars() {
+  static const auto set = make_char_set(
+      "的是不了我你一在人有这他们个"
+      "来到说就要那么好也会没看吗什"
+      "のにはをたがでてとしいなれる"
+      "かもすこ"
+      "이다는의에가고을를하한지요세"
+      "니습서어나게도로안있그아사해"
+      "수거것네");
+  return set;
+}
+
+// Punctuation used in subtitles.
+static const std::unordered_set<gunichar> &common_punctuation() {
+  static const auto set = make_char_set("…–—‘’‚“”„«»¿¡°·•€♪©®™‹›");
+  return set;
+}
+
+// Chinese, japanese and korean are scored as one script.
+static bool is_cjk_script(GUnicodeScript script) {
+  return script == G_UNICODE_SCRIPT_HAN ||
+         script == G_UNICODE_SCRIPT_HIRAGANA ||
+         script == G_UNICODE_SCRIPT_KATAKANA ||
+         script == G_UNICODE_SCRIPT_HANGUL;
+}
+
+static GUnicodeScript get_script(gunichar c) {
+  GUnicodeScript script = g_unichar_get_script(c);
+  return is_cjk_script(script) ? G_UNICODE_SCRIPT_HAN : script;
+}
+
+static bool is_non_ascii_latin(gunichar c) {
+  return c >= 0x80 && g_unichar_isalpha(c) &&
+         g_unichar_get_script(c) == G_UNICODE_SCRIPT_LATIN;
+}
+
+// Score the decoded sample, higher is better. count is the number of non
+// ASCII characters.
+// Return false if the sample contains characters which are never used in a
+// text (controls, private use or unassigned).
+static bool score_sample(const std::string &utf8, long &score, long &count) {
+  const auto &latin = common_latin_letters();
+  const auto &letters = frequent_letters();
+  const auto &cjk = frequent_cjk_chars();
+  const auto &punctuation = common_punctuation();
+
+  std::vector<gunichar> chars;
+  chars.reserve(utf8.size());
+  const char *end = utf8.data() + utf8.size();
+  for (const char *p = utf8.data(); p < end; p = g_utf8_next_char(p)) {
+    chars.push_back(g_utf8_get_char(p));
+  }
+
+  score = 0;
+  count = 0;
+  for (gsize i = 0; i < chars.size(); ++i) {
+    gunichar c = chars[i];
+    gunichar prev = (i > 0) ? chars[i - 1] : ' ';
+    gunichar next = (i + 1 < chars.size()) ? chars[i + 1] : ' ';
+
+    // An uppercase letter inside a word (the lowercase and uppercase ranges
+    // are swapped in a wrong charset)
+    if ((c >= 0x80 || prev >= 0x80) && g_unichar_isupper(c) &&
+        g_unichar_islower(prev))
+      score -= 2;
+
+    if (c < 0x80)
+      continue;
+    ++count;
+
+    GUnicodeType type = g_unichar_type(c);
+    if (type == G_UNICODE_CONTROL || type == G_UNICODE_PRIVATE_USE ||
+        type == G_UNICODE_UNASSIGNED || type == G_UNICODE_SURROGATE ||
+        c == 0xFFFD)
+      return false;
+
+    if (g_unichar_isalpha(c)) {
+      // Half-width katakana
+      if (c >= 0xFF61 && c <= 0xFF9F) {
+        score -= 1;
+        continue;
+      }
+      GUnicodeScript script = get_script(c);
+      if (script == G_UNICODE_SCRIPT_LATIN) {
+        score += latin.count(g_unichar_tolower(c)) ? 2 : 1;
+        // Accented letters are rarely next to each other
+        score -= is_non_ascii_latin(prev) + is_non_ascii_latin(next);
+      } else {
+        if (script == G_UNICODE_SCRIPT_HAN)
+          score += cjk.count(c) ? 5 : 2;
+        else
+          score += letters.count(c) ? 3 : 1;
+        // The letters of a word have the same script
+        if (g_unichar_isalpha(prev) && get_script(prev) != script)
+          score -= 2;
+        if (g_unichar_isalpha(next) && get_script(next) != script)
+          score -= 2;
+      }
+    } else if (g_unichar_ismark(c) || g_unichar_isspace(c)) {
+      continue;
+    } else if (punctuation.count(c) || (c >= 0x3000 && c <= 0x303F) ||
+               (c >= 0xFF01 && c <= 0xFF5E)) {
+      score += 1;
+    } else {
+      // Unusual symbol or number
+      score -= 3;
+    }
+  }
+  return true;
+}
+
+// Convert the sample to UTF-8, an incomplete character at the end is ignored.
+// Return false if the sample is not valid in the charset.
+static bool convert_sample(const char *data, gsize size, const char *charset,
+                           std::string &utf8) {
+  GIConv cd = g_iconv_open("UTF-8", charset);
+  if (cd == reinterpret_cast<GIConv>(-1))
+    return false;
+
+  utf8.resize(size * 4 + 16);
+  gchar *in = const_cast<gchar *>(data);
+  gsize in_left = size;
+  gchar *out = &utf8[0];
+  gsize out_left = utf8.size();
+
+  bool valid = (g_iconv(cd, &in, &in_left, &out, &out_left) !=
+                static_cast<gsize>(-1)) ||
+               errno == EINVAL;
+  g_iconv_close(cd);
+
+  utf8.resize(out - utf8.data());
+  return valid;
+}
+
+// The score is plausible if the non ASCII characters are mostly common
+// letters and punctuation, a wrong charset gives unusual symbols, mixed
+// scripts and case.
+static bool is_plausible_score(long score, long count) {
+  return score > 0 && score * 2 >= count;
+}
+
+// UTF-8 is already checked, the others need a BOM.
+static bool is_detectable_charset(const Glib::ustring &charset) {
+  return charset != "UTF-8" && charset != "UTF-7" && charset != "UTF-16" &&
+         charset != "UCS-2" && charset != "UCS-4";
+}
+
+// Return the charset detected on a sample of the contents, or an empty
+// string if no charset gives a plausible text. The first user encodings
+// preference which gives a plausible text is used, otherwise the charset
+// which gives the best score.
+static Glib::ustring detect_charset(const char *data, gsize size) {
+  // Byte order mark
+  if (size >= 2 && ((guchar(data[0]) == 0xFF && guchar(data[1]) == 0xFE) ||
+                    (guchar(data[0]) == 0xFE && guchar(data[1]) == 0xFF)))
+    return "UTF-16";
+
+  gsize sample_size = std::min(size, DETECTION_SAMPLE_SIZE);
+  std::unordered_set<std::string> tried;
+  std::string utf8;
+  long score = 0;
+  long count = 0;
+
+  for (const auto &charset : cfg::get_string_list("encodings", "encodings")) {
+    if (!is_detectable_charset(charset) || !tried.insert(charset.raw()).second)
+      continue;
+
+    if (!convert_sample(data, sample_size, charset.c_str(), utf8) ||
+        !score_sample(utf8, score, count))
+      continue;
+
+    se_dbg_msg(SE_DBG_UTILITY, "user charset %s score %ld (%ld characters)",
+               charset.c_str(), score, count);
+
+    if (is_plausible_score(score, count))
+      return charset;
+  }
+
+  Glib::ustring best;
+  long best_score = 0;
+  long best_count = 0;
+
+  for (unsigned int i = 0; encodings_info[i].name != NULL; ++i) {
+    Glib::ustring charset = encodings_info[i].charset;
+    if (!is_detectable_charset(charset) || !tried.insert(charset.raw()).second)
+      continue;
+
+    if (!convert_sample(data, sample_size, charset.c_str(), utf8) ||
+        !score_sample(utf8, score, count))
+      continue;
+
+    se_dbg_msg(SE_DBG_UTILITY, "charset %s score %ld (%ld characters)",
+               charset.c_str(), score, count);
+
+    if (best.empty() || score > best_score) {
+      best = charset;
+      best_score = score;
+      best_count = count;
+    }
+  }
+
+  if (best.empty() || !is_plausible_score(best_score, best_count))
+    return Glib::ustring();
+  return best;
+}
+
 namespace Encoding {
 
 // Trying to convert from charset to UTF-8.
 // Return utf8 string or throw EncodingConvertError exception.
 Glib::ustring convert_to_utf8_from_charset(const std::string &content,
                                            const Glib::ustring &charset) {
+  return convert_to_utf8_from_charset(content.data(), content.size(),
+                                      charset);
+}
+
+// Same as above from [data, data + size), avoid a copy of the raw contents.
+Glib::ustring convert_to_utf8_from_charset(const char *data, gsize size,
+                                           const Glib::ustring &charset) {
   se_dbg_msg(SE_DBG_UTILITY, "Trying to convert from %s to UTF-8",
              charset.c_str());
 
   // Only if it's UTF-8 to UTF-8
   if (charset == "UTF-8") {
-    if (Glib::ustring(content).validate() == false)
+    if (g_utf8_validate(data, size, NULL) == FALSE)
       throw EncodingConvertError(_("It's not valid UTF-8."));
 
-    return content;
-  } else {
-    try {
-      Glib::ustring utf8_content = Glib::convert(content, "UTF-8", charset);
-
-      if (!utf8_content.validate() || utf8_content.empty())
-        throw EncodingConvertError(build_message(
-            _("Couldn't convert from %s to UTF-8"), charset.c_str()));
+    return Glib::ustring(data, data + size);
+  }
 
-      return utf8_content;
-    } catch (const Glib::ConvertError &ex) {
-      se_dbg_msg(SE_DBG_UTILITY, "Glib::ConvertError: %s", ex.what().c_str());
-      throw EncodingConvertError(build_message(
-          _("Couldn't convert from %s to UTF-8"), charset.c_str()));
-    } catch (...) {
-      se_dbg_msg(SE_DBG_UTILITY, "Unknow error");
-      throw EncodingConvertError(build_message(
-          _("Couldn't convert from %s to UTF-8"), charset.c_str()));
-    }
+  GError *error = NULL;
+  gsize bytes_written = 0;
+  gchar *converted = g_convert(data, size, "UTF-8", charset.c_str(), NULL,
+                               &bytes_written, &error);
+  if (converted == NULL) {
+    se_dbg_msg(SE_DBG_UTILITY, "g_convert: %s",
+               error ? error->message : "Unknow error");
+    if (error)
+      g_error_free(error);
+    throw EncodingConvertError(build_message(
+        _("Couldn't convert from %s to UTF-8"), charset.c_str()));
   }
+
+  Glib::ustring utf8_content(converted, converted + bytes_written);
+  g_free(converted);
+
+  if (!utf8_content.validate() || utf8_content.empty())
+    throw EncodingConvertError(build_message(
+        _("Couldn't convert from %s to UTF-8"), charset.c_str()));
+
+  return utf8_content;
 }
 
 // Trying to autodetect the charset and convert to UTF-8.
-// 3 steps:
+// 4 steps:
 // - Try UTF-8
+// - Detect the charset from a sample (statistics)
 // - Try with user encoding preferences
 // - Try with all encodings
 // Return utf8 string and sets charset found
 // or throw EncodingConvertError exception.
 Glib::ustring convert_to_utf8(const std::string &content,
                               Glib::ustring &charset) {
-  if (content.empty())
+  return convert_to_utf8(content.data(), content.size(), charset);
+}
+
+// Same as above from [data, data + size), avoid a copy of the raw contents.
+Glib::ustring convert_to_utf8(const char *data, gsize size,
+                              Glib::ustring &charset) {
+  if (size == 0)
     return Glib::ustring();
 
   // First check if it's not UTF-8.
   se_dbg_msg(SE_DBG_UTILITY, "Trying to UTF-8...");
 
-  try {
-    Glib::ustring utf8_content =
-        Encoding::convert_to_utf8_from_charset(content, "UTF-8");
+  if (g_utf8_validate(data, size, NULL)) {
+    charset = "UTF-8";
+    return Glib::ustring(data, data + size);
+  }
 
-    if (utf8_content.validate() && utf8_content.empty() == false) {
-      charset = "UTF-8";
-      return content;
+  // Try to detect the encoding on a sample, only one conversion of the whole
+  // contents.
+  Glib::ustring detected = detect_charset(data, size);
+  if (!detected.empty()) {
+    se_dbg_msg(SE_DBG_UTILITY, "Detected charset: %s", detected.c_str());
+    try {
+      Glib::ustring utf8_content =
+          convert_to_utf8_from_charset(data, size, detected);
+      charset = detected;
+      return utf8_content;
+    } catch (const EncodingConvertError &ex) {
+      // invalid after the sample, try all the encodings...
+      se_dbg_msg(SE_DBG_UTILITY, "EncodingConvertError: %s", ex.what());
     }
-  } catch (const EncodingConvertError &ex) {
-    se_dbg_msg(SE_DBG_UTILITY, "EncodingConvertError: %s", ex.what());
   }
 
-  // Try to automatically dectect the encoding
+  // Try to automatically dectect the encoding by conversion
 
   // With the user charset preferences...
   se_dbg_msg(SE_DBG_UTILITY, "Trying with user encodings preferences...");
@@ -211,7 +487,8 @@ Glib::ustring convert_to_utf8(const std::string &content,
 
   for (const auto &enc : user_encodings) {
     try {
-      Glib::ustring utf8_content = convert_to_utf8_from_charset(content, enc);
+      Glib::ustring utf8_content =
+          convert_to_utf8_from_charset(data, size, enc);
 
       if (utf8_content.validate() && utf8_content.empty() == false) {
         charset = enc;
@@ -231,7 +508,7 @@ Glib::ustring convert_to_utf8(const std::string &content,
 
     try {
       Glib::ustring utf8_content =
-          Encoding::convert_to_utf8_from_charset(content, it);
+          Encoding::convert_to_utf8_from_charset(data, size, it);
 
       if (utf8_content.validate() && utf8_content.empty() == false) {
         charset = it;
@@ -52,9 +52,14 @@ namespace Encoding {
 Glib::ustring convert_to_utf8_from_charset(const std::string &content,
                                            const Glib::ustring &charset);
 
+// Same as above from [data, data + size), avoid a copy of the raw contents.
+Glib::ustring convert_to_utf8_from_charset(const char *data, gsize size,
+                                           const Glib::ustring &charset);
+
 // Trying to autodetect the charset and convert to UTF-8.
-// 3 steps:
+// 4 steps:
 // - Try UTF-8
+// - Detect the charset from a sample (statistics)
 // - Try with user encoding preferences
 // - Try with all encodings
 // Return utf8 string and sets charset found
@@ -62,6 +67,10 @@ Glib::ustring convert_to_utf8_from_charset(const std::string &content,
 Glib::ustring convert_to_utf8(const std::string &content,
                               Glib::ustring &charset);
 
+// Same as above from [data, data + size), avoid a copy of the raw contents.
+Glib::ustring convert_to_utf8(const char *data, gsize size,
+                              Glib::ustring &charset);
+
 // Convert the UTF-8 text to the charset.
 // Throw EncodingConvertError exception.
 std::string convert_from_utf8_to_charset(const Glib::ustring &utf8_content,
@@ -56,3 +56,10 @@ class EncodingConvertError : public SubtitleError {
   explicit EncodingConvertError(const std::string &msg) : SubtitleError(msg) {
   }
 };
+
+// The task has been cancelled by the user (TaskProgress).
+class CancelledError : public SubtitleError {
+ public:
+  explicit CancelledError(const std::string &msg) : SubtitleError(msg) {
+  }
+};
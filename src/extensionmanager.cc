@@ -75,6 +75,22 @@ void ExtensionManager::create_extensions() {
   }
 }
 
+// Active and create only the extensions of the categorie, used without
+// user interface (ex: "subtitleformat").
+void ExtensionManager::create_extensions(const Glib::ustring &categorie) {
+  se_dbg_msg(SE_DBG_APP, "categorie='%s'", categorie.c_str());
+
+  for (const auto &ext_info : get_info_list_from_categorie(categorie)) {
+    // Disabled by the user
+    if (cfg::has_key("extension-manager", ext_info->get_name()) &&
+        cfg::get_string("extension-manager", ext_info->get_name()) != "enable")
+      continue;
+
+    if (!ext_info->get_active())
+      activate(ext_info);
+  }
+}
+
 // Delete and close all extensions
 void ExtensionManager::destroy_extensions() {
   se_dbg(SE_DBG_APP);
@@ -243,8 +259,12 @@ std::list<ExtensionInfo *> ExtensionManager::get_extension_info_list() {
 // Return all ExtensionInfo in the categorie.
 std::list<ExtensionInfo *> ExtensionManager::get_info_list_from_categorie(
     const Glib::ustring &categorie) {
-  // FIXME
-  std::list<ExtensionInfo *> list = m_extension_info_map[categorie];
+  // Don't insert an empty categorie, the map is read by many threads
+  // (subtitleeditor-convert)
+  std::list<ExtensionInfo *> list;
+  auto it = m_extension_info_map.find(categorie);
+  if (it != m_extension_info_map.end())
+    list = it->second;
   se_dbg_msg(SE_DBG_APP, "categorie='%s' size='%d'", categorie.c_str(),
              list.size());
 
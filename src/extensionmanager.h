@@ -45,6 +45,10 @@ class ExtensionManager {
   // Active and create extensions
   void create_extensions();
 
+  // Active and create only the extensions of the categorie, used without
+  // user interface (ex: "subtitleformat").
+  void create_extensions(const Glib::ustring &categorie);
+
   // Delete and close all extensions
   void destroy_extensions();
 
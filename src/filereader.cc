@@ -24,64 +24,53 @@
 #include "error.h"
 #include "filereader.h"
 
-// Reads an entire file into a string, with good error checking.
-// If charset is empty, auto detection is try.
-bool get_contents_from_file(const Glib::ustring &uri,
-                            const Glib::ustring &charset,
-                            Glib::ustring &utf8_contents,
-                            Glib::ustring &charset_contents,
-                            int max_data_size) {
-  se_dbg_msg(SE_DBG_IO, "Try to get contents from file uri=%s with charset=%s",
-             uri.c_str(), charset.c_str());
-
-  try {
-    Glib::ustring content;
-
-    {
-      Glib::RefPtr<Gio::File> file = Gio::File::create_for_uri(uri);
-      if (!file)
-        throw IOFileError(_("Couldn't open the file."));
-
-      gchar *raw = NULL;
-      gsize bytes_read = 0;
-      std::string e_tag;
-
-      if (file->load_contents(raw, bytes_read, e_tag) == false)
-        throw IOFileError(_("Couldn't read the contents of the file."));
-
-      content = std::string(raw, bytes_read);
-
-      g_free(raw);
+// Return the raw contents of the file.
+// A local file is mapped in memory, otherwise it's loaded with gio.
+// Throw an IOFileError exception if failed.
+static GBytes *get_contents_from_file(const Glib::ustring &uri) {
+  Glib::RefPtr<Gio::File> file = Gio::File::create_for_uri(uri);
+  if (!file)
+    throw IOFileError(_("Couldn't open the file."));
+
+  std::string path = file->get_path();
+  if (!path.empty()) {
+    GError *error = NULL;
+    GMappedFile *mapped = g_mapped_file_new(path.c_str(), FALSE, &error);
+    if (mapped != NULL) {
+      se_dbg_msg(SE_DBG_IO, "file mapped: %s", path.c_str());
+      GBytes *bytes = g_mapped_file_get_bytes(mapped);
+      g_mapped_file_unref(mapped);
+      return bytes;
     }
+    // Try with gio
+    se_dbg_msg(SE_DBG_IO, "Couldn't map the file: %s", error->message);
+    g_error_free(error);
+  }
 
-    if (max_data_size > 0) {
-      if (content.size() > max_data_size)
-        content = content.substr(0, max_data_size);
-    }
-
-    if (charset.empty()) {
-      // Try to autodetect
-      utf8_contents = Encoding::convert_to_utf8(content, charset_contents);
-
-      se_dbg_msg(SE_DBG_IO,
-                 "Success to get the contents of the file %s with %s charset",
-                 uri.c_str(), charset_contents.c_str());
-
-      return true;
-    } else {
-      // try with charset
-      utf8_contents = Encoding::convert_to_utf8_from_charset(content, charset);
+  gchar *raw = NULL;
+  gsize bytes_read = 0;
+  std::string e_tag;
 
-      se_dbg_msg(SE_DBG_IO,
-                 "Success to get the contents of the file %s with %s charset",
-                 uri.c_str(), charset.c_str());
-      return true;
-    }
-  } catch (const std::exception &ex) {
+  try {
+    if (file->load_contents(raw, bytes_read, e_tag) == false)
+      throw IOFileError(_("Couldn't read the contents of the file."));
+  } catch (const Glib::Error &ex) {
     throw IOFileError(ex.what());
   }
+  return g_bytes_new_take(raw, bytes_read);
+}
 
-  return false;
+// Return the size to read, cut at a UTF-8 character if the data is truncated.
+static gsize get_data_size(const char *data, gsize size, int max_data_size) {
+  if (max_data_size <= 0 || size <= static_cast<gsize>(max_data_size))
+    return size;
+
+  size = max_data_size;
+  // Don't split the last character (only used by the detection of the format)
+  const gchar *end = NULL;
+  if (!g_utf8_validate(data, size, &end) && end + 4 > data + size)
+    size = end - data;
+  return size;
 }
 
 // Constructor.
@@ -91,13 +80,52 @@ bool get_contents_from_file(const Glib::ustring &uri,
 FileReader::FileReader(const Glib::ustring &uri, const Glib::ustring &charset,
                        int max_data_size)
     : Reader(), m_charset("UTF-8") {
-  if (get_contents_from_file(uri, charset, m_data, m_charset, max_data_size) ==
-      false)
-    return;
+  se_dbg_msg(SE_DBG_IO, "Try to get contents from file uri=%s with charset=%s",
+             uri.c_str(), charset.c_str());
+
+  m_contents = get_contents_from_file(uri);
+
+  gsize size = 0;
+  const char *data =
+      static_cast<const char *>(g_bytes_get_data(m_contents, &size));
+  size = get_data_size(data, size, max_data_size);
+
+  try {
+    if ((charset.empty() || charset == "UTF-8") &&
+        g_utf8_validate(data, size, NULL)) {
+      // Already UTF-8, read the contents without copy
+      set_data(data, size);
+    } else {
+      if (charset.empty())
+        m_data = Encoding::convert_to_utf8(data, size, m_charset);
+      else
+        m_data = Encoding::convert_to_utf8_from_charset(data, size, charset);
+      set_data();
+      // The raw contents are no longer needed
+      g_bytes_unref(m_contents);
+      m_contents = nullptr;
+      if (!charset.empty())
+        m_charset = charset;
+    }
+  } catch (const std::exception &ex) {
+    g_bytes_unref(m_contents);
+    m_contents = nullptr;
+    throw IOFileError(ex.what());
+  }
+
+  se_dbg_msg(SE_DBG_IO,
+             "Success to get the contents of the file %s with %s charset",
+             uri.c_str(), m_charset.c_str());
 
   m_uri = uri;
 }
 
+// Destructor, release the contents of the file.
+FileReader::~FileReader() {
+  if (m_contents)
+    g_bytes_unref(m_contents);
+}
+
 // Return the uri of the file.
 Glib::ustring FileReader::get_uri() const {
   return m_uri;
@@ -21,7 +21,6 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <glibmm.h>
-#include <sstream>
 #include <string>
 #include "reader.h"
 
@@ -29,6 +28,8 @@
 // Can automatically detect the character coding and convert to UTF-8.
 // Detect the newline type.
 // Return lines without character of newline (CR,LF or CRLF)
+// A local file is mapped in memory, if it's already UTF-8 the lines are read
+// from the mapping without copy. Otherwise the contents are converted once.
 class FileReader : public Reader {
  public:
   // Constructor.
@@ -38,6 +39,9 @@ class FileReader : public Reader {
   FileReader(const Glib::ustring &uri, const Glib::ustring &charset,
              int max_data_size = -1);
 
+  // Destructor, release the contents of the file.
+  ~FileReader();
+
   // Return the uri of the file.
   Glib::ustring get_uri() const;
 
@@ -47,4 +51,6 @@ class FileReader : public Reader {
  protected:
   Glib::ustring m_uri;
   Glib::ustring m_charset;
+  // The raw contents of the file (mapped or loaded)
+  GBytes *m_contents{nullptr};
 };
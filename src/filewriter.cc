@@ -18,50 +18,198 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-#include <giomm.h>
+#include <cerrno>
+#include <cstring>
 #include "debug.h"
 #include "encodings.h"
 #include "error.h"
 #include "filewriter.h"
+#include "utility.h"
+
+// Size of the chunks written to the file
+static const gsize CHUNK_SIZE = 64 * 1024;
+
+static const GIConv INVALID_ICONV = reinterpret_cast<GIConv>(-1);
 
 FileWriter::FileWriter(const Glib::ustring &uri, const Glib::ustring &charset,
-                       const Glib::ustring &newline) {
+                       const Glib::ustring &newline)
+    : m_iconv(INVALID_ICONV) {
   m_uri = uri;
   m_charset = charset;
   m_newline = newline;
+
+  m_buffer.reserve(CHUNK_SIZE * 2);
+
+  if (m_charset != "UTF-8") {
+    m_iconv = g_iconv_open(m_charset.c_str(), "UTF-8");
+    if (m_iconv == INVALID_ICONV)
+      throw EncodingConvertError(build_message(
+          _("Could not convert the text to the character coding '%s'"),
+          m_charset.c_str()));
+    m_converted.resize(CHUNK_SIZE);
+  }
 }
 
-// Write to the file.
-// Error: throw an IOFileError exception if failed.
-void FileWriter::to_file() {
-  // Convert newline if needs
-  if (m_newline != "Unix")
-    m_data = Glib::Regex::create("\n")->replace(
-        m_data, 0, (m_newline == "Windows") ? "\r\n" : "\r",
-        (Glib::RegexMatchFlags)0);
+// Without to_file(), the file is not changed.
+FileWriter::~FileWriter() {
+  cancel();
+
+  if (m_iconv != INVALID_ICONV)
+    g_iconv_close(m_iconv);
+}
+
+// Close the stream without replacing the file, remove the file if it has been
+// created by this writer.
+void FileWriter::cancel() {
+  if (!m_stream)
+    return;
+
+  se_dbg_msg(SE_DBG_IO, "Cancel the writing of the file '%s'", m_uri.c_str());
+
+  // Abort the replace, the temporary file is removed
+  try {
+    Glib::RefPtr<Gio::Cancellable> cancellable = Gio::Cancellable::create();
+    cancellable->cancel();
+    m_stream->close(cancellable);
+  } catch (const Glib::Error &ex) {
+    // expected (cancelled)
+  }
+  m_stream.reset();
+
+  if (!m_created)
+    return;
+
+  m_created = false;
+  try {
+    m_file->remove();
+  } catch (const Glib::Error &ex) {
+    se_dbg_msg(SE_DBG_IO, "Failed to remove the file '%s': %s", m_uri.c_str(),
+               ex.what().c_str());
+  }
+}
+
+// Convert the newline and write the data by chunks.
+void FileWriter::append(const char *data, gsize size) {
+  if (m_newline == "Unix") {
+    m_buffer.append(data, size);
+  } else {
+    const char *newline = (m_newline == "Windows") ? "\r\n" : "\r";
+    const char *end = data + size;
+    while (data < end) {
+      const char *lf =
+          static_cast<const char *>(std::memchr(data, '\n', end - data));
+      if (lf == NULL) {
+        m_buffer.append(data, end);
+        break;
+      }
+      m_buffer.append(data, lf);
+      m_buffer.append(newline);
+      data = lf + 1;
+    }
+  }
+
+  if (m_buffer.size() >= CHUNK_SIZE)
+    flush(false);
+}
 
+// Convert the buffer to the charset and write it to the stream.
+// An incomplete character is kept for the next chunk except at the end.
+void FileWriter::flush(bool end) {
+  if (m_iconv == INVALID_ICONV) {
+    output(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+    return;
+  }
+
+  gchar *in = &m_buffer[0];
+  gsize in_left = m_buffer.size();
+  for (;;) {
+    gchar *out = &m_converted[0];
+    gsize out_left = m_converted.size();
+    gsize res = g_iconv(m_iconv, &in, &in_left, &out, &out_left);
+    int error = errno;
+    output(m_converted.data(), out - m_converted.data());
+
+    if (res != static_cast<gsize>(-1))
+      break;
+    if (error == E2BIG)
+      continue;
+    if (error == EINVAL && !end)
+      break;
+    throw EncodingConvertError(build_message(
+        _("Could not convert the text to the character coding '%s'"),
+        m_charset.c_str()));
+  }
+  m_buffer.erase(0, m_buffer.size() - in_left);
+
+  if (end) {
+    // Reset the state of the charset (stateful encodings)
+    gchar *out = &m_converted[0];
+    gsize out_left = m_converted.size();
+    g_iconv(m_iconv, NULL, NULL, &out, &out_left);
+    output(m_converted.data(), out - m_converted.data());
+  }
+}
+
+// Write the bytes to the stream, open it if needs.
+void FileWriter::output(const char *data, gsize size) {
+  try {
+    if (!m_stream) {
+      m_file = Gio::File::create_for_uri(m_uri);
+      if (!m_file)
+        throw IOFileError(_("Couldn't open the file."));
+
+      // The contents of an existing file are written to a temporary file
+      // renamed on close. A new file is written directly, it's removed by
+      // cancel().
+      bool exists = m_file->query_exists();
+      m_stream = exists ? m_file->replace() : m_file->create_file();
+      if (!m_stream)
+        throw IOFileError("Gio::File could not create stream.");
+      m_created = !exists;
+    }
+
+    if (size > 0) {
+      gsize bytes_written = 0;
+      m_stream->write_all(data, size, bytes_written);
+    }
+  } catch (const Glib::Error &ex) {
+    throw IOFileError(ex.what());
+  }
+}
+
+// Write the end of the data and replace the file. On failure the file is not
+// changed, or removed if it has been created.
+// Error: throw an EncodingConvertError exception if the text can't be
+// converted to the charset or an IOFileError exception if failed.
+void FileWriter::to_file() {
   try {
-    std::string content =
-        Encoding::convert_from_utf8_to_charset(m_data, m_charset);
-    Glib::RefPtr<Gio::File> file = Gio::File::create_for_uri(m_uri);
-    if (!file)
-      throw IOFileError(_("Couldn't open the file."));
-
-    Glib::RefPtr<Gio::FileOutputStream> stream =
-        (file->query_exists()) ? file->replace() : file->create_file();
-    if (!stream)
-      throw IOFileError("Gio::File could not create stream.");
-
-    stream->write(content);
+    flush(true);
+    // Open the stream even if the file is empty
+    output(NULL, 0);
+
     // Close the stream to make sure that changes are written now
-    stream->close();
-    stream.reset();
+    m_stream->close();
+    m_stream.reset();
 
     se_dbg_msg(
         SE_DBG_IO,
         "Success to write the contents on the file '%s' with '%s' charset",
         m_uri.c_str(), m_charset.c_str());
+  } catch (const Glib::Error &ex) {
+    cancel();
+    se_dbg_msg(
+        SE_DBG_IO,
+        "Failed to write the contents on the file '%s' with '%s' charset",
+        m_uri.c_str(), m_charset.c_str());
+    throw IOFileError(ex.what());
+  } catch (const EncodingConvertError &ex) {
+    cancel();
+    se_dbg_msg(SE_DBG_IO, "Failed to convert the contents to '%s' charset",
+               m_charset.c_str());
+    throw;
   } catch (const std::exception &ex) {
+    cancel();
     se_dbg_msg(
         SE_DBG_IO,
         "Failed to write the contents on the file '%s' with '%s' charset",
@@ -20,22 +20,60 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <giomm.h>
+#include <string>
 #include "writer.h"
 
 // Helper to write a file.
 // Convert from UTF-8 to the character coding.
 // Convert Unix newline to Windows or Macintosh if need.
+// The data are streamed by chunks (iconv) to the file, the memory used
+// doesn't depend on the size of the document. The file is replaced only by
+// to_file(): an existing file is written to a temporary file and renamed
+// (Gio::File::replace), it's never left half written. A new file is removed
+// if the writing fails or without to_file().
 class FileWriter : public Writer {
  public:
   FileWriter(const Glib::ustring &uri, const Glib::ustring &charset,
              const Glib::ustring &newline);
 
-  // Write to the file.
-  // Error: throw an IOFileError exception if failed.
+  // Without to_file(), the file is not changed.
+  ~FileWriter();
+
+  // Write the end of the data and replace the file. On failure the file is
+  // not changed, or removed if it has been created.
+  // Error: throw an EncodingConvertError exception if the text can't be
+  // converted to the charset or an IOFileError exception if failed.
   void to_file();
 
+ protected:
+  // Convert the newline and write the data by chunks.
+  void append(const char *data, gsize size);
+
+  // Convert the buffer to the charset and write it to the stream.
+  // An incomplete character is kept for the next chunk except at the end.
+  void flush(bool end);
+
+  // Write the bytes to the stream, open it if needs.
+  void output(const char *data, gsize size);
+
+  // Close the stream without replacing the file, remove the file if it has
+  // been created by this writer.
+  void cancel();
+
  protected:
   Glib::ustring m_uri;
   Glib::ustring m_charset;
   Glib::ustring m_newline;
+
+  // The UTF-8 data not yet written
+  std::string m_buffer;
+  std::string m_converted;
+  // Invalid if the charset is UTF-8
+  GIConv m_iconv;
+
+  Glib::RefPtr<Gio::File> m_file;
+  Glib::RefPtr<Gio::FileOutputStream> m_stream;
+  // The file didn't exist, it's created by the stream
+  bool m_created{false};
 };
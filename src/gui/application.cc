@@ -24,6 +24,7 @@
 #include "application.h"
 #include "documents.h"
 #include "encodings.h"
+#include "subtitleview.h"
 #include "utility.h"
 
 #include "extension.h"
@@ -61,6 +62,9 @@ Application::Application(BaseObjectType *cobject,
   se::documents::signal_active_changed().connect(
       sigc::mem_fun(*this, &Application::on_active_document_changed));
 
+  m_statusbar->signal_cancel().connect(
+      sigc::mem_fun(*this, &Application::on_cancel_loaders));
+
   m_notebook_documents->signal_switch_page().connect(
       sigc::mem_fun(*this, &Application::on_signal_switch_page));
 
@@ -215,9 +219,14 @@ void Application::on_document_create(Document *doc) {
   Gtk::ScrolledWindow *scroll = NULL;
   Gtk::Widget *page = NULL;
 
+  // The view of the document
+  SubtitleView *view = manage(new SubtitleView(*doc));
+  view->show();
+  doc->attach_view(view);
+
   scroll = manage(new Gtk::ScrolledWindow);
   scroll->set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
-  scroll->add(*doc->widget());
+  scroll->add(*view);
   scroll->show();
 
   id = m_notebook_documents->append_page(*scroll, *hbox);
@@ -310,6 +319,9 @@ void Application::on_document_delete(Document *doc) {
   if (doc == NULL)
     return;
 
+  // The view is destroyed with the page
+  doc->attach_view(nullptr);
+
   Gtk::Widget *widget = get_widget(doc);
 
   if (widget != NULL)
@@ -468,22 +480,19 @@ void Application::init(OptionGroup &options) {
              options.files_list.begin(), options.files_list.end(),
              files.begin());
 
-  // files
+  // files, opened at the same time by threads
+  std::vector<Glib::ustring> uris;
   for (unsigned int i = 0; i < files.size(); ++i) {
     Glib::ustring filename = files[i];
 
     if (Glib::file_test(filename,
                         Glib::FILE_TEST_EXISTS | Glib::FILE_TEST_IS_REGULAR) &&
         Glib::file_test(filename, Glib::FILE_TEST_IS_DIR) == false) {
-      Glib::ustring uri =
-          Glib::filename_to_uri(utility::create_full_path(filename));
-
-      Document *doc = Document::create_from_file(uri, options.encoding);
-      if (doc) {
-        se::documents::append(doc);
-      }
+      uris.push_back(
+          Glib::filename_to_uri(utility::create_full_path(filename)));
     }
   }
+  open_documents(uris, options.encoding);
 
   // ------------------------------------------------
   // video
@@ -562,18 +571,17 @@ bool Application::on_key_press_event(GdkEventKey *ev) {
 void Application::notebook_drag_data_received(
     const Glib::RefPtr<Gdk::DragContext> & /*context*/, int /*x*/, int /*y*/,
     const Gtk::SelectionData &selection_data, guint /*info*/, guint /*time*/) {
-  std::vector<Glib::ustring> uris = selection_data.get_uris();
-  for (unsigned int i = 0; i < uris.size(); ++i) {
-    Glib::ustring filename = Glib::filename_from_uri(uris[i]);
+  std::vector<Glib::ustring> uris;
+  for (const auto &uri : selection_data.get_uris()) {
+    Glib::ustring filename = Glib::filename_from_uri(uri);
 
     // verifie qu'il n'est pas déjà ouvert
     if (se::documents::find_by_name(filename) != nullptr)
       continue;
 
-    Document *doc = Document::create_from_file(uris[i]);
-    if (doc)
-      se::documents::append(doc);
+    uris.push_back(uri);
   }
+  open_documents(uris, Glib::ustring());
 }
 
 void Application::player_drag_data_received(
@@ -619,6 +627,101 @@ WaveformManager *Application::get_waveform_manager() {
   return m_waveform_editor;
 }
 
+// Open the documents on threads (DocumentLoader), the progress is displayed
+// in the statusbar. The documents are added to se::documents in the order
+// of the uris when they are ready.
+void Application::open_documents(const std::vector<Glib::ustring> &uris,
+                                 const Glib::ustring &charset) {
+  for (const auto &uri : uris) {
+    // Already being opened
+    auto it = std::find_if(m_loaders.begin(), m_loaders.end(),
+                           [&uri](const std::unique_ptr<DocumentLoader> &l) {
+                             return l->get_uri() == uri;
+                           });
+    if (it != m_loaders.end())
+      continue;
+
+    std::unique_ptr<DocumentLoader> loader(new DocumentLoader(uri, charset));
+    loader->signal_finished().connect(
+        sigc::mem_fun(*this, &Application::on_loader_finished));
+    loader->start();
+    m_loaders.push_back(std::move(loader));
+  }
+
+  if (!m_loaders.empty() && !m_connection_loaders_progress) {
+    m_connection_loaders_progress = Glib::signal_timeout().connect(
+        sigc::mem_fun(*this, &Application::update_loaders_progress), 100);
+  }
+  update_loaders_progress();
+}
+
+// Display the progress of the documents being opened in the statusbar.
+bool Application::update_loaders_progress() {
+  if (m_loaders.empty()) {
+    m_connection_loaders_progress.disconnect();
+    m_statusbar->hide_progress();
+    return false;
+  }
+
+  double fraction = 0;
+  for (const auto &loader : m_loaders) {
+    fraction += loader->get_progress().get_fraction();
+  }
+  fraction /= m_loaders.size();
+
+  Glib::ustring text;
+  if (m_loaders.size() == 1) {
+    Glib::ustring uri = m_loaders.front()->get_uri();
+    text = build_message(
+        _("Opening %s"),
+        Glib::path_get_basename(Glib::filename_from_uri(uri)).c_str());
+  } else {
+    text = build_message(_("Opening %d files"),
+                         static_cast<int>(m_loaders.size()));
+  }
+  m_statusbar->set_progress(text, fraction);
+  return true;
+}
+
+// The cancel button of the statusbar.
+void Application::on_cancel_loaders() {
+  for (const auto &loader : m_loaders) {
+    loader->cancel();
+  }
+}
+
+// A loader is finished, the documents are published in an idle callback
+// (the loader can't be deleted in its own callback).
+void Application::on_loader_finished() {
+  Glib::signal_idle().connect_once(
+      sigc::mem_fun(*this, &Application::publish_loaded_documents));
+}
+
+// Add the opened documents to se::documents in the order of the uris.
+// Each document is added in one step, with all its subtitles.
+void Application::publish_loaded_documents() {
+  // The error dialogs run a main loop, the next loaders are published by the
+  // first call
+  if (m_publishing_documents)
+    return;
+  m_publishing_documents = true;
+
+  while (!m_loaders.empty() && m_loaders.front()->is_finished()) {
+    std::unique_ptr<DocumentLoader> loader = std::move(m_loaders.front());
+    m_loaders.pop_front();
+
+    Glib::ustring other_charset;
+    Document *doc = Document::create_from_loader(*loader, other_charset);
+    if (doc != nullptr)
+      se::documents::append(doc);
+    else if (!other_charset.empty())
+      open_documents({loader->get_uri()}, other_charset);
+  }
+
+  m_publishing_documents = false;
+  update_loaders_progress();
+}
+
 // Need to connect the visibility signal of the widgets children
 // (video player and waveform editor) for updating the visibility of
 // the paned multimedia widget.
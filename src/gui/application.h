@@ -21,7 +21,10 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <gtkmm.h>
+#include <list>
+#include <memory>
 #include "document.h"
+#include "documentloader.h"
 #include "menubar.h"
 #include "options.h"
 #include "statusbar.h"
@@ -49,6 +52,9 @@ class Application : public Gtk::Window, public SubtitleEditorWindow {
 
   WaveformManager* get_waveform_manager();
 
+  void open_documents(const std::vector<Glib::ustring>& uris,
+                      const Glib::ustring& charset);
+
  protected:
   void on_config_interface_changed(const Glib::ustring& key,
                                    const Glib::ustring& value);
@@ -119,6 +125,19 @@ class Application : public Gtk::Window, public SubtitleEditorWindow {
   void load_window_state();
   void save_window_sate();
 
+  // Display the progress of the documents being opened in the statusbar.
+  bool update_loaders_progress();
+
+  // The cancel button of the statusbar.
+  void on_cancel_loaders();
+
+  // A loader is finished, the documents are published in an idle callback
+  // (the loader can't be deleted in its own callback).
+  void on_loader_finished();
+
+  // Add the opened documents to se::documents in the order of the uris.
+  void publish_loaded_documents();
+
  protected:
   Gtk::Box* m_vboxMain;
   MenuBar m_menubar;
@@ -131,6 +150,11 @@ class Application : public Gtk::Window, public SubtitleEditorWindow {
 
   std::list<sigc::connection> m_document_connections;
 
+  // The documents being opened (open_documents), in the order of the uris
+  std::list<std::unique_ptr<DocumentLoader> > m_loaders;
+  sigc::connection m_connection_loaders_progress;
+  bool m_publishing_documents{false};
+
   // uri for external video player
   Glib::ustring m_uri_movie_external_video_player;
 };
@@ -0,0 +1,191 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// The functions of Document which need the user interface (dialogs).
+// The core of the document (document.cc) doesn't use any widget.
+
+#include <memory>
+#include "comboboxencoding.h"
+#include "dialogutility.h"
+#include "document.h"
+#include "documentloader.h"
+#include "encodings.h"
+#include "error.h"
+#include "subtitleformatsystem.h"
+#include "utility.h"
+
+// Display the error of the opening of the file uri with charset.
+// Return true if the user asks to try again with other_charset.
+static bool dialog_open_error(std::exception_ptr error,
+                              const Glib::ustring &uri,
+                              const Glib::ustring &charset,
+                              Glib::ustring &other_charset) {
+  Glib::ustring filename = Glib::filename_from_uri(uri);
+  Glib::ustring basename = Glib::path_get_basename(filename);
+
+  try {
+    std::rethrow_exception(error);
+  } catch (const CancelledError &ex) {
+    // Asked by the user, nothing to display
+  } catch (const UnrecognizeFormatError &ex) {
+    Glib::ustring title = build_message(
+        _("Could not recognize the subtitle format for the file \"%s\"."),
+        basename.c_str());
+    Glib::ustring msg = _(
+        "Please check that the file contains subtitles in a supported format.");
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
+    dialog.run();
+  } catch (const EncodingConvertError &ex) {
+    Glib::ustring title, msg;
+
+    if (charset.empty()) {
+      title = build_message(_("Could not open automatically the file \"%s\"."),
+                            basename.c_str());
+      msg =
+          _("Subtitle Editor was not able to automatically determine the file "
+            "encoding. "
+            "Select a different character coding from the menu and try again.");
+    } else {
+      title = build_message(
+          _("Could not open the file \"%s\" using the character coding %s."),
+          basename.c_str(), Encodings::get_label_from_charset(charset).c_str());
+      msg =
+          _("Select a different character coding from the menu and try again.");
+    }
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
+    dialog.add_button(Gtk::Stock::OPEN, Gtk::RESPONSE_OK);
+
+    Gtk::Label labelEncoding(_("Character Coding:"), 1.0, 0.5);
+    ComboBoxEncoding comboEncoding(false);
+
+    Gtk::HBox hbox(false, 6);
+    dialog.get_vbox()->pack_start(hbox, false, false);
+    hbox.pack_start(labelEncoding);
+    hbox.pack_start(comboEncoding);
+
+    dialog.show_all();
+    if (dialog.run() == Gtk::RESPONSE_OK) {
+      other_charset = comboEncoding.get_value();
+      return true;
+    }
+  } catch (const std::exception &ex) {
+    Glib::ustring title =
+        build_message(_("Could not open the file \"%s\""), basename.c_str());
+    Glib::ustring msg = ex.what();
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
+    dialog.run();
+  } catch (const Glib::Exception &ex) {
+    Glib::ustring title =
+        build_message(_("Could not open the file \"%s\""), basename.c_str());
+    Glib::ustring msg = ex.what();
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
+    dialog.run();
+  } catch (...) {
+    Glib::ustring title =
+        build_message(_("Could not open the file \"%s\""), basename.c_str());
+    Glib::ustring msg = _("An unknown error occurred while opening the file.");
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
+    dialog.run();
+  }
+  return false;
+}
+
+// Create a new document from an uri, if the charset is empty then it will try
+// to auto detect the good value. This function display a dialog ask or error if
+// needed. Return a new document or NULL.
+Document *Document::create_from_file(const Glib::ustring &uri,
+                                     const Glib::ustring &charset) {
+  se_dbg_msg(SE_DBG_APP, "uri=%s charset=%s", uri.c_str(), charset.c_str());
+
+  try {
+    std::unique_ptr<Document> doc(new Document);
+    doc->setCharset(charset);
+    doc->open(uri);
+    return doc.release();
+  } catch (...) {
+    Glib::ustring other_charset;
+    if (dialog_open_error(std::current_exception(), uri, charset,
+                          other_charset))
+      return Document::create_from_file(uri, other_charset);
+  }
+  return nullptr;
+}
+
+// Return the document opened by the loader (finished) or NULL.
+// The errors are displayed like create_from_file, nothing is displayed if
+// the loader has been cancelled. If the user asks to try again with another
+// character coding, other_charset is set.
+Document *Document::create_from_loader(DocumentLoader &loader,
+                                       Glib::ustring &other_charset) {
+  se_dbg_msg(SE_DBG_APP, "uri=%s", loader.get_uri().c_str());
+
+  try {
+    return loader.take_document();
+  } catch (...) {
+    dialog_open_error(std::current_exception(), loader.get_uri(),
+                      loader.get_charset(), other_charset);
+  }
+  return nullptr;
+}
+
+// Try to save the document to the file.
+// The format, charset and newline used are the document values.
+// The document name will be renamed from the uri.
+// An error dialog will be display if needed.
+// Return true if it succeeds or false.
+bool Document::save(const Glib::ustring &uri) {
+  Glib::ustring basename =
+      Glib::path_get_basename(Glib::filename_from_uri(uri));
+  Glib::ustring format = getFormat();
+  Glib::ustring charset = getCharset();
+  Glib::ustring newline = getNewLine();
+
+  try {
+    SubtitleFormatSystem::instance().save_to_uri(this, uri, format, charset,
+                                                 newline);
+    return true;
+  } catch (const EncodingConvertError &ex) {
+    Glib::ustring title = build_message(
+        _("Could not save the file \"%s\" using the character coding %s."),
+        basename.c_str(), Encodings::get_label_from_charset(charset).c_str());
+    Glib::ustring msg =
+        _("The document contains one or more characters "
+          "that cannot be encoded using the specified character coding.");
+
+    ErrorDialog dialog(title, msg);
+    dialog.add_button(Gtk::Stock::OK, Gtk::RESPONSE_OK);
+    dialog.run();
+  } catch (const std::exception &ex) {
+    dialog_error(_("Save Document Failed."), ex.what());
+  } catch (const Glib::Exception &ex) {
+    dialog_error(_("Save Document Failed."), ex.what());
+  }
+  return false;
+}
@@ -18,12 +18,29 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <iostream>
+#include "i18n.h"
 #include "statusbar.h"
 
 Statusbar::Statusbar(BaseObjectType *cobject,
                      const Glib::RefPtr<Gtk::Builder> & /*builder*/)
     : Gtk::Statusbar(cobject) {
+  // Progress of the tasks (opening of documents), hidden by default
+  m_progressbar.set_show_text(true);
+  m_progressbar.set_valign(Gtk::ALIGN_CENTER);
+  m_progressbar.set_no_show_all(true);
+
+  m_button_cancel.set_image_from_icon_name("process-stop",
+                                           Gtk::ICON_SIZE_MENU);
+  m_button_cancel.set_relief(Gtk::RELIEF_NONE);
+  m_button_cancel.set_focus_on_click(false);
+  m_button_cancel.set_tooltip_text(_("Cancel"));
+  m_button_cancel.set_no_show_all(true);
+  m_button_cancel.signal_clicked().connect(m_signal_cancel.make_slot());
+
+  pack_end(m_button_cancel, false, false);
+  pack_end(m_progressbar, false, false);
 }
 
 Statusbar::~Statusbar() {
@@ -58,6 +75,30 @@ void Statusbar::flash_message(const Glib::ustring &text) {
       sigc::mem_fun(*this, &Statusbar::on_timeout), 3000);
 }
 
+// Display the progress of a task with a cancel button.
+// A negative fraction is an unknown progress (pulse).
+void Statusbar::set_progress(const Glib::ustring &text, double fraction) {
+  m_progressbar.set_text(text);
+  if (fraction < 0)
+    m_progressbar.pulse();
+  else
+    m_progressbar.set_fraction(std::min(fraction, 1.0));
+
+  m_progressbar.show();
+  m_button_cancel.show();
+}
+
+// Hide the progress and the cancel button.
+void Statusbar::hide_progress() {
+  m_progressbar.hide();
+  m_button_cancel.hide();
+}
+
+// Emitted when the cancel button is clicked.
+sigc::signal<void> &Statusbar::signal_cancel() {
+  return m_signal_cancel;
+}
+
 bool Statusbar::on_timeout() {
   pop_text();
   m_connection_timeout.disconnect();
@@ -33,9 +33,22 @@ class Statusbar : public Gtk::Statusbar {
   // affiche un message pendant 3 sec
   void flash_message(const Glib::ustring &text);
 
+  // Display the progress of a task with a cancel button.
+  // A negative fraction is an unknown progress (pulse).
+  void set_progress(const Glib::ustring &text, double fraction);
+
+  // Hide the progress and the cancel button.
+  void hide_progress();
+
+  // Emitted when the cancel button is clicked.
+  sigc::signal<void> &signal_cancel();
+
  protected:
   bool on_timeout();
 
  protected:
   sigc::connection m_connection_timeout;
+  Gtk::ProgressBar m_progressbar;
+  Gtk::Button m_button_cancel;
+  sigc::signal<void> m_signal_cancel;
 };
@@ -0,0 +1,197 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <giomm.h>
+#include <glib/gstdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "cfg.h"
+#include "debug.h"
+#include "mediacache.h"
+
+namespace media_cache {
+
+// The size of the blocks hashed at the start and at the end of the media
+static const gsize HASH_BLOCK = 64 * 1024;
+
+// Return the directory of the cache, created if needed.
+static std::string get_cache_dir() {
+  std::string path =
+      Glib::build_filename(Glib::get_user_cache_dir(), "subtitleeditor");
+
+  if (!Glib::file_test(path, Glib::FILE_TEST_IS_DIR))
+    g_mkdir_with_parents(path.c_str(), 0700);
+
+  return path;
+}
+
+// Read up to HASH_BLOCK bytes at offset and add them to the checksum.
+static void hash_block(const Glib::RefPtr<Gio::FileInputStream> &stream,
+                       goffset offset, Glib::Checksum &checksum) {
+  std::vector<guint8> buffer(HASH_BLOCK);
+  gsize bytes_read = 0;
+
+  stream->seek(offset, Glib::SEEK_TYPE_SET);
+  stream->read_all(buffer.data(), buffer.size(), bytes_read);
+  checksum.update(buffer.data(), bytes_read);
+}
+
+// Return the key of the media or an empty string if it can't be read.
+// Only the first and the last blocks are read, the cost doesn't depend on
+// the size of the media.
+static std::string compute_key(const Glib::ustring &media_uri) {
+  try {
+    Glib::RefPtr<Gio::File> file = Gio::File::create_for_uri(media_uri);
+    Glib::RefPtr<Gio::FileInfo> info =
+        file->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE
+                         "," G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+    goffset size = info->get_size();
+    guint64 mtime = info->get_attribute_uint64(G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+    Glib::Checksum checksum(Glib::Checksum::CHECKSUM_SHA256);
+    checksum.update(media_uri);
+    checksum.update("\n" + std::to_string(size) + "\n" +
+                    std::to_string(mtime) + "\n");
+
+    Glib::RefPtr<Gio::FileInputStream> stream = file->read();
+    hash_block(stream, 0, checksum);
+    if (size > static_cast<goffset>(HASH_BLOCK))
+      hash_block(stream, size - HASH_BLOCK, checksum);
+    stream->close();
+
+    return checksum.get_string();
+  } catch (const Glib::Error &ex) {
+    se_dbg_msg(SE_DBG_APP, "Could not compute the key of '%s': %s",
+               media_uri.c_str(), ex.what().c_str());
+  }
+  return std::string();
+}
+
+// Return the filename of the entry or an empty string.
+static std::string get_entry_filename(const Glib::ustring &media_uri,
+                                      const Glib::ustring &ext) {
+  if (!cfg::get_boolean("media-cache", "enabled"))
+    return std::string();
+
+  std::string key = compute_key(media_uri);
+  if (key.empty())
+    return std::string();
+
+  return Glib::build_filename(get_cache_dir(), key + "." + ext);
+}
+
+// Return the uri of the cached file of the media or an empty string.
+Glib::ustring lookup(const Glib::ustring &media_uri,
+                     const Glib::ustring &ext) {
+  std::string filename = get_entry_filename(media_uri, ext);
+  if (filename.empty() || !Glib::file_test(filename, Glib::FILE_TEST_EXISTS))
+    return Glib::ustring();
+
+  se_dbg_msg(SE_DBG_APP, "'%s' found in the cache: %s", media_uri.c_str(),
+             filename.c_str());
+
+  // The modification time is the time of the last use
+  g_utime(filename.c_str(), nullptr);
+
+  return Glib::filename_to_uri(filename);
+}
+
+// Return the uri where the file of the media must be written.
+Glib::ustring get_store_uri(const Glib::ustring &media_uri,
+                            const Glib::ustring &ext) {
+  std::string filename = get_entry_filename(media_uri, ext);
+  if (filename.empty())
+    return Glib::ustring();
+
+  return Glib::filename_to_uri(filename);
+}
+
+// Return true if the uri is a file of the cache.
+bool contains(const Glib::ustring &uri) {
+  if (uri.empty())
+    return false;
+
+  try {
+    std::string dirname =
+        Glib::path_get_dirname(Glib::filename_from_uri(uri));
+    std::string cache =
+        Glib::build_filename(Glib::get_user_cache_dir(), "subtitleeditor");
+    return dirname == cache;
+  } catch (const Glib::Error &) {
+    // not a local file
+  }
+  return false;
+}
+
+// Remove the least recently used entries until the size of the cache is
+// under the limit.
+void trim() {
+  struct Entry {
+    std::string filename;
+    gint64 size;
+    gint64 mtime;
+  };
+
+  std::string path = get_cache_dir();
+  gint64 max_size = static_cast<gint64>(
+                        std::max(0, cfg::get_int("media-cache", "max-size"))) *
+                    1024 * 1024;
+
+  std::vector<Entry> entries;
+  gint64 total = 0;
+  try {
+    Glib::Dir dir(path);
+    for (const auto &name : dir) {
+      std::string filename = Glib::build_filename(path, name);
+
+      GStatBuf st;
+      if (g_stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        continue;
+
+      entries.push_back({filename, static_cast<gint64>(st.st_size),
+                         static_cast<gint64>(st.st_mtime)});
+      total += st.st_size;
+    }
+  } catch (const Glib::Error &ex) {
+    se_dbg_msg(SE_DBG_APP, "error: %s", ex.what().c_str());
+    return;
+  }
+
+  if (total <= max_size)
+    return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+
+  for (const auto &entry : entries) {
+    if (total <= max_size)
+      break;
+
+    se_dbg_msg(SE_DBG_APP, "remove from the cache: %s",
+               entry.filename.c_str());
+
+    if (g_remove(entry.filename.c_str()) == 0)
+      total -= entry.size;
+  }
+}
+
+}  // namespace media_cache
@@ -0,0 +1,50 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <glibmm.h>
+
+// A cache of the files generated from the medias (waveforms, keyframes) in
+// $XDG_CACHE_HOME/subtitleeditor.
+// An entry is named by a key computed from the uri of the media, its size,
+// its modification time and a hash of its first and last blocks: a changed
+// media gets a new key. The size of the cache is limited by
+// [media-cache] max-size (MiB), the least recently used entries are removed
+// first by trim().
+namespace media_cache {
+
+// Return the uri of the cached file of the media with the extension (ex:
+// "wf", "kf") or an empty string. The entry becomes the most recently used.
+Glib::ustring lookup(const Glib::ustring &media_uri, const Glib::ustring &ext);
+
+// Return the uri where the file of the media must be written or an empty
+// string if the cache is disabled or the media can't be read.
+Glib::ustring get_store_uri(const Glib::ustring &media_uri,
+                            const Glib::ustring &ext);
+
+// Return true if the uri is a file of the cache.
+bool contains(const Glib::ustring &uri);
+
+// Remove the least recently used entries until the size of the cache is
+// under the limit.
+void trim();
+
+}  // namespace media_cache
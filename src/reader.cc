@@ -18,14 +18,16 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-#include <giomm.h>
+#include <cstring>
 #include "debug.h"
-#include "encodings.h"
-#include "error.h"
 #include "reader.h"
 
+// Number of lines between two updates of the progress
+static const guint PROGRESS_LINES = 4096;
+
 // Constructor.
 Reader::Reader(const Glib::ustring &data) : m_data(data) {
+  set_data();
 }
 
 Reader::~Reader() {
@@ -33,62 +35,166 @@ Reader::~Reader() {
 
 // Return the contents of the file.
 const Glib::ustring &Reader::get_data() const {
+  // Only copied when it's asked (XML formats)
+  if (!m_data_init) {
+    m_data.assign(m_begin, m_end);
+    m_data_init = true;
+  }
   return m_data;
 }
 
+// Return the beginning of the contents, at most max_size bytes without
+// splitting a character (detection of the format).
+Glib::ustring Reader::get_head(gsize max_size) const {
+  gsize size = m_end - m_begin;
+  if (size > max_size) {
+    size = max_size;
+    // Move back to the first byte of the character
+    while (size > 0 && (guchar(m_begin[size]) & 0xC0) == 0x80) {
+      --size;
+    }
+  }
+  return Glib::ustring(m_begin, m_begin + size);
+}
+
+// Read the data from [data, data + size) (UTF-8) without copy.
+// The data must be valid while the reader exists.
+void Reader::set_data(const char *data, gsize size) {
+  m_begin = data;
+  m_end = data + size;
+  // No line if it's empty
+  m_pos = (size > 0) ? m_begin : NULL;
+  m_data_init = (data == m_data.data());
+}
+
+// Read the data from m_data.
+void Reader::set_data() {
+  set_data(m_data.data(), m_data.bytes());
+}
+
 // Return the newline detected of the file.
 Glib::ustring Reader::get_newline() {
-  Glib::ustring newline;
-
-  if (Glib::Regex::match_simple("\\r\\n", m_data))
-    newline = "Windows";
-  else if (Glib::Regex::match_simple("\\r", m_data))
+  Glib::ustring newline = "Unix";
+
+  // CRLF anywhere is Windows, otherwise a CR is Macintosh.
+  const char *p = m_begin;
+  while (p < m_end) {
+    const char *cr =
+        static_cast<const char *>(std::memchr(p, '\r', m_end - p));
+    if (cr == NULL)
+      break;
+    if (cr + 1 < m_end && cr[1] == '\n') {
+      newline = "Windows";
+      break;
+    }
     newline = "Macintosh";
-  else if (Glib::Regex::match_simple("\\n", m_data))
-    newline = "Unix";
-  else
-    newline = "Unix";
+    p = cr + 1;
+  }
 
   se_dbg_msg(SE_DBG_IO, "newline=%s", newline.c_str());
 
-  // default
   return newline;
 }
 
+// Find the next line from pos and move pos after the newline.
+// pos is NULL after the last line.
+// The newlines are the same as the PCRE \R: CRLF, LF, VT, FF, CR, NEL, LS and
+// PS.
+bool Reader::next_line(const char *&pos, Line &line) const {
+  if (pos == NULL)
+    return false;
+
+  const char *p = pos;
+  while (p < m_end) {
+    const guchar c = *p;
+    // Fast path, all the newlines start with one of these bytes
+    if (c > '\r' && c != 0xC2 && c != 0xE2) {
+      ++p;
+      continue;
+    }
+
+    int size = 0;
+    if (c == '\r')
+      size = (p + 1 < m_end && p[1] == '\n') ? 2 : 1;
+    else if (c == '\n' || c == '\v' || c == '\f')
+      size = 1;
+    else if (c == 0xC2)
+      size = (p + 1 < m_end && guchar(p[1]) == 0x85) ? 2 : 0;
+    else if (c == 0xE2)
+      size = (p + 2 < m_end && guchar(p[1]) == 0x80 &&
+              (guchar(p[2]) == 0xA8 || guchar(p[2]) == 0xA9))
+                 ? 3
+                 : 0;
+
+    if (size > 0) {
+      line.data = pos;
+      line.size = p - pos;
+      pos = p + size;
+      return true;
+    }
+    ++p;
+  }
+  // The last line (empty if the data ends with a newline)
+  line.data = pos;
+  line.size = m_end - pos;
+  pos = NULL;
+  return true;
+}
+
 // Get the next line of the file without newline character (CR, LF or CRLF).
-bool Reader::getline(Glib::ustring &line) {
-  initialize_lines();
+// The line points to the data of the reader, there is no copy.
+bool Reader::getline(Line &line) {
+  if (m_progress != NULL && ++m_progress_lines == PROGRESS_LINES) {
+    m_progress_lines = 0;
+    update_progress();
+  }
 
-  if (m_iter == m_lines.end()) {
+  if (!next_line(m_pos, line)) {
     se_dbg_msg(SE_DBG_IO, "EOF");
     return false;
   }
 
-  line = *m_iter;
-  ++m_iter;
+  se_dbg_msg(SE_DBG_IO, "\"%.*s\"", static_cast<int>(line.size), line.data);
+
+  return true;
+}
 
-  se_dbg_msg(SE_DBG_IO, "\"%s\"", line.c_str());
+// Get the next line of the file without newline character (CR, LF or CRLF).
+bool Reader::getline(Glib::ustring &line) {
+  Line slice;
+  if (!getline(slice))
+    return false;
 
+  line.assign(slice.data, slice.data + slice.size);
   return true;
 }
 
 // Return all lines detected of the file, without newline character (CR, LF or
 // CRLF).
 std::vector<Glib::ustring> Reader::get_lines() {
-  initialize_lines();
+  se_dbg_msg(SE_DBG_IO, "split lines...");
 
-  return m_lines;
+  std::vector<Glib::ustring> lines;
+  const char *pos = (m_begin < m_end) ? m_begin : NULL;
+  Line line;
+  while (next_line(pos, line)) {
+    lines.push_back(line.str());
+  }
+  return lines;
 }
 
-// Split the data to separate lines.
-void Reader::initialize_lines() {
-  // init only if needs
-  if (m_lines_init)
-    return;
+// Report the position of getline to progress (fraction of the data) and
+// stop the reading by CancelledError if the task is cancelled.
+// The progress is not owned by the reader.
+void Reader::set_progress(TaskProgress *progress) {
+  m_progress = progress;
+  m_progress_lines = 0;
+}
 
-  se_dbg_msg(SE_DBG_IO, "split lines...");
+// Update the fraction of the progress and check the cancellation.
+void Reader::update_progress() {
+  m_progress->check_cancelled();
 
-  m_lines = Glib::Regex::split_simple("\\R", m_data);
-  m_iter = m_lines.begin();
-  m_lines_init = true;
+  if (m_pos != NULL && m_end > m_begin)
+    m_progress->set_fraction(double(m_pos - m_begin) / (m_end - m_begin));
 }
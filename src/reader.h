@@ -21,11 +21,31 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <glibmm.h>
+#include <vector>
+#include "taskprogress.h"
 
 // Helper to read data (UTF-8) from memory.
 // Return lines without character of newline (CR,LF or CRLF)
+// The lines are split on demand, getline(Line&) returns a slice of the data
+// without copy.
 class Reader {
  public:
+  // A line of the data (not null terminated).
+  // The pointer is valid while the reader exists.
+  struct Line {
+    const char *data{nullptr};
+    gsize size{0};
+
+    bool empty() const {
+      return size == 0;
+    }
+
+    // Return a copy of the line.
+    Glib::ustring str() const {
+      return Glib::ustring(data, data + size);
+    }
+  };
+
   // Constructor.
   explicit Reader(const Glib::ustring &data = Glib::ustring());
 
@@ -35,9 +55,17 @@ class Reader {
   // Return the contents of the file.
   const Glib::ustring &get_data() const;
 
+  // Return the beginning of the contents, at most max_size bytes without
+  // splitting a character (detection of the format).
+  Glib::ustring get_head(gsize max_size) const;
+
   // Return the newline detected of the file.
   Glib::ustring get_newline();
 
+  // Get the next line of the file without newline character (CR, LF or CRLF).
+  // The line points to the data of the reader, there is no copy.
+  bool getline(Line &line);
+
   // Get the next line of the file without newline character (CR, LF or CRLF).
   bool getline(Glib::ustring &line);
 
@@ -45,13 +73,36 @@ class Reader {
   // CRLF).
   std::vector<Glib::ustring> get_lines();
 
+  // Report the position of getline to progress (fraction of the data) and
+  // stop the reading by CancelledError if the task is cancelled.
+  // The progress is not owned by the reader.
+  void set_progress(TaskProgress *progress);
+
+ protected:
+  // Read the data from [data, data + size) (UTF-8) without copy.
+  // The data must be valid while the reader exists.
+  void set_data(const char *data, gsize size);
+
+  // Read the data from m_data.
+  void set_data();
+
  private:
-  // Split the data to separate lines.
-  void initialize_lines();
+  // Find the next line from pos and move pos after the newline.
+  // pos is NULL after the last line.
+  bool next_line(const char *&pos, Line &line) const;
+
+  // Update the fraction of the progress and check the cancellation.
+  void update_progress();
 
  protected:
-  Glib::ustring m_data;
-  bool m_lines_init{false};
-  std::vector<Glib::ustring>::const_iterator m_iter;
-  std::vector<Glib::ustring> m_lines;
+  // The data, only used by get_data() when the reader doesn't own it
+  mutable Glib::ustring m_data;
+  mutable bool m_data_init{false};
+  const char *m_begin{nullptr};
+  const char *m_end{nullptr};
+  // The next line, NULL at the end
+  const char *m_pos{nullptr};
+  // Optional progress, updated every PROGRESS_LINES lines
+  TaskProgress *m_progress{nullptr};
+  guint m_progress_lines{0};
 };
@@ -22,68 +22,65 @@
 #include <iomanip>
 #include "document.h"
 #include "subtitle.h"
+#include "subtitlejournal.h"
 #include "utility.h"
 
-class SubtitleCommand : public Command {
- public:
-  SubtitleCommand(const Subtitle &sub, const Glib::ustring &name_value,
-                  const Glib::ustring &new_value)
-      : Command(sub.m_document, "Subtitle edited " + name_value),
-        m_path(sub.m_path),
-        m_name_value(name_value),
-        m_old(sub.get(name_value)),
-        m_new(new_value) {
-    se_dbg_msg(SE_DBG_APP, "name=<%s> old=<%s> new=<%s>", m_name_value.c_str(),
-               m_old.c_str(), m_new.c_str());
-  }
-
-  void execute() {
-    Subtitle subtitle(document(), m_path);
-
-    subtitle.set(m_name_value, m_new);
-  }
-
-  void restore() {
-    Subtitle subtitle(document(), m_path);
-
-    subtitle.set(m_name_value, m_old);
-  }
-
- protected:
-  const Glib::ustring m_path;
-  const Glib::ustring m_name_value;
-  const Glib::ustring m_old;
-  const Glib::ustring m_new;
-};
-
-// static
-SubtitleColumnRecorder Subtitle::column;
-
 Subtitle::Subtitle() {
 }
 
 Subtitle::Subtitle(Document *doc, const Glib::ustring &path)
-    : m_document(doc), m_path(path) {
+    : m_document(doc), m_path(path), m_path_valid(true) {
   m_iter = doc->get_subtitle_model()->get_iter(path);
 }
 
 Subtitle::Subtitle(Document *doc, const Gtk::TreeIter &it)
     : m_document(doc), m_iter(it) {
-  if (it)
-    m_path = doc->get_subtitle_model()->get_string(it);
 }
 
 Subtitle::~Subtitle() {
 }
 
-void Subtitle::push_command(const Glib::ustring &name,
-                            const Glib::ustring &value) {
-  if (m_document->is_recording())
-    m_document->add_command(new SubtitleCommand(*this, name, value));
+// Return the model of the document.
+SubtitleModel *Subtitle::model() const {
+  return m_document->get_subtitle_model().operator->();
 }
 
+// Return the path of the subtitle in the model.
+// The string is only built when it's needed (command or get("path")), not
+// for each iteration.
+const Glib::ustring &Subtitle::path() const {
+  if (!m_path_valid) {
+    m_path = (m_iter) ? model()->get_string(m_iter) : "";
+    m_path_valid = true;
+  }
+  return m_path;
+}
+
+// Record the change of the field for undo/redo.
+// During a bulk edit all the changes share the same undo entry.
+void Subtitle::push_int_command(SubtitleStore::Field field, gint64 value) {
+  if (!m_document->is_recording())
+    return;
+  m_document->get_subtitle_journal()->add_int(*this, field, value);
+}
+
+void Subtitle::push_double_command(SubtitleStore::Field field, double value) {
+  if (!m_document->is_recording())
+    return;
+  m_document->get_subtitle_journal()->add_double(*this, field, value);
+}
+
+void Subtitle::push_text_command(SubtitleStore::Field field,
+                                 const Glib::ustring &value) {
+  if (!m_document->is_recording())
+    return;
+  m_document->get_subtitle_journal()->add_text(*this, field, value);
+}
+
+// An iter kept after the removal of its row is not valid, even if a new row
+// uses the same slot.
 Subtitle::operator bool() const {
-  if (m_iter)
+  if (m_iter && model()->iter_is_valid(m_iter))
     return true;
   return false;
 }
@@ -98,38 +95,37 @@ bool Subtitle::operator!=(const Subtitle &sub) const {
 
 Subtitle &Subtitle::operator++() {
   ++m_iter;
-
-  m_path = (m_iter) ? m_document->get_subtitle_model()->get_string(m_iter) : "";
+  m_path_valid = false;
 
   return *this;
 }
 
 Subtitle &Subtitle::operator--() {
   --m_iter;
-
-  m_path = (m_iter) ? m_document->get_subtitle_model()->get_string(m_iter) : "";
+  m_path_valid = false;
 
   return *this;
 }
 
 // Set the number of subtitle.
-void Subtitle::set_num(unsigned int num) {
-  (*m_iter)[column.num] = num;
+// The number follows the position of the subtitle in the model, it can't be
+// changed. Kept for compatibility.
+void Subtitle::set_num(unsigned int /*num*/) {
 }
 
-// Return the number of subtitle.
+// Return the number of subtitle (position + 1).
 unsigned int Subtitle::get_num() const {
-  return (*m_iter)[column.num];
+  return model()->get_int(m_iter, SubtitleStore::NUM);
 }
 
 void Subtitle::set_layer(const Glib::ustring &layer) {
-  push_command("layer", layer);
+  push_text_command(SubtitleStore::LAYER, layer);
 
-  (*m_iter)[column.layer] = layer;
+  model()->set_ustring(m_iter, SubtitleStore::LAYER, layer);
 }
 
 Glib::ustring Subtitle::get_layer() const {
-  return (*m_iter)[column.layer];
+  return model()->get_ustring(m_iter, SubtitleStore::LAYER);
 }
 
 // Return the time mode of the subtitle.
@@ -243,8 +239,8 @@ bool Subtitle::update_gap_before() {
   // gap is in milliseconds
   long gap = get_start().totalmsecs - prev_sub.get_end().totalmsecs;
 
-  (*m_iter)[column.gap_before] = gap;
-  (*prev_sub.m_iter)[column.gap_after] = gap;
+  model()->set_int(m_iter, SubtitleStore::GAP_BEFORE, gap);
+  model()->set_int(prev_sub.m_iter, SubtitleStore::GAP_AFTER, gap);
   return true;
 }
 
@@ -259,8 +255,8 @@ bool Subtitle::update_gap_after() {
   // gap is in milliseconds
   long gap = next_sub.get_start().totalmsecs - get_end().totalmsecs;
 
-  (*m_iter)[column.gap_after] = gap;
-  (*next_sub.m_iter)[column.gap_before] = gap;
+  model()->set_int(m_iter, SubtitleStore::GAP_AFTER, gap);
+  model()->set_int(next_sub.m_iter, SubtitleStore::GAP_BEFORE, gap);
   return true;
 }
 
@@ -270,7 +266,8 @@ bool Subtitle::check_gap_before(long mingap) {
   // const long mingap =
   //     convert_to_value_mode(SubtitleTime(cfg::get_int(
   //         "timing", "min-gap-between-subtitles")));
-  if (((*m_iter)[column.gap_before] >= mingap) || (get_num() <= 1))
+  if ((model()->get_int(m_iter, SubtitleStore::GAP_BEFORE) >= mingap) ||
+      (get_num() <= 1))
     return true;
 
   return false;
@@ -284,7 +281,8 @@ bool Subtitle::check_gap_after(long mingap) {
   //         "timing", "min-gap-between-subtitles")));
   Subtitle next_sub = m_document->subtitles().get_next(*this);
 
-  if (((*m_iter)[column.gap_after] >= mingap) || (next_sub == 0))
+  if ((model()->get_int(m_iter, SubtitleStore::GAP_AFTER) >= mingap) ||
+      (next_sub == 0))
     return true;
 
   return false;
@@ -292,16 +290,22 @@ bool Subtitle::check_gap_after(long mingap) {
 
 // Set the start value in the subtitle time mode. (FRAME or TIME)
 void Subtitle::set_start_value(const long &value) {
-  push_command("start", to_string(value));
-  (*m_iter)[column.start_value] = value;
-  update_gap_before();
+  push_int_command(SubtitleStore::START, value);
+  model()->set_int(m_iter, SubtitleStore::START, value);
+  if (m_document->is_bulk_editing())
+    m_document->mark_bulk_edit_changed(get_num() - 1, get_num() - 1);
+  else
+    update_gap_before();
 }
 
 // Set the end value in the subtitle time mode. (FRAME or TIME)
 void Subtitle::set_end_value(const long &value) {
-  push_command("end", to_string(value));
-  (*m_iter)[column.end_value] = value;
-  update_gap_after();
+  push_int_command(SubtitleStore::END, value);
+  model()->set_int(m_iter, SubtitleStore::END, value);
+  if (m_document->is_bulk_editing())
+    m_document->mark_bulk_edit_changed(get_num() - 1, get_num() - 1);
+  else
+    update_gap_after();
 }
 
 Glib::ustring Subtitle::convert_value_to_time_string(
@@ -314,25 +318,25 @@ Glib::ustring Subtitle::convert_value_to_time_string(
 
 // Get the start value in the subtitle time mode. (FRAME or TIME)
 long Subtitle::get_start_value() const {
-  return (*m_iter)[column.start_value];
+  return model()->get_int(m_iter, SubtitleStore::START);
 }
 
 // Get the end value in the subtitle time mode. (FRAME or TIME)
 long Subtitle::get_end_value() const {
-  return (*m_iter)[column.end_value];
+  return model()->get_int(m_iter, SubtitleStore::END);
 }
 
 // Set the duration value in the subtitle time mode. (FRAME or TIME)
 void Subtitle::set_duration_value(const long &value) {
-  push_command("duration", to_string(value));
+  push_int_command(SubtitleStore::DURATION, value);
 
-  (*m_iter)[column.duration_value] = value;
-  update_characters_per_sec();
+  // The characters per second are computed on the next read
+  model()->set_int(m_iter, SubtitleStore::DURATION, value);
 }
 
 // Get the duration value in the subtitle time mode. (FRAME or TIME)
 long Subtitle::get_duration_value() const {
-  return (*m_iter)[column.duration_value];
+  return model()->get_int(m_iter, SubtitleStore::DURATION);
 }
 
 // Convert the value (FRAME or TIME) and return as the subtitle time mode.
@@ -390,145 +394,109 @@ Glib::ustring Subtitle::convert_value_to_view_mode(const long &value) {
 }
 
 void Subtitle::set_style(const Glib::ustring &style) {
-  push_command("style", style);
+  push_text_command(SubtitleStore::STYLE, style);
 
-  (*m_iter)[column.style] = style;
+  model()->set_ustring(m_iter, SubtitleStore::STYLE, style);
 }
 
 Glib::ustring Subtitle::get_style() const {
-  return (*m_iter)[column.style];
+  return model()->get_ustring(m_iter, SubtitleStore::STYLE);
 }
 
 void Subtitle::set_name(const Glib::ustring &name) {
-  push_command("name", name);
+  push_text_command(SubtitleStore::NAME, name);
 
-  (*m_iter)[column.name] = name;
+  model()->set_ustring(m_iter, SubtitleStore::NAME, name);
 }
 
 Glib::ustring Subtitle::get_name() const {
-  return (*m_iter)[column.name];
+  return model()->get_ustring(m_iter, SubtitleStore::NAME);
 }
 
 void Subtitle::set_margin_l(const Glib::ustring &value) {
-  push_command("margin-l", value);
+  push_text_command(SubtitleStore::MARGIN_L, value);
 
-  (*m_iter)[column.marginL] = value;
+  model()->set_ustring(m_iter, SubtitleStore::MARGIN_L, value);
 }
 
 Glib::ustring Subtitle::get_margin_l() const {
-  return (*m_iter)[column.marginL];
+  return model()->get_ustring(m_iter, SubtitleStore::MARGIN_L);
 }
 
 void Subtitle::set_margin_r(const Glib::ustring &value) {
-  push_command("margin-r", value);
+  push_text_command(SubtitleStore::MARGIN_R, value);
 
-  (*m_iter)[column.marginR] = value;
+  model()->set_ustring(m_iter, SubtitleStore::MARGIN_R, value);
 }
 
 Glib::ustring Subtitle::get_margin_r() const {
-  return (*m_iter)[column.marginR];
+  return model()->get_ustring(m_iter, SubtitleStore::MARGIN_R);
 }
 
 void Subtitle::set_margin_v(const Glib::ustring &value) {
-  push_command("margin-v", value);
+  push_text_command(SubtitleStore::MARGIN_V, value);
 
-  (*m_iter)[column.marginV] = value;
+  model()->set_ustring(m_iter, SubtitleStore::MARGIN_V, value);
 }
 
 Glib::ustring Subtitle::get_margin_v() const {
-  return (*m_iter)[column.marginV];
+  return model()->get_ustring(m_iter, SubtitleStore::MARGIN_V);
 }
 
 void Subtitle::set_effect(const Glib::ustring &effect) {
-  push_command("effect", effect);
+  push_text_command(SubtitleStore::EFFECT, effect);
 
-  (*m_iter)[column.effect] = effect;
+  model()->set_ustring(m_iter, SubtitleStore::EFFECT, effect);
 }
 
 Glib::ustring Subtitle::get_effect() const {
-  return (*m_iter)[column.effect];
+  return model()->get_ustring(m_iter, SubtitleStore::EFFECT);
 }
 
 void Subtitle::set_text(const Glib::ustring &text) {
-  push_command("text", text);
-
-  (*m_iter)[column.text] = text;
-
-  // characters per line
-  if (text.size() == 0) {
-    (*m_iter)[column.characters_per_line_text] = "0";
-  } else {
-    std::vector<int> num_characters = utility::get_characters_per_line(text);
-    std::string cpl;
-
-    unsigned int count = 0;
-    for (const auto &number : num_characters) {
-      if (count == 0) {
-        cpl += to_string(number);
-      } else {
-        cpl += "\n" + to_string(number);
-      }
-      ++count;
-    }
-    (*m_iter)[column.characters_per_line_text] = cpl;
-  }
+  push_text_command(SubtitleStore::TEXT, text);
 
-  update_characters_per_sec();
+  // The characters per line/second are computed on the next read
+  model()->set_ustring(m_iter, SubtitleStore::TEXT, text);
 }
 
 Glib::ustring Subtitle::get_text() const {
-  return (*m_iter)[column.text];
+  return model()->get_ustring(m_iter, SubtitleStore::TEXT);
 }
 
 void Subtitle::set_translation(const Glib::ustring &text) {
-  push_command("translation", text);
-
-  (*m_iter)[column.translation] = text;
-
-  // characters per line
-  if (text.size() == 0) {
-    (*m_iter)[column.characters_per_line_translation] = "0";
-  } else {
-    std::vector<int> num_characters = utility::get_characters_per_line(text);
-    std::string cpl;
-
-    unsigned int count = 0;
-    for (const auto &number : num_characters) {
-      if (count == 0) {
-        cpl += to_string(number);
-      } else {
-        cpl += "\n" + to_string(number);
-      }
-      ++count;
-    }
+  push_text_command(SubtitleStore::TRANSLATION, text);
 
-    (*m_iter)[column.characters_per_line_translation] = cpl;
-  }
+  // The characters per line are computed on the next read
+  model()->set_ustring(m_iter, SubtitleStore::TRANSLATION, text);
 }
 
 Glib::ustring Subtitle::get_translation() const {
-  return (*m_iter)[column.translation];
+  return model()->get_ustring(m_iter, SubtitleStore::TRANSLATION);
 }
 
 // ex: 6 or 3\n3
 Glib::ustring Subtitle::get_characters_per_line_text() const {
-  return (*m_iter)[column.characters_per_line_text];
+  return model()->get_ustring(m_iter,
+                              SubtitleStore::CHARACTERS_PER_LINE_TEXT);
 }
 
 // ex: 6 or 3\n3
 Glib::ustring Subtitle::get_characters_per_line_translation() const {
-  return (*m_iter)[column.characters_per_line_translation];
+  return model()->get_ustring(m_iter,
+                              SubtitleStore::CHARACTERS_PER_LINE_TRANSLATION);
 }
 
 void Subtitle::set_characters_per_second_text(double cps) {
-  push_command("characters-per-second-text",
-               Glib::ustring::format(std::fixed, std::setprecision(1), cps));
+  push_double_command(SubtitleStore::CHARACTERS_PER_SECOND_TEXT, cps);
 
-  (*m_iter)[column.characters_per_second_text] = cps;
+  model()->set_double(m_iter, SubtitleStore::CHARACTERS_PER_SECOND_TEXT,
+                      cps);
 }
 
 double Subtitle::get_characters_per_second_text() const {
-  return static_cast<double>((*m_iter)[column.characters_per_second_text]);
+  return model()->get_double(m_iter,
+                             SubtitleStore::CHARACTERS_PER_SECOND_TEXT);
 }
 
 Glib::ustring Subtitle::get_characters_per_second_text_string() const {
@@ -566,13 +534,13 @@ int Subtitle::check_cps_text(double mincps, double maxcps) {
 }
 
 void Subtitle::set_note(const Glib::ustring &text) {
-  push_command("note", text);
+  push_text_command(SubtitleStore::NOTE, text);
 
-  (*m_iter)[column.note] = text;
+  model()->set_ustring(m_iter, SubtitleStore::NOTE, text);
 }
 
 Glib::ustring Subtitle::get_note() const {
-  return (*m_iter)[column.note];
+  return model()->get_ustring(m_iter, SubtitleStore::NOTE);
 }
 
 // copie le s-t dans sub
@@ -590,78 +558,164 @@ void Subtitle::copy_to(Subtitle &sub) {
   sub.set_note(get_note());
 }
 
+// The names of the fields used by the string form (set/get).
+static const struct {
+  const char *name;
+  SubtitleStore::Field field;
+} field_names[] = {{"layer", SubtitleStore::LAYER},
+                   {"start", SubtitleStore::START},
+                   {"end", SubtitleStore::END},
+                   {"duration", SubtitleStore::DURATION},
+                   {"style", SubtitleStore::STYLE},
+                   {"name", SubtitleStore::NAME},
+                   {"margin-l", SubtitleStore::MARGIN_L},
+                   {"margin-r", SubtitleStore::MARGIN_R},
+                   {"margin-v", SubtitleStore::MARGIN_V},
+                   {"effect", SubtitleStore::EFFECT},
+                   {"text", SubtitleStore::TEXT},
+                   {"translation", SubtitleStore::TRANSLATION},
+                   {"note", SubtitleStore::NOTE},
+                   {"characters-per-second-text",
+                    SubtitleStore::CHARACTERS_PER_SECOND_TEXT}};
+
+void Subtitle::set_int(SubtitleStore::Field field, gint64 value) {
+  switch (field) {
+    case SubtitleStore::START:
+      set_start_value(value);
+      break;
+    case SubtitleStore::END:
+      set_end_value(value);
+      break;
+    case SubtitleStore::DURATION:
+      set_duration_value(value);
+      break;
+    default:
+      g_warning("Subtitle::set_int: the field %d can't be set", field);
+      break;
+  }
+}
+
+gint64 Subtitle::get_int(SubtitleStore::Field field) const {
+  return model()->get_int(m_iter, field);
+}
+
+void Subtitle::set_double(SubtitleStore::Field field, double value) {
+  g_return_if_fail(field == SubtitleStore::CHARACTERS_PER_SECOND_TEXT);
+
+  set_characters_per_second_text(value);
+}
+
+double Subtitle::get_double(SubtitleStore::Field field) const {
+  return model()->get_double(m_iter, field);
+}
+
+void Subtitle::set_string(SubtitleStore::Field field,
+                          const Glib::ustring &value) {
+  switch (field) {
+    case SubtitleStore::LAYER:
+      set_layer(value);
+      break;
+    case SubtitleStore::STYLE:
+      set_style(value);
+      break;
+    case SubtitleStore::NAME:
+      set_name(value);
+      break;
+    case SubtitleStore::MARGIN_L:
+      set_margin_l(value);
+      break;
+    case SubtitleStore::MARGIN_R:
+      set_margin_r(value);
+      break;
+    case SubtitleStore::MARGIN_V:
+      set_margin_v(value);
+      break;
+    case SubtitleStore::EFFECT:
+      set_effect(value);
+      break;
+    case SubtitleStore::TEXT:
+      set_text(value);
+      break;
+    case SubtitleStore::TRANSLATION:
+      set_translation(value);
+      break;
+    case SubtitleStore::NOTE:
+      set_note(value);
+      break;
+    default:
+      g_warning("Subtitle::set_string: the field %d can't be set", field);
+      break;
+  }
+}
+
+Glib::ustring Subtitle::get_string(SubtitleStore::Field field) const {
+  return model()->get_ustring(m_iter, field);
+}
+
+// Return the field from its name ("start", "margin-l", ...).
+bool Subtitle::get_field(const Glib::ustring &name,
+                         SubtitleStore::Field &field) {
+  static const std::map<std::string, SubtitleStore::Field> fields = []() {
+    std::map<std::string, SubtitleStore::Field> map;
+    for (const auto &f : field_names) {
+      map[f.name] = f.field;
+    }
+    return map;
+  }();
+
+  auto it = fields.find(name.raw());
+  if (it == fields.end())
+    return false;
+  field = it->second;
+  return true;
+}
+
 void Subtitle::set(const Glib::ustring &name, const Glib::ustring &value) {
   se_dbg_msg(SE_DBG_APP, "name=<%s> value=<%s>", name.c_str(), value.c_str());
 
-  if (name == "path")
+  if (name == "path") {
     m_path = value;
-  else if (name == "start")
-    set_start_value(utility::string_to_long(value));
-  else if (name == "end")
-    set_end_value(utility::string_to_long(value));
-  else if (name == "duration")
-    set_duration_value(utility::string_to_long(value));
-  else if (name == "text")
-    set_text(value);
-  else if (name == "translation")
-    set_translation(value);
-  else if (name == "layer")
-    set_layer(value);
-  else if (name == "style")
-    set_style(value);
-  else if (name == "name")
-    set_name(value);
-  else if (name == "margin-l")
-    set_margin_l(value);
-  else if (name == "margin-r")
-    set_margin_r(value);
-  else if (name == "margin-v")
-    set_margin_v(value);
-  else if (name == "effect")
-    set_effect(value);
-  else if (name == "note")
-    set_note(value);
-  else if (name == "characters-per-second-text")
-    set_characters_per_second_text(utility::string_to_double(value));
-  else
+    m_path_valid = true;
+    return;
+  }
+
+  SubtitleStore::Field field;
+  if (!get_field(name, field)) {
     std::cerr << "Subtitle::set UNKNOWN " << name << " " << value << std::endl;
+    return;
+  }
+
+  switch (SubtitleStore::get_type(field)) {
+    case SubtitleStore::INT:
+      set_int(field, utility::string_to_long(value));
+      break;
+    case SubtitleStore::DOUBLE:
+      set_double(field, utility::string_to_double(value));
+      break;
+    case SubtitleStore::STRING:
+      set_string(field, value);
+      break;
+  }
 }
 
 Glib::ustring Subtitle::get(const Glib::ustring &name) const {
   if (name == "path")
-    return m_path;
-  else if (name == "start")
-    return to_string(get_start_value());
-  else if (name == "end")
-    return to_string(get_end_value());
-  else if (name == "duration")
-    return to_string(get_duration_value());
-  else if (name == "text")
-    return get_text();
-  else if (name == "translation")
-    return get_translation();
-  else if (name == "layer")
-    return get_layer();
-  else if (name == "style")
-    return get_style();
-  else if (name == "name")
-    return get_name();
-  else if (name == "margin-l")
-    return get_margin_l();
-  else if (name == "margin-r")
-    return get_margin_r();
-  else if (name == "margin-v")
-    return get_margin_v();
-  else if (name == "effect")
-    return get_effect();
-  else if (name == "note")
-    return get_note();
-  else if (name == "characters-per-second-text")
-    return get_characters_per_second_text_string();
-  else
+    return path();
+
+  SubtitleStore::Field field;
+  if (!get_field(name, field)) {
     std::cerr << "Subtitle::get UNKNOWN " << name << std::endl;
+    return Glib::ustring();
+  }
 
-  return Glib::ustring();
+  switch (SubtitleStore::get_type(field)) {
+    case SubtitleStore::INT:
+      return to_string(get_int(field));
+    case SubtitleStore::DOUBLE:
+      return get_characters_per_second_text_string();
+    default:
+      return get_string(field);
+  }
 }
 
 void Subtitle::set(const std::map<Glib::ustring, Glib::ustring> &values) {
@@ -670,26 +724,20 @@ void Subtitle::set(const std::map<Glib::ustring, Glib::ustring> &values) {
   }
 }
 
+// All the fields except the characters per second (computed).
 void Subtitle::get(std::map<Glib::ustring, Glib::ustring> &values) {
-  values["path"] = get("path");
-  values["layer"] = get("layer");
-  values["start"] = get("start");
-  values["end"] = get("end");
-  values["duration"] = get("duration");
-  values["style"] = get("style");
-  values["name"] = get("name");
-  values["margin-l"] = get("margin-l");
-  values["margin-r"] = get("margin-r");
-  values["margin-v"] = get("margin-v");
-  values["effect"] = get("effect");
-  values["text"] = get("text");
-  values["translation"] = get("translation");
-  values["note"] = get("note");
-}
-
-void Subtitle::update_characters_per_sec() {
-  SubtitleTime duration = get_duration();
-  double cps =
-      utility::get_characters_per_second(get_text(), duration.totalmsecs);
-  (*m_iter)[column.characters_per_second_text] = cps;
+  values["path"] = path();
+
+  for (const auto &f : field_names) {
+    switch (SubtitleStore::get_type(f.field)) {
+      case SubtitleStore::INT:
+        values[f.name] = to_string(get_int(f.field));
+        break;
+      case SubtitleStore::STRING:
+        values[f.name] = get_string(f.field);
+        break;
+      default:
+        break;
+    }
+  }
 }
@@ -32,13 +32,13 @@
 //  /!\
 //  La durée de vie d'un Subtitle est la même que l'iter!
 //  On ne verifie pas la validiter des arguments! (pour les performances)
-class SubtitleCommand;
+class SubtitleJournal;
 class Subtitles;
 class Document;
 
 class Subtitle {
   friend class Subtitles;
-  friend class SubtitleCommand;
+  friend class SubtitleJournal;
 
  public:
   Subtitle();
@@ -57,6 +57,7 @@ class Subtitle {
   bool operator!=(const Subtitle &sub) const;
 
   // Set the number of subtitle.
+  // Does nothing, the number is the position of the subtitle.
   void set_num(unsigned int num);
 
   // Return the number of subtitle.
@@ -163,6 +164,24 @@ class Subtitle {
   // copie le s-t dans sub
   void copy_to(Subtitle &sub);
 
+  // Typed access to the fields, the setters call the set_xxx functions
+  // (undo/redo, computed values). The times are in the subtitle timing mode
+  // (FRAME or TIME). NUM, the gaps and the characters per line are read only.
+  void set_int(SubtitleStore::Field field, gint64 value);
+  gint64 get_int(SubtitleStore::Field field) const;
+
+  void set_double(SubtitleStore::Field field, double value);
+  double get_double(SubtitleStore::Field field) const;
+
+  void set_string(SubtitleStore::Field field, const Glib::ustring &value);
+  Glib::ustring get_string(SubtitleStore::Field field) const;
+
+  // Return the field from its name ("start", "margin-l", ...).
+  // Return false if the name is unknown.
+  static bool get_field(const Glib::ustring &name, SubtitleStore::Field &field);
+
+  // String form of the typed functions (compatibility).
+  // The name is "path" or the name of a field.
   void set(const Glib::ustring &name, const Glib::ustring &value);
 
   Glib::ustring get(const Glib::ustring &name) const;
@@ -202,9 +221,18 @@ class Subtitle {
   int check_cps_text(double mincps, double maxcps);
 
  protected:
-  void push_command(const Glib::ustring &name, const Glib::ustring &value);
+  // Return the model of the document.
+  SubtitleModel *model() const;
+
+  // Return the path of the subtitle in the model, built on demand.
+  const Glib::ustring &path() const;
 
-  void update_characters_per_sec();
+  // Record the change of the field for undo/redo.
+  // Must be called before the value is set.
+  void push_int_command(SubtitleStore::Field field, gint64 value);
+  void push_double_command(SubtitleStore::Field field, double value);
+  void push_text_command(SubtitleStore::Field field,
+                         const Glib::ustring &value);
 
   // Convert the value (subtitle timing mode) to the edit timing mode.
   Glib::ustring convert_value_to_view_mode(const long &value);
@@ -237,8 +265,8 @@ class Subtitle {
   long get_duration_value() const;
 
  protected:
-  static SubtitleColumnRecorder column;
   Document *m_document{nullptr};
   Gtk::TreeIter m_iter;
-  Glib::ustring m_path;
+  mutable Glib::ustring m_path;
+  mutable bool m_path_valid{false};
 };
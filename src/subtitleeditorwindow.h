@@ -43,6 +43,13 @@ class SubtitleEditorWindow {
 
   virtual WaveformManager* get_waveform_manager() = 0;
 
+  // Open the documents on threads (DocumentLoader), the progress is displayed
+  // in the statusbar. The documents are added to se::documents in the order
+  // of the uris when they are ready. If the charset is empty, the
+  // automatically detection is used.
+  virtual void open_documents(const std::vector<Glib::ustring>& uris,
+                              const Glib::ustring& charset) = 0;
+
   static SubtitleEditorWindow* get_instance();
 
  protected:
@@ -42,16 +42,22 @@ SubtitleFormatSystem::SubtitleFormatSystem() {
 SubtitleFormatSystem::~SubtitleFormatSystem() {
 }
 
-// Try to determine the format of the subtitles in the submitted FileReader
+// Try to determine the format of the subtitles from the beginning of the
+// reader (small contents), the reader is not consumed.
 // Exceptions:
 // UnrecognizeFormatError.
 Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_small_contents(
     Reader *reader) {
-  const Glib::ustring &contents = reader->get_data();
-
-  se_dbg_msg(SE_DBG_APP, "small content:\n%s", contents.c_str());
+  // Only a small contents (max size: 1000)
+  return get_subtitle_format_from_contents(reader->get_head(1000));
+}
 
-  Glib::RegexCompileFlags compile_flags = Glib::REGEX_MULTILINE;
+// Try to determine the format of the subtitles from the contents.
+// Exceptions:
+// UnrecognizeFormatError.
+Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_contents(
+    const Glib::ustring &contents) {
+  se_dbg_msg(SE_DBG_APP, "content:\n%s", contents.c_str());
 
   se_dbg_msg(SE_DBG_APP, "Trying to determinate the file format...");
 
@@ -61,9 +67,8 @@ Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_small_contents(
 
     se_dbg_msg(SE_DBG_APP, "Try with '%s' format", sfi.name.c_str());
 
-    Glib::ustring pattern = sfi.pattern;
-
-    if (Glib::Regex::match_simple(pattern, contents, compile_flags)) {
+    auto regex = get_pattern(sfi.pattern);
+    if (regex && regex->match(contents)) {
       Glib::ustring name = sfi.name;
 
       se_dbg_msg(SE_DBG_APP, "Determine the format as '%s'", name.c_str());
@@ -74,26 +79,27 @@ Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_small_contents(
   throw UnrecognizeFormatError(_("Couldn't recognize format of the file."));
 }
 
-// Try to determine the format of the file, and return the format name.
-// Exceptions:
-// UnrecognizeFormatError.
-// EncodingConvertError.
-Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_small_contents(
-    const Glib::ustring &uri, const Glib::ustring &charset) {
-  // Open the file and read only a small contents (max size: 1000)
-  FileReader file(uri, charset, 1000);
-
-  return get_subtitle_format_from_small_contents(&file);
-}
-
-// Try to determine the format of the subtitles in the submitted ustring
-// Exceptions:
-// UnrecognizeFormatError.
-Glib::ustring SubtitleFormatSystem::get_subtitle_format_from_small_contents(
-    const Glib::ustring &data) {
-  // Open the file and read only a small contents (max size: 1000)
-  Reader file(data);
-  return get_subtitle_format_from_small_contents(&file);
+// Return the compiled regex of the detection pattern of a format.
+// The patterns are compiled only once.
+Glib::RefPtr<Glib::Regex> SubtitleFormatSystem::get_pattern(
+    const Glib::ustring &pattern) {
+  Glib::Threads::Mutex::Lock lock(m_patterns_mutex);
+
+  auto it = m_patterns.find(pattern);
+  if (it != m_patterns.end())
+    return it->second;
+
+  Glib::RefPtr<Glib::Regex> regex;
+  try {
+    regex = Glib::Regex::create(pattern,
+                                Glib::REGEX_MULTILINE | Glib::REGEX_OPTIMIZE);
+  } catch (const Glib::Error &ex) {
+    // Keep the invalid pattern (NULL), it will never match
+    se_dbg_msg(SE_DBG_APP, "Invalid pattern '%s': %s", pattern.c_str(),
+               ex.what().c_str());
+  }
+  m_patterns[pattern] = regex;
+  return regex;
 }
 
 // Create a SubtitleFormat from a name.
@@ -126,7 +132,12 @@ void SubtitleFormatSystem::open_from_reader(Document *document, Reader *reader,
   // init the reader
   std::unique_ptr<SubtitleFormatIO> sfio(create_subtitle_format_io(format));
   sfio->set_document(document);
-  sfio->open(*reader);
+  {
+    // The readers append many subtitles, the view, the gaps and the
+    // characters per line/second are updated only once at the end.
+    DocumentBulkEdit bulk(document);
+    sfio->open(*reader);
+  }
 
   se_dbg_msg(SE_DBG_APP, "Sets the document property ...");
 
@@ -147,22 +158,32 @@ void SubtitleFormatSystem::open_from_reader(Document *document, Reader *reader,
 
 // Try to open a subtitle file from the uri.
 // If charset is empty, the automatically detection is used.
+// The reading is reported to progress if it's not NULL (DocumentLoader).
 // Exceptions: UnrecognizeFormatError, EncodingConvertError, IOFileError,
-// Glib::Error...
+// CancelledError, Glib::Error...
 void SubtitleFormatSystem::open_from_uri(Document *document,
                                          const Glib::ustring &uri,
                                          const Glib::ustring &charset,
-                                         const Glib::ustring &myformat) {
+                                         const Glib::ustring &myformat,
+                                         TaskProgress *progress) {
   se_dbg_msg(SE_DBG_APP,
              "Trying to open the file %s with charset '%s' and format '%s",
              uri.c_str(), charset.c_str(), myformat.c_str());
 
+  // The file is read (and converted) only once, the format is detected from
+  // the beginning of the same reader.
+  FileReader reader(uri, charset);
+
+  if (progress != nullptr) {
+    progress->check_cancelled();
+    reader.set_progress(progress);
+  }
+
   // First try to find the subtitle file type from the contents
-  Glib::ustring format =
-      myformat.empty() ? get_subtitle_format_from_small_contents(uri, charset)
-                       : myformat;
+  Glib::ustring format = myformat.empty()
+                             ? get_subtitle_format_from_small_contents(&reader)
+                             : myformat;
 
-  FileReader reader(uri, charset);
   open_from_reader(document, &reader, format);
 
   se_dbg_msg(SE_DBG_APP, "The file %s has been read with success.",
@@ -177,10 +198,10 @@ void SubtitleFormatSystem::open_from_data(Document *document,
                                           const Glib::ustring &myformat) {
   se_dbg_msg(SE_DBG_APP, "Trying to load ustring as subtitles.");
 
-  // First try to find the subtitle file type from the contents
-  Glib::ustring format = myformat.empty()
-                             ? get_subtitle_format_from_small_contents(data)
-                             : myformat;
+  // First try to find the subtitle file type from the contents. The data is
+  // already in memory, the format is detected from all of it.
+  Glib::ustring format =
+      myformat.empty() ? get_subtitle_format_from_contents(data) : myformat;
 
   Reader reader(data);
   open_from_reader(document, &reader, format);
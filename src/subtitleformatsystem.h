@@ -20,8 +20,10 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <map>
 #include "document.h"
 #include "subtitleformatio.h"
+#include "taskprogress.h"
 
 class SubtitleFormat;
 
@@ -35,11 +37,13 @@ class SubtitleFormatSystem {
   // Try to open a subtitle file from the uri.
   // If charset is empty, the automatically detection is used.
   // If format is empty, the automatically detection is used.
+  // The reading is reported to progress if it's not NULL (DocumentLoader).
   // Exceptions: UnrecognizeFormatError, EncodingConvertError, IOFileError,
-  // Glib::Error...
+  // CancelledError, Glib::Error...
   void open_from_uri(Document *document, const Glib::ustring &uri,
                      const Glib::ustring &charset,
-                     const Glib::ustring &format = Glib::ustring());
+                     const Glib::ustring &format = Glib::ustring(),
+                     TaskProgress *progress = nullptr);
 
   // Try to open a ustring as a subtitle file
   // Charset is assumed to be UTF-8.
@@ -78,23 +82,21 @@ class SubtitleFormatSystem {
   // Destructor
   ~SubtitleFormatSystem();
 
-  // Try to determine the format of the file, and return the format name.
+  // Try to determine the format of the subtitles from the beginning of the
+  // reader (small contents), the reader is not consumed.
   // Exceptions:
   // UnrecognizeFormatError.
-  // EncodingConvertError.
-  Glib::ustring get_subtitle_format_from_small_contents(
-      const Glib::ustring &uri, const Glib::ustring &charset);
+  Glib::ustring get_subtitle_format_from_small_contents(Reader *reader);
 
-  // Try to determine the format of the subtitles in the submitted ustring
+  // Try to determine the format of the subtitles from the contents.
   // Exceptions:
   // UnrecognizeFormatError.
-  Glib::ustring get_subtitle_format_from_small_contents(
-      const Glib::ustring &data);
+  Glib::ustring get_subtitle_format_from_contents(
+      const Glib::ustring &contents);
 
-  // Try to determine the format of the subtitles in the submitted FileReader
-  // Exceptions:
-  // UnrecognizeFormatError.
-  Glib::ustring get_subtitle_format_from_small_contents(Reader *reader);
+  // Return the compiled regex of the detection pattern of a format.
+  // The patterns are compiled only once.
+  Glib::RefPtr<Glib::Regex> get_pattern(const Glib::ustring &pattern);
 
   // Create a SubtitleFormat from a name.
   // Throw UnrecognizeFormatError if failed.
@@ -107,4 +109,9 @@ class SubtitleFormatSystem {
   // Exceptions: UnrecognizeFormatError, Glib::Error...
   void open_from_reader(Document *document, Reader *reader,
                         const Glib::ustring &format = Glib::ustring());
+
+ protected:
+  // Cache of the compiled detection patterns
+  Glib::Threads::Mutex m_patterns_mutex;
+  std::map<Glib::ustring, Glib::RefPtr<Glib::Regex>> m_patterns;
 };
@@ -0,0 +1,278 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include "commandspill.h"
+#include "document.h"
+#include "subtitle.h"
+#include "subtitlejournal.h"
+
+// Number of entries checked by get_entry() without merge.
+static const gsize LOOKBACK_ENTRIES = 4;
+
+// The arena of the texts is compacted only when it wastes more than this size
+// and more than the half of its size.
+static const gsize TEXTS_COMPACT_MIN_UNUSED = 64 * 1024;
+
+SubtitleJournal::SubtitleJournal(Document *doc,
+                                 const Glib::ustring &description, bool merge)
+    : Command(doc, description), m_merge(merge) {
+}
+
+// Return the entry of (row, field), a new one if it doesn't exist.
+// Without merge, only the last entries are checked. It's enough for the
+// repeated changes of the same fields (ex: a boundary dragged in the
+// waveform sets the start and the duration on each motion).
+SubtitleJournal::Entry &SubtitleJournal::get_entry(guint32 row,
+                                                   SubtitleStore::Field field,
+                                                   bool &created) {
+  created = false;
+
+  if (m_merge) {
+    guint64 key = (static_cast<guint64>(row) << 8) | field;
+    auto it = m_index.find(key);
+    if (it != m_index.end())
+      return m_entries[it->second];
+    m_index[key] = m_entries.size();
+  } else {
+    gsize count = std::min<gsize>(m_entries.size(), LOOKBACK_ENTRIES);
+    for (gsize i = m_entries.size(); i > m_entries.size() - count; --i) {
+      Entry &entry = m_entries[i - 1];
+      if (entry.row == row && entry.field == static_cast<guint32>(field))
+        return entry;
+    }
+  }
+
+  created = true;
+  m_last_row = std::max<gint64>(m_last_row, row);
+
+  Entry entry;
+  entry.row = row;
+  entry.field = field;
+  m_entries.push_back(entry);
+  return m_entries.back();
+}
+
+// Copy the text in the arena.
+SubtitleJournal::Value SubtitleJournal::store_text(const Glib::ustring &text) {
+  Value value;
+  value.text.offset = m_texts.size();
+  value.text.size = text.bytes();
+  m_texts.append(text.raw());
+  return value;
+}
+
+// Replace the text of value. It's written in place if it's not longer,
+// otherwise at the end of the arena (the old text is unused).
+void SubtitleJournal::replace_text(Value &value, const Glib::ustring &text) {
+  if (text.bytes() <= value.text.size) {
+    text.raw().copy(&m_texts[value.text.offset], text.bytes());
+    m_texts_unused += value.text.size - text.bytes();
+    value.text.size = text.bytes();
+    return;
+  }
+
+  m_texts_unused += value.text.size;
+  value = store_text(text);
+
+  if (m_texts_unused > TEXTS_COMPACT_MIN_UNUSED &&
+      m_texts_unused > m_texts.size() / 2)
+    compact_texts();
+}
+
+// Rewrite the arena without the unused texts.
+void SubtitleJournal::compact_texts() {
+  std::string texts;
+  texts.reserve(m_texts.size() - m_texts_unused);
+
+  for (auto &entry : m_entries) {
+    SubtitleStore::Field field = static_cast<SubtitleStore::Field>(entry.field);
+    if (SubtitleStore::get_type(field) != SubtitleStore::STRING)
+      continue;
+    for (Value *value : {&entry.old_value, &entry.new_value}) {
+      guint32 offset = texts.size();
+      texts.append(m_texts, value->text.offset, value->text.size);
+      value->text.offset = offset;
+    }
+  }
+
+  m_texts.swap(texts);
+  m_texts_unused = 0;
+}
+
+Glib::ustring SubtitleJournal::get_text(const Value &value) const {
+  const char *data = m_texts.data() + value.text.offset;
+  return Glib::ustring(data, data + value.text.size);
+}
+
+void SubtitleJournal::add_int(const Subtitle &sub, SubtitleStore::Field field,
+                              gint64 value) {
+  bool created = false;
+  Entry &entry = get_entry(sub.get_num() - 1, field, created);
+  if (created)
+    entry.old_value.integer = sub.model()->get_int(sub.m_iter, field);
+  entry.new_value.integer = value;
+}
+
+void SubtitleJournal::add_double(const Subtitle &sub,
+                                 SubtitleStore::Field field, double value) {
+  bool created = false;
+  Entry &entry = get_entry(sub.get_num() - 1, field, created);
+  if (created)
+    entry.old_value.real = sub.model()->get_double(sub.m_iter, field);
+  entry.new_value.real = value;
+}
+
+void SubtitleJournal::add_text(const Subtitle &sub, SubtitleStore::Field field,
+                               const Glib::ustring &value) {
+  bool created = false;
+  Entry &entry = get_entry(sub.get_num() - 1, field, created);
+  if (created) {
+    entry.old_value = store_text(sub.model()->get_ustring(sub.m_iter, field));
+    entry.new_value = store_text(value);
+  } else {
+    // the same text is often changed several times (typing)
+    replace_text(entry.new_value, value);
+  }
+}
+
+bool SubtitleJournal::empty() const {
+  return m_entries.empty();
+}
+
+bool SubtitleJournal::is_merging() const {
+  return m_merge;
+}
+
+// Return true if the journal has a change of the row or of a row after it.
+bool SubtitleJournal::has_changes_from(guint32 row) const {
+  return m_last_row >= static_cast<gint64>(row);
+}
+
+void SubtitleJournal::execute() {
+  for (const auto &entry : m_entries) {
+    apply(entry, entry.new_value);
+  }
+}
+
+void SubtitleJournal::restore() {
+  for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+    apply(*it, it->old_value);
+  }
+}
+
+gsize SubtitleJournal::memory_usage() const {
+  gsize size = sizeof(SubtitleJournal) + m_description.bytes();
+  size += m_entries.capacity() * sizeof(Entry);
+  size += m_texts.capacity();
+  size += m_index.size() * (sizeof(guint64) + sizeof(guint32) + 16);
+  return size;
+}
+
+// The journals can be merged if they change the same fields of the same
+// subtitles in the same order.
+bool SubtitleJournal::can_merge(const Command *cmd) const {
+  const SubtitleJournal *journal = dynamic_cast<const SubtitleJournal *>(cmd);
+  if (journal == nullptr || m_spill_offset != -1 ||
+      journal->m_spill_offset != -1)
+    return false;
+
+  if (m_entries.empty() || m_entries.size() != journal->m_entries.size())
+    return false;
+
+  for (gsize i = 0; i < m_entries.size(); ++i) {
+    if (m_entries[i].row != journal->m_entries[i].row ||
+        m_entries[i].field != journal->m_entries[i].field)
+      return false;
+  }
+  return true;
+}
+
+// Keep the old values of this journal and the new values of cmd.
+void SubtitleJournal::merge(Command *cmd) {
+  SubtitleJournal *journal = static_cast<SubtitleJournal *>(cmd);
+
+  for (gsize i = 0; i < m_entries.size(); ++i) {
+    Entry &entry = m_entries[i];
+    const Entry &other = journal->m_entries[i];
+
+    SubtitleStore::Field field = static_cast<SubtitleStore::Field>(entry.field);
+    if (SubtitleStore::get_type(field) == SubtitleStore::STRING)
+      replace_text(entry.new_value, journal->get_text(other.new_value));
+    else
+      entry.new_value = other.new_value;
+  }
+}
+
+// The entries and the texts are written one after the other in the file.
+// A spilled journal is finished, the merge index isn't needed anymore.
+gsize SubtitleJournal::spill(CommandSpillFile &file) {
+  if (m_spill_offset != -1 || m_entries.empty())
+    return 0;
+
+  gsize entries_size = m_entries.size() * sizeof(Entry);
+  gint64 offset = file.write(m_entries.data(), entries_size);
+  file.write(m_texts.data(), m_texts.size());
+
+  m_spill_offset = offset;
+  m_spill_entries = m_entries.size();
+  m_spill_texts = m_texts.size();
+
+  std::vector<Entry>().swap(m_entries);
+  std::string().swap(m_texts);
+  std::unordered_map<guint64, guint32>().swap(m_index);
+
+  return entries_size + m_spill_texts;
+}
+
+void SubtitleJournal::unspill(CommandSpillFile &file) {
+  if (m_spill_offset == -1)
+    return;
+
+  gint64 offset = m_spill_offset;
+  m_spill_offset = -1;
+
+  m_entries.resize(m_spill_entries);
+  m_texts.resize(m_spill_texts);
+
+  gsize entries_size = m_spill_entries * sizeof(Entry);
+  file.read(offset, &m_entries[0], entries_size);
+  file.read(offset + entries_size, &m_texts[0], m_spill_texts);
+}
+
+// Set the value of the field of the entry subtitle.
+void SubtitleJournal::apply(const Entry &entry, const Value &value) {
+  Subtitle sub(document(), get_document_subtitle_model()->find(entry.row + 1));
+  g_return_if_fail(sub);
+
+  SubtitleStore::Field field = static_cast<SubtitleStore::Field>(entry.field);
+  switch (SubtitleStore::get_type(field)) {
+    case SubtitleStore::INT:
+      sub.set_int(field, value.integer);
+      break;
+    case SubtitleStore::DOUBLE:
+      sub.set_double(field, value.real);
+      break;
+    case SubtitleStore::STRING:
+      sub.set_string(field, get_text(value));
+      break;
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "command.h"
+#include "subtitlestore.h"
+
+class Subtitle;
+
+// Undo entry of the changes of the subtitles.
+// Each change is a packed entry (row, field, old value, new value), the
+// values are numbers or texts stored in an arena. Undo and redo replay the
+// entries in a loop.
+// The consecutive changes of a group share the same journal.
+class SubtitleJournal : public Command {
+ public:
+  // The changes of the same field of the same subtitle are merged, only the
+  // first old value and the last new value are kept. If merge is true (bulk
+  // edit) all the changes are checked, otherwise only the last ones.
+  SubtitleJournal(Document *doc, const Glib::ustring &description,
+                  bool merge = false);
+
+  // Record the change of the field of sub to value.
+  // Must be called before the value is set.
+  void add_int(const Subtitle &sub, SubtitleStore::Field field, gint64 value);
+
+  void add_double(const Subtitle &sub, SubtitleStore::Field field,
+                  double value);
+
+  void add_text(const Subtitle &sub, SubtitleStore::Field field,
+                const Glib::ustring &value);
+
+  bool empty() const;
+
+  bool is_merging() const;
+
+  // Return true if the journal has a change of the row or of a row after it.
+  bool has_changes_from(guint32 row) const;
+
+  void execute();
+
+  void restore();
+
+  gsize memory_usage() const;
+
+  // The journals can be merged if they change the same fields of the same
+  // subtitles in the same order.
+  bool can_merge(const Command *cmd) const;
+
+  // Keep the old values of this journal and the new values of cmd.
+  void merge(Command *cmd);
+
+  // The entries and the texts are written in the file.
+  gsize spill(CommandSpillFile &file);
+  void unspill(CommandSpillFile &file);
+
+ protected:
+  union Value {
+    gint64 integer;
+    double real;
+    struct {
+      guint32 offset;
+      guint32 size;
+    } text;
+  };
+
+  struct Entry {
+    guint32 row;
+    guint32 field;
+    Value old_value;
+    Value new_value;
+  };
+
+  // Return the entry of (row, field), a new one if it doesn't exist.
+  // created is true for a new entry.
+  Entry &get_entry(guint32 row, SubtitleStore::Field field, bool &created);
+
+  // Copy the text in the arena.
+  Value store_text(const Glib::ustring &text);
+
+  // Replace the text of value, in place if it's not longer.
+  void replace_text(Value &value, const Glib::ustring &text);
+
+  // Rewrite the arena without the unused texts.
+  void compact_texts();
+
+  Glib::ustring get_text(const Value &value) const;
+
+  // Set the value of the field of the entry subtitle.
+  void apply(const Entry &entry, const Value &value);
+
+ protected:
+  bool m_merge;
+  std::vector<Entry> m_entries;
+  std::string m_texts;
+  // bytes of the replaced texts in m_texts
+  gsize m_texts_unused{0};
+  // (row, field) -> index in m_entries, only used with merge
+  std::unordered_map<guint64, guint32> m_index;
+  // The last row changed, -1 if there is no change
+  gint64 m_last_row{-1};
+  // offset of the entries in the spill file or -1
+  gint64 m_spill_offset{-1};
+  gsize m_spill_entries{0};
+  gsize m_spill_texts{0};
+};
@@ -19,127 +19,181 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <gtkmm/treemodel.h>
+#include <algorithm>
+#include <limits>
 #include "command.h"
 #include "debug.h"
 #include "document.h"
 #include "i18n.h"
 #include "subtitlemodel.h"
+#include "utility.h"
 
-class AddSubtitleCommand : public Command {
+// Backup of one row, used by the drag and drop.
+class RowBackupCommand : public Command {
  public:
-  AddSubtitleCommand(Document *doc, const Gtk::TreeIter &iter)
-      : Command(doc, _("Add Subtitle")) {
-    Subtitle sub(doc, iter);
-    sub.get(m_backup);
+  RowBackupCommand(Document *doc, const Glib::ustring &description,
+                   const Gtk::TreeIter &iter)
+      : Command(doc, description) {
+    SubtitleModelPtr model = get_document_subtitle_model();
+    m_row = model->get_int(iter, SubtitleStore::NUM) - 1;
+    m_slot = model->save_row(iter, m_backup);
   }
 
-  void execute() {
-    Glib::ustring path = m_backup["path"];
+  gsize memory_usage() const {
+    return Command::memory_usage() + m_backup.memory_usage();
+  }
 
-    Gtk::TreeIter iter = get_document_subtitle_model()->append();
+ protected:
+  // Insert the row at its position and set its values.
+  void insert_row() {
+    SubtitleModelPtr model = get_document_subtitle_model();
+    Gtk::TreeIter iter = model->insert(model->find(m_row + 1));
+    model->load_row(iter, m_backup, m_slot);
+  }
 
-    Subtitle sub(document(), iter);
-    sub.set(m_backup);
+  void erase_row() {
+    SubtitleModelPtr model = get_document_subtitle_model();
+    Gtk::TreeIter iter = model->find(m_row + 1);
+    g_return_if_fail(iter);
+    model->erase(iter);
+  }
 
-    get_document_subtitle_model()->move(
-        iter, get_document_subtitle_model()->get_iter(path));
+ protected:
+  guint32 m_row;
+  SubtitleStore m_backup;
+  SubtitleStore::Slot m_slot;
+};
 
-    get_document_subtitle_model()->rebuild_column_num();
+class AddSubtitleCommand : public RowBackupCommand {
+ public:
+  AddSubtitleCommand(Document *doc, const Gtk::TreeIter &iter)
+      : RowBackupCommand(doc, _("Add Subtitle"), iter) {
   }
 
-  void restore() {
-    Gtk::TreeIter iter =
-        get_document_subtitle_model()->get_iter(m_backup["path"]);
-    get_document_subtitle_model()->erase(iter);
-    get_document_subtitle_model()->rebuild_column_num();
+  void execute() {
+    insert_row();
   }
 
- protected:
-  std::map<Glib::ustring, Glib::ustring> m_backup;
+  void restore() {
+    erase_row();
+  }
 };
 
-class RemoveSubtitleCommand : public Command {
+class RemoveSubtitleCommand : public RowBackupCommand {
  public:
   RemoveSubtitleCommand(Document *doc, const Gtk::TreeIter &iter)
-      : Command(doc, _("Remove Subtitle")) {
-    Subtitle sub(doc, iter);
-    sub.get(m_backup);
+      : RowBackupCommand(doc, _("Remove Subtitle"), iter) {
   }
 
   void execute() {
-    Gtk::TreeIter iter =
-        get_document_subtitle_model()->get_iter(m_backup["path"]);
-    get_document_subtitle_model()->erase(iter);
-    get_document_subtitle_model()->rebuild_column_num();
+    erase_row();
   }
 
   void restore() {
-    Glib::ustring path = m_backup["path"];
+    insert_row();
+  }
+};
+
+SubtitleModel::SubtitleModel(Document *doc)
+    : Glib::ObjectBase(typeid(SubtitleModel)),
+      Glib::Object(),
+      m_document(doc) {
+  m_stamp = g_random_int();
+  if (m_stamp == 0)
+    m_stamp = 1;
+
+  // Any change of the rows (position or number) makes the time index out of
+  // date. The changes of start/end values are reported by the Subtitle.
+  signal_row_inserted().connect(
+      sigc::mem_fun(*this, &SubtitleModel::on_time_index_row_inserted));
+  signal_row_deleted().connect(
+      sigc::mem_fun(*this, &SubtitleModel::on_time_index_row_deleted));
+  signal_rows_reordered().connect(
+      sigc::mem_fun(*this, &SubtitleModel::on_time_index_rows_reordered));
+}
 
-    Gtk::TreeIter iter = get_document_subtitle_model()->append();
+Gtk::TreeIter SubtitleModel::append() {
+  return insert_row(m_rows.size());
+}
+
+// Insert a new empty row before iter (or at the end if iter is not valid).
+Gtk::TreeIter SubtitleModel::insert(const Gtk::TreeIter &iter) {
+  guint32 row = (iter) ? get_row(get_slot(iter)) : m_rows.size();
+  return insert_row(row);
+}
 
-    Subtitle sub(document(), iter);
-    sub.set(m_backup);
+// Insert a new empty row after iter (or at the start if iter is not valid).
+Gtk::TreeIter SubtitleModel::insert_after(const Gtk::TreeIter &iter) {
+  guint32 row = (iter) ? get_row(get_slot(iter)) + 1 : 0;
+  return insert_row(row);
+}
 
-    get_document_subtitle_model()->move(
-        iter, get_document_subtitle_model()->get_iter(path));
+// Remove the row and return the next one.
+Gtk::TreeIter SubtitleModel::erase(const Gtk::TreeIter &iter) {
+  Gtk::TreeIter next = iter;
+  ++next;
 
-    get_document_subtitle_model()->rebuild_column_num();
+  erase_row(get_row(get_slot(iter)));
+  return next;
+}
+
+// Move source before destination (or at the end if destination is not
+// valid).
+void SubtitleModel::move(const Gtk::TreeIter &source,
+                         const Gtk::TreeIter &destination) {
+  g_return_if_fail(source);
+
+  guint32 from = get_row(get_slot(source));
+  guint32 to =
+      (destination) ? get_row(get_slot(destination)) : m_rows.size();
+  if (to > from)
+    --to;
+  if (to == from)
+    return;
+
+  std::vector<int> new_order(m_rows.size());
+  for (guint32 i = 0; i < new_order.size(); ++i) {
+    new_order[i] = i;
   }
+  new_order.erase(new_order.begin() + from);
+  new_order.insert(new_order.begin() + to, from);
 
- protected:
-  std::map<Glib::ustring, Glib::ustring> m_backup;
-};
+  SubtitleStore::Slot slot = m_rows[from];
+  m_rows.erase(m_rows.begin() + from);
+  m_rows.insert(m_rows.begin() + to, slot);
 
-SubtitleModel::SubtitleModel(Document *doc) : m_document(doc) {
-  set_column_types(m_column);
+  emit_rows_reordered(new_order);
 }
 
-Gtk::TreeIter SubtitleModel::append() {
-  Gtk::TreeIter it = Gtk::ListStore::append();
-  init(it);
+// new_order[newpos] = oldpos
+void SubtitleModel::reorder(const std::vector<int> &new_order) {
+  g_return_if_fail(new_order.size() == m_rows.size());
+
+  std::vector<SubtitleStore::Slot> rows(m_rows.size());
+  for (guint32 i = 0; i < rows.size(); ++i) {
+    rows[i] = m_rows[new_order[i]];
+  }
+  m_rows.swap(rows);
 
-  (*it)[m_column.num] = getSize();
-  return it;
+  std::vector<int> order(new_order);
+  emit_rows_reordered(order);
 }
 
 // insert sub avant iter et retourne l'iter de sub
-// et declale tout les autres (sub.num)
+// (les num suivent la position des lignes)
 Gtk::TreeIter SubtitleModel::insertBefore(Gtk::TreeIter &iter) {
-  Gtk::TreeIter res = insert(iter);
-  init(res);
-  (*res)[m_column.num] = (unsigned int)(*iter)[m_column.num];
-
-  for (; iter; ++iter) {
-    (*iter)[m_column.num] = (*iter)[m_column.num] + 1;
-  }
-  return res;
+  return insert_row(get_row(get_slot(iter)));
 }
 
 // insert sub apres iter et retourne l'iter de sub
-// et declale tout les autres (sub.num)
+// (les num suivent la position des lignes)
 Gtk::TreeIter SubtitleModel::insertAfter(Gtk::TreeIter &iter) {
-  Gtk::TreeIter res = insert_after(iter);
-  init(res);
-
-  (*res)[m_column.num] = (*iter)[m_column.num] + 1;
-
-  ++iter;  // le nouveau ajouter
-  ++iter;  // le suivant on commence a partir de lui
-
-  for (; iter; ++iter) {
-    (*iter)[m_column.num] = (*iter)[m_column.num] + 1;
-  }
-
-  return res;
+  return insert_row(get_row(get_slot(iter)) + 1);
 }
 
-// efface un subtitle, on init les suivants avec le bon num
+// efface un subtitle
 void SubtitleModel::remove(Gtk::TreeIter &it) {
-  Gtk::TreeIter iter = erase(it);
-  for (; iter; ++iter) {
-    (*iter)[m_column.num] = (*iter)[m_column.num] - 1;
-  }
+  erase_row(get_row(get_slot(it)));
 }
 
 void SubtitleModel::remove(unsigned int start, unsigned int end) {
@@ -151,64 +205,29 @@ void SubtitleModel::remove(unsigned int start, unsigned int end) {
   g_return_if_fail(a);
   // g_return_if_fail(b);
 
-  if (b) {
-    ++b;
-    for (; a != b;) {
-      a = erase(a);
-    }
+  guint32 first = get_row(get_slot(a));
+  guint32 last = (b) ? get_row(get_slot(b)) + 1 : m_rows.size();
 
-    // on decale num des suivants si il y en a
-    if (b) {
-      int diff = end - start + 1;
-      for (; b; ++b) {
-        (*b)[m_column.num] = (*b)[m_column.num] - diff;
-      }
-    }
-  } else {
-    for (; a;) {
-      a = erase(a);
-    }
+  // from the end, the rows before are not moved
+  for (guint32 row = last; row > first; --row) {
+    erase_row(row - 1);
   }
 }
 
 // init l'iter a 0
 void SubtitleModel::init(Gtk::TreeIter &iter) {
-  (*iter)[m_column.num] = 0;
-
-  // The visual value. Depend of *_value
-
-  Glib::ustring default_view_value =
-      (m_document->get_edit_timing_mode() == TIME) ? SubtitleTime::null() : "0";
-
-  // The real value of time
-  (*iter)[m_column.start_value] = 0;
-  (*iter)[m_column.end_value] = 0;
-  (*iter)[m_column.duration_value] = 0;
-
-  (*iter)[m_column.text] = "";
-
-  (*iter)[m_column.layer] = "0";
-  (*iter)[m_column.style] = "Default";
-  // (*iter)[m_column.name] = "";
-
-  (*iter)[m_column.marginL] = "0";
-  (*iter)[m_column.marginR] = "0";
-  (*iter)[m_column.marginV] = "0";
-
-  // (*iter)[m_column.effect] = "";
-  // (*iter)[m_column.translation] = "";
-
-  (*iter)[m_column.characters_per_line_text] = "0";
-  (*iter)[m_column.characters_per_line_translation] = "0";
+  long old_start = m_store.get_int(get_slot(iter), SubtitleStore::START);
+  m_store.reset(get_slot(iter));
+  update_time_index_entry(iter, old_start);
+  emit_row_changed(iter);
 }
 
 // retourne le premier element de la list
 // ou un iterator invalide
 Gtk::TreeIter SubtitleModel::getFirst() {
-  if (getSize() > 0) {
-    Gtk::TreeNodeChildren rows = children();
-    return rows.begin();
-  }
+  if (!m_rows.empty())
+    return create_iter(0);
+
   Gtk::TreeIter nul;
   return nul;
 }
@@ -216,11 +235,8 @@ Gtk::TreeIter SubtitleModel::getFirst() {
 // retourne le dernier element de la list
 // ou un iterator invalide
 Gtk::TreeIter SubtitleModel::getLast() {
-  Gtk::TreeNodeChildren rows = children();
-
-  if (!rows.empty()) {
-    return rows[rows.size() - 1];
-  }
+  if (!m_rows.empty())
+    return create_iter(m_rows.size() - 1);
 
   Gtk::TreeIter nul;
   return nul;
@@ -228,43 +244,186 @@ Gtk::TreeIter SubtitleModel::getLast() {
 
 // retourne le nombre d'element dans la list
 unsigned int SubtitleModel::getSize() {
-  // Gtk::TreeNodeChildren rows = children();
-  return children().size();
+  return m_rows.size();
 }
 
 // FONCTION DE RECHERCHE
 
 // recherche un subtitle
-// grace a son numero
+// grace a son numero (sa position + 1)
 Gtk::TreeIter SubtitleModel::find(unsigned int num) {
-  Gtk::TreeNodeChildren rows = children();
-  for (Gtk::TreeIter it = rows.begin(); it; ++it) {
-    if ((*it)[m_column.num] == num)
-      return it;
-  }
+  if (num >= 1 && num <= m_rows.size())
+    return create_iter(num - 1);
+
   Gtk::TreeIter nul;
   return nul;
 }
 
-Gtk::TreeIter SubtitleModel::find(const SubtitleTime &time) {
+// Convert the time to the model value (msecs or frame).
+long SubtitleModel::time_to_model_value(const SubtitleTime &time) {
   // We need to convert time to frame if the current model is frame based.
-  long val = 0;
   if (m_document->get_timing_mode() == TIME)
-    val = time.totalmsecs;
-  else
-    val = SubtitleTime::time_to_frame(
-        time, get_framerate_value(m_document->get_framerate()));
-
-  Gtk::TreeNodeChildren rows = children();
-  for (Gtk::TreeIter it = rows.begin(); it; ++it) {
-    if (val >= long((*it)[m_column.start_value]) &&
-        val <= long((*it)[m_column.end_value]))
-      return it;
+    return time.totalmsecs;
+  return SubtitleTime::time_to_frame(
+      time, get_framerate_value(m_document->get_framerate()));
+}
+
+// Return the first subtitle (in the document order) where time is between
+// start and end.
+Gtk::TreeIter SubtitleModel::find(const SubtitleTime &time) {
+  long val = time_to_model_value(time);
+
+  update_time_index();
+
+  // All the entries from 'last' start after val.
+  auto last = std::upper_bound(
+      m_time_index.begin(), m_time_index.end(), val,
+      [](long v, const TimeIndexEntry &e) { return v < e.start; });
+
+  // Walk back while a previous subtitle can still end after val. In a
+  // document without overlapping this is only one or two entries.
+  const TimeIndexEntry *found = nullptr;
+  for (auto it = last; it != m_time_index.begin();) {
+    --it;
+    if (it->max_end < val)
+      break;
+    if (val <= it->end && (found == nullptr || it->row < found->row))
+      found = &(*it);
   }
+
+  if (found)
+    return found->iter;
+
+  Gtk::TreeIter nul;
+  return nul;
+}
+
+// Return the first subtitle (by start time) which starts at or after time.
+Gtk::TreeIter SubtitleModel::find_at_or_after(const SubtitleTime &time) {
+  long val = time_to_model_value(time);
+
+  update_time_index();
+
+  auto it = std::lower_bound(
+      m_time_index.begin(), m_time_index.end(), val,
+      [](const TimeIndexEntry &e, long v) { return e.start < v; });
+
+  if (it != m_time_index.end())
+    return it->iter;
+
   Gtk::TreeIter nul;
   return nul;
 }
 
+// Mark the time index as out of date.
+void SubtitleModel::invalidate_time_index() {
+  m_time_index_valid = false;
+}
+
+// The start or the end of the row has changed, move its entry to the new
+// place (binary search) and fix the max_end values from there.
+// old_start is the start value used to find the current entry.
+void SubtitleModel::update_time_index_entry(const Gtk::TreeIter &iter,
+                                            long old_start) {
+  if (!m_time_index_valid)
+    return;
+
+  SubtitleStore::Slot slot = get_slot(iter);
+
+  TimeIndexEntry key;
+  key.start = old_start;
+  key.row = get_row(slot);
+
+  auto it = std::lower_bound(m_time_index.begin(), m_time_index.end(), key);
+  if (it == m_time_index.end() || it->start != key.start ||
+      it->row != key.row) {
+    // should not happen, fallback to a full rebuild
+    invalidate_time_index();
+    return;
+  }
+
+  it->start = m_store.get_int(slot, SubtitleStore::START);
+  it->end = m_store.get_int(slot, SubtitleStore::END);
+
+  size_t old_pos = it - m_time_index.begin();
+  size_t new_pos = old_pos;
+
+  if (it != m_time_index.begin() && *it < *(it - 1)) {
+    // move backward
+    auto dest = std::lower_bound(m_time_index.begin(), it, *it);
+    std::rotate(dest, it, it + 1);
+    new_pos = dest - m_time_index.begin();
+  } else if (it + 1 != m_time_index.end() && *(it + 1) < *it) {
+    // move forward
+    auto dest = std::lower_bound(it + 1, m_time_index.end(), *it);
+    std::rotate(it, it + 1, dest);
+    new_pos = (dest - m_time_index.begin()) - 1;
+  }
+
+  // Only the entries from the first moved position can have a different
+  // max_end. After the last one, stop as soon as the value is unchanged.
+  size_t first = std::min(old_pos, new_pos);
+  size_t last = std::max(old_pos, new_pos);
+
+  long max_end = (first == 0) ? std::numeric_limits<long>::min()
+                              : m_time_index[first - 1].max_end;
+  for (size_t i = first; i < m_time_index.size(); ++i) {
+    TimeIndexEntry &entry = m_time_index[i];
+    max_end = std::max(max_end, entry.end);
+    if (i > last && entry.max_end == max_end)
+      break;
+    entry.max_end = max_end;
+  }
+}
+
+// Rebuild the time index from the model if needed.
+// The index is sorted by start (then by row), it works even if the document
+// is not sorted by time.
+void SubtitleModel::update_time_index() {
+  if (m_time_index_valid)
+    return;
+
+  m_time_index.clear();
+  m_time_index.reserve(m_rows.size());
+
+  for (guint32 row = 0; row < m_rows.size(); ++row) {
+    TimeIndexEntry entry;
+    entry.start = m_store.get_int(m_rows[row], SubtitleStore::START);
+    entry.end = m_store.get_int(m_rows[row], SubtitleStore::END);
+    entry.max_end = 0;
+    entry.row = row;
+    entry.iter = create_iter(row);
+    m_time_index.push_back(entry);
+  }
+
+  std::sort(m_time_index.begin(), m_time_index.end());
+
+  long max_end = std::numeric_limits<long>::min();
+  for (auto &entry : m_time_index) {
+    max_end = std::max(max_end, entry.end);
+    entry.max_end = max_end;
+  }
+
+  m_time_index_valid = true;
+}
+
+void SubtitleModel::on_time_index_row_inserted(
+    const Gtk::TreeModel::Path & /*path*/,
+    const Gtk::TreeModel::iterator & /*iter*/) {
+  invalidate_time_index();
+}
+
+void SubtitleModel::on_time_index_row_deleted(
+    const Gtk::TreeModel::Path & /*path*/) {
+  invalidate_time_index();
+}
+
+void SubtitleModel::on_time_index_rows_reordered(
+    const Gtk::TreeModel::Path & /*path*/,
+    const Gtk::TreeModel::iterator & /*iter*/, int * /*new_order*/) {
+  invalidate_time_index();
+}
+
 // hack ?
 bool compare_str(const Glib::ustring &src, const Glib::ustring &txt) {
   unsigned int size = src.size();
@@ -284,14 +443,13 @@ Gtk::TreeIter SubtitleModel::find_text(Gtk::TreeIter &start,
                                        const Glib::ustring &text) {
   if (start) {
     Glib::ustring it_text;
-    Gtk::TreeIter it = start;
-    ++it;
 
-    for (; it; ++it) {
-      it_text = (*it)[m_column.text];
+    for (guint32 row = get_row(get_slot(start)) + 1; row < m_rows.size();
+         ++row) {
+      it_text = m_store.get_string(m_rows[row], SubtitleStore::TEXT);
 
       if (compare_str(it_text, text))
-        return it;
+        return create_iter(row);
     }
   }
   Gtk::TreeIter nul;
@@ -299,16 +457,16 @@ Gtk::TreeIter SubtitleModel::find_text(Gtk::TreeIter &start,
 }
 
 // recherche l'iterator precedant iter
+// The position of the row is known, stepping back does not need to scan the
+// rows. The result is invalid if iter is the first row.
 Gtk::TreeIter SubtitleModel::find_previous(const Gtk::TreeIter &iter) {
-  Gtk::TreeIter res;
-  Gtk::TreeNodeChildren rows = children();
-  for (Gtk::TreeIter it = rows.begin(); it; ++it) {
-    if (it == iter)
-      return res;
-
-    res = it;
+  if (iter) {
+    guint32 row = get_row(get_slot(iter));
+    if (row > 0)
+      return create_iter(row - 1);
   }
-  return res;
+  Gtk::TreeIter nul;
+  return nul;
 }
 
 // recherche l'iterator suivant iter
@@ -326,73 +484,455 @@ Gtk::TreeIter SubtitleModel::find_next(const Gtk::TreeIter &iter) {
 void SubtitleModel::copy(Glib::RefPtr<SubtitleModel> src) {
   g_return_if_fail(src);
 
-#define SET(col, cast) (*new_it)[m_column.col] = (cast)(*it)[m_column.col]
+  for (guint32 row = 0; row < src->m_rows.size(); ++row) {
+    Gtk::TreeIter it = insert_row(m_rows.size());
+    m_store.copy(get_slot(it), src->m_store, src->m_rows[row]);
+  }
+}
 
-  Gtk::TreeNodeChildren rows = src->children();
+// The number of a subtitle is its position (+1) in the model.
+gint64 SubtitleModel::get_int(const Gtk::TreeIter &iter,
+                              SubtitleStore::Field field) const {
+  if (field == SubtitleStore::NUM)
+    return get_row(get_slot(iter)) + 1;
+  return m_store.get_int(get_slot(iter), field);
+}
 
-  for (Gtk::TreeIter it = rows.begin(); it; ++it) {
-    Gtk::TreeIter new_it = Gtk::ListStore::append();
+void SubtitleModel::set_int(const Gtk::TreeIter &iter,
+                            SubtitleStore::Field field, gint64 value) {
+  g_return_if_fail(field != SubtitleStore::NUM);
 
-    SET(num, unsigned int);
+  long old_start = m_store.get_int(get_slot(iter), SubtitleStore::START);
+  m_store.set_int(get_slot(iter), field, value);
+  if (field == SubtitleStore::START || field == SubtitleStore::END)
+    update_time_index_entry(iter, old_start);
+  emit_row_changed(iter);
+}
 
-    SET(layer, Glib::ustring);
+double SubtitleModel::get_double(const Gtk::TreeIter &iter,
+                                 SubtitleStore::Field field) const {
+  SubtitleStore::Slot slot = get_slot(iter);
+  update_metrics(slot);
+  return m_store.get_double(slot, field);
+}
 
-    SET(start_value, long);
-    SET(end_value, long);
-    SET(duration_value, long);
+void SubtitleModel::set_double(const Gtk::TreeIter &iter,
+                               SubtitleStore::Field field, double value) {
+  m_store.set_double(get_slot(iter), field, value);
+  emit_row_changed(iter);
+}
 
-    SET(style, Glib::ustring);
-    SET(name, Glib::ustring);
+Glib::ustring SubtitleModel::get_ustring(const Gtk::TreeIter &iter,
+                                         SubtitleStore::Field field) const {
+  SubtitleStore::Slot slot = get_slot(iter);
+  if (field == SubtitleStore::CHARACTERS_PER_LINE_TEXT ||
+      field == SubtitleStore::CHARACTERS_PER_LINE_TRANSLATION)
+    update_metrics(slot);
+  return m_store.get_string(slot, field);
+}
 
-    SET(marginL, Glib::ustring);
-    SET(marginR, Glib::ustring);
-    SET(marginV, Glib::ustring);
+void SubtitleModel::set_ustring(const Gtk::TreeIter &iter,
+                                SubtitleStore::Field field,
+                                const Glib::ustring &value) {
+  m_store.set_string(get_slot(iter), field, value);
+  emit_row_changed(iter);
+}
 
-    SET(effect, Glib::ustring);
+// Copy the values of the row in a new slot of backup (undo/redo).
+SubtitleStore::Slot SubtitleModel::save_row(const Gtk::TreeIter &iter,
+                                            SubtitleStore &backup) const {
+  SubtitleStore::Slot slot = backup.create();
+  backup.copy(slot, m_store, get_slot(iter));
+  return slot;
+}
 
-    SET(text, Glib::ustring);
+// Set the values of the row from the slot of backup.
+void SubtitleModel::load_row(const Gtk::TreeIter &iter,
+                             const SubtitleStore &backup,
+                             SubtitleStore::Slot slot) {
+  long old_start = m_store.get_int(get_slot(iter), SubtitleStore::START);
+  m_store.copy(get_slot(iter), backup, slot);
+  update_time_index_entry(iter, old_start);
+  emit_row_changed(iter);
+}
 
-    SET(translation, Glib::ustring);
+// Return the number of bytes used by the values of the subtitles.
+gsize SubtitleModel::memory_usage() const {
+  return m_store.memory_usage() +
+         m_rows.capacity() * sizeof(SubtitleStore::Slot) +
+         m_row_of_slot.capacity() * sizeof(guint32) +
+         m_slot_generation.capacity() * sizeof(guint32);
+}
 
-    SET(characters_per_line_text, Glib::ustring);
-    SET(characters_per_line_translation, Glib::ustring);
+// Rows and slots
 
-    SET(note, Glib::ustring);
+// The slot is stored in the user_data of the iter (+1, never NULL).
+SubtitleStore::Slot SubtitleModel::get_slot(const Gtk::TreeIter &iter) const {
+  return GPOINTER_TO_UINT(iter.gobj()->user_data) - 1;
+}
+
+// The generation of the slot is stored in the user_data2 of the iter, it
+// changes when the row is removed and the slot can be reused by a new row.
+bool SubtitleModel::iter_is_valid(const Gtk::TreeIter &iter) const {
+  const GtkTreeIter *c_iter = iter.gobj();
+  if (c_iter->stamp != m_stamp || c_iter->user_data == nullptr)
+    return false;
+
+  SubtitleStore::Slot slot = get_slot(iter);
+  return slot < m_slot_generation.size() &&
+         GPOINTER_TO_UINT(c_iter->user_data2) == m_slot_generation[slot];
+}
+
+// Return the position of the slot in the model.
+// The positions after an insertion or a deletion are updated on demand.
+guint32 SubtitleModel::get_row(SubtitleStore::Slot slot) const {
+  guint32 row = m_row_of_slot[slot];
+  if (row < m_rows.size() && m_rows[row] == slot)
+    return row;
+
+  for (guint32 i = m_row_of_slot_valid; i < m_rows.size(); ++i) {
+    m_row_of_slot[m_rows[i]] = i;
   }
-#undef SET
+  m_row_of_slot_valid = m_rows.size();
+
+  return m_row_of_slot[slot];
 }
 
-// check la colonne num pour init de [1,size]
-void SubtitleModel::rebuild_column_num() {
-  unsigned int id = 1;
-  Gtk::TreeNodeChildren rows = children();
+// Return an iter pointing to the row.
+Gtk::TreeIter SubtitleModel::create_iter(guint32 row) {
+  GtkTreeIter iter;
+  iter.stamp = m_stamp;
+  iter.user_data = GUINT_TO_POINTER(m_rows[row] + 1);
+  iter.user_data2 = GUINT_TO_POINTER(m_slot_generation[m_rows[row]]);
+  iter.user_data3 = nullptr;
+  return Gtk::TreeIter(Gtk::TreeModel::gobj(), &iter);
+}
+
+// Set iter to the row.
+void SubtitleModel::set_iter(Gtk::TreeIter &iter, guint32 row) const {
+  GtkTreeIter *c_iter = iter.gobj();
+  c_iter->stamp = m_stamp;
+  c_iter->user_data = GUINT_TO_POINTER(m_rows[row] + 1);
+  c_iter->user_data2 = GUINT_TO_POINTER(m_slot_generation[m_rows[row]]);
+  c_iter->user_data3 = nullptr;
+}
 
-  for (Gtk::TreeIter it = rows.begin(); it; ++it, ++id) {
-    (*it)[m_column.num] = id;
+// Create a new slot and insert it at the row position.
+Gtk::TreeIter SubtitleModel::insert_row(guint32 row) {
+  g_return_val_if_fail(row <= m_rows.size(), Gtk::TreeIter());
+
+  SubtitleStore::Slot slot = m_store.create();
+
+  if (slot >= m_row_of_slot.size()) {
+    m_row_of_slot.resize(slot + 1);
+    m_slot_generation.resize(slot + 1);
   }
+
+  m_rows.insert(m_rows.begin() + row, slot);
+
+  // the rows after are moved
+  m_row_of_slot[slot] = row;
+  if (m_row_of_slot_valid >= row)
+    m_row_of_slot_valid = row + 1;
+
+  Gtk::TreeIter iter = create_iter(row);
+
+  Gtk::TreeModel::Path path;
+  path.push_back(row);
+  row_inserted(path, iter);
+
+  return iter;
 }
 
-bool SubtitleModel::drag_data_delete_vfunc(const TreeModel::Path &path) {
-  m_document->add_command(
-      new RemoveSubtitleCommand(m_document, get_iter(path)));
-  m_document->finish_command();
+// Remove the row from the model and release its slot.
+void SubtitleModel::erase_row(guint32 row) {
+  g_return_if_fail(row < m_rows.size());
 
-  bool res = Gtk::ListStore::drag_data_delete_vfunc(path);
+  SubtitleStore::Slot slot = m_rows[row];
+  m_rows.erase(m_rows.begin() + row);
+  m_row_of_slot_valid = std::min(m_row_of_slot_valid, row);
 
-  rebuild_column_num();
+  m_store.release(slot);
+  // the iters of the row are no more valid
+  ++m_slot_generation[slot];
 
-  return res;
+  Gtk::TreeModel::Path path;
+  path.push_back(row);
+  row_deleted(path);
+}
+
+// Emit rows_reordered for the whole list.
+// The C function is used, the iter of the toplevel must be NULL.
+void SubtitleModel::emit_rows_reordered(std::vector<int> &new_order) {
+  m_row_of_slot_valid = 0;
+
+  if (new_order.empty())
+    return;
+
+  Gtk::TreeModel::Path path;
+  gtk_tree_model_rows_reordered(Gtk::TreeModel::gobj(), path.gobj(), nullptr,
+                                &new_order[0]);
+}
+
+// Emit row_changed for the row of iter.
+void SubtitleModel::emit_row_changed(const Gtk::TreeIter &iter) {
+  Gtk::TreeModel::Path path;
+  path.push_back(get_row(get_slot(iter)));
+  row_changed(path, iter);
+}
+
+// Compute the characters per line/second of the slot if they are out of
+// date. The values are cached in the store until the next change of the text,
+// the translation or the times.
+void SubtitleModel::update_metrics(SubtitleStore::Slot slot) const {
+  guint8 dirty = m_store.get_dirty(slot);
+  if (dirty == 0)
+    return;
+
+  // only the cache of the computed values is changed
+  SubtitleStore &store = const_cast<SubtitleStore &>(m_store);
+
+  if (dirty & SubtitleStore::DIRTY_CPL_TEXT)
+    store.set_lines(slot, SubtitleStore::CHARACTERS_PER_LINE_TEXT,
+                    utility::get_characters_per_line(
+                        m_store.get_string(slot, SubtitleStore::TEXT)));
+
+  if (dirty & SubtitleStore::DIRTY_CPL_TRANSLATION)
+    store.set_lines(slot, SubtitleStore::CHARACTERS_PER_LINE_TRANSLATION,
+                    utility::get_characters_per_line(
+                        m_store.get_string(slot, SubtitleStore::TRANSLATION)));
+
+  if (dirty & SubtitleStore::DIRTY_CPS_TEXT) {
+    long duration = m_store.get_int(slot, SubtitleStore::DURATION);
+    if (m_document->get_timing_mode() == FRAME)
+      duration = SubtitleTime::frame_to_time(
+                     duration, get_framerate_value(m_document->get_framerate()))
+                     .totalmsecs;
+
+    store.set_double(slot, SubtitleStore::CHARACTERS_PER_SECOND_TEXT,
+                     utility::get_characters_per_second(
+                         m_store.get_string(slot, SubtitleStore::TEXT),
+                         duration));
+  }
+}
+
+// Gtk::TreeModel
+
+Gtk::TreeModelFlags SubtitleModel::get_flags_vfunc() const {
+  return Gtk::TREE_MODEL_ITERS_PERSIST | Gtk::TREE_MODEL_LIST_ONLY;
+}
+
+int SubtitleModel::get_n_columns_vfunc() const {
+  return m_column.size();
+}
+
+GType SubtitleModel::get_column_type_vfunc(int index) const {
+  g_return_val_if_fail(index >= 0 && index < get_n_columns_vfunc(),
+                       G_TYPE_INVALID);
+  return m_column.types()[index];
+}
+
+bool SubtitleModel::iter_next_vfunc(const iterator &iter,
+                                    iterator &iter_next) const {
+  guint32 row = get_row(get_slot(iter)) + 1;
+  if (row < m_rows.size()) {
+    set_iter(iter_next, row);
+    return true;
+  }
+  iter_next.gobj()->stamp = 0;
+  iter_next.gobj()->user_data = nullptr;
+  return false;
+}
+
+bool SubtitleModel::get_iter_vfunc(const Path &path, iterator &iter) const {
+  if (path.size() != 1) {
+    iter.gobj()->stamp = 0;
+    return false;
+  }
+  return iter_nth_root_child_vfunc(path[0], iter);
+}
+
+// The rows have no children, an invalid parent is the toplevel.
+bool SubtitleModel::iter_children_vfunc(const iterator &parent,
+                                        iterator &iter) const {
+  return iter_nth_child_vfunc(parent, 0, iter);
+}
+
+bool SubtitleModel::iter_parent_vfunc(const iterator & /*child*/,
+                                      iterator &iter) const {
+  iter.gobj()->stamp = 0;
+  iter.gobj()->user_data = nullptr;
+  return false;
+}
+
+bool SubtitleModel::iter_nth_child_vfunc(const iterator &parent, int n,
+                                         iterator &iter) const {
+  if (parent.gobj()->stamp == m_stamp)
+    return false;
+  return iter_nth_root_child_vfunc(n, iter);
+}
+
+bool SubtitleModel::iter_nth_root_child_vfunc(int n, iterator &iter) const {
+  if (n < 0 || static_cast<guint32>(n) >= m_rows.size()) {
+    iter.gobj()->stamp = 0;
+    return false;
+  }
+  set_iter(iter, n);
+  return true;
+}
+
+bool SubtitleModel::iter_has_child_vfunc(const iterator & /*iter*/) const {
+  return false;
+}
+
+int SubtitleModel::iter_n_children_vfunc(const iterator & /*iter*/) const {
+  return 0;
+}
+
+int SubtitleModel::iter_n_root_children_vfunc() const {
+  return m_rows.size();
+}
+
+Gtk::TreeModel::Path SubtitleModel::get_path_vfunc(
+    const iterator &iter) const {
+  Gtk::TreeModel::Path path;
+  path.push_back(get_row(get_slot(iter)));
+  return path;
 }
 
+// The strings are copied directly from the store.
+void SubtitleModel::get_value_vfunc(const iterator &iter, int column,
+                                    Glib::ValueBase &value) const {
+  g_return_if_fail(column >= 0 && column < get_n_columns_vfunc());
+
+  SubtitleStore::Slot slot = get_slot(iter);
+  SubtitleStore::Field field = static_cast<SubtitleStore::Field>(column);
+
+  value.init(m_column.types()[column]);
+
+  switch (field) {
+    case SubtitleStore::NUM:
+      g_value_set_uint(value.gobj(), get_row(slot) + 1);
+      break;
+    case SubtitleStore::START:
+    case SubtitleStore::END:
+    case SubtitleStore::DURATION:
+    case SubtitleStore::GAP_BEFORE:
+    case SubtitleStore::GAP_AFTER:
+      g_value_set_long(value.gobj(), m_store.get_int(slot, field));
+      break;
+    case SubtitleStore::CHARACTERS_PER_SECOND_TEXT:
+      update_metrics(slot);
+      g_value_set_double(value.gobj(), m_store.get_double(slot, field));
+      break;
+    case SubtitleStore::CHARACTERS_PER_LINE_TEXT:
+    case SubtitleStore::CHARACTERS_PER_LINE_TRANSLATION:
+      // the numbers are formatted (ex: "3\n3")
+      update_metrics(slot);
+      g_value_set_string(value.gobj(),
+                         m_store.get_string(slot, field).c_str());
+      break;
+    default: {
+      gsize size = 0;
+      const char *data = m_store.get_string_data(slot, field, size);
+      g_value_take_string(value.gobj(), g_strndup(data, size));
+    } break;
+  }
+}
+
+// Used by the rows ((*iter)[column] = value).
+void SubtitleModel::set_value_impl(const iterator &row, int column,
+                                   const Glib::ValueBase &value) {
+  g_return_if_fail(column >= 0 && column < get_n_columns_vfunc());
+
+  SubtitleStore::Slot slot = get_slot(row);
+  SubtitleStore::Field field = static_cast<SubtitleStore::Field>(column);
+
+  switch (field) {
+    case SubtitleStore::NUM:
+      // follow the position of the row
+      return;
+    case SubtitleStore::START:
+    case SubtitleStore::END: {
+      long old_start = m_store.get_int(slot, SubtitleStore::START);
+      m_store.set_int(slot, field, g_value_get_long(value.gobj()));
+      update_time_index_entry(row, old_start);
+    } break;
+    case SubtitleStore::DURATION:
+    case SubtitleStore::GAP_BEFORE:
+    case SubtitleStore::GAP_AFTER:
+      m_store.set_int(slot, field, g_value_get_long(value.gobj()));
+      break;
+    case SubtitleStore::CHARACTERS_PER_SECOND_TEXT:
+      m_store.set_double(slot, field, g_value_get_double(value.gobj()));
+      break;
+    default: {
+      const gchar *str = g_value_get_string(value.gobj());
+      m_store.set_string(slot, field, (str) ? str : "");
+    } break;
+  }
+  emit_row_changed(row);
+}
+
+// Gtk::TreeDragSource
+
+bool SubtitleModel::row_draggable_vfunc(const Path &path) const {
+  return path.size() == 1;
+}
+
+bool SubtitleModel::drag_data_get_vfunc(
+    const Path &path, Gtk::SelectionData &selection_data) const {
+  return gtk_tree_set_row_drag_data(
+      selection_data.gobj(),
+      const_cast<GtkTreeModel *>(Gtk::TreeModel::gobj()),
+      const_cast<GtkTreePath *>(path.gobj()));
+}
+
+bool SubtitleModel::drag_data_delete_vfunc(const Path &path) {
+  Gtk::TreeIter iter = get_iter(path);
+  if (!iter)
+    return false;
+
+  m_document->add_command(new RemoveSubtitleCommand(m_document, iter));
+  m_document->finish_command();
+
+  erase_row(get_row(get_slot(iter)));
+
+  return true;
+}
+
+// Gtk::TreeDragDest
+
 bool SubtitleModel::drag_data_received_vfunc(
-    const TreeModel::Path &dest, const Gtk::SelectionData &selection_data) {
+    const Path &dest, const Gtk::SelectionData &selection_data) {
   Gtk::TreePath src;
-  Gtk::TreePath::get_from_selection_data(selection_data, src);
+  if (!Gtk::TreePath::get_from_selection_data(selection_data, src))
+    return false;
+  if (src.size() != 1 || dest.size() != 1)
+    return false;
+
+  guint32 src_row = src[0];
+  if (src_row >= m_rows.size())
+    return false;
+
+  guint32 dest_row = std::min<guint32>(dest[0], m_rows.size());
 
-  Gtk::ListStore::drag_data_received_vfunc(dest, selection_data);
+  Gtk::TreeIter iter = insert_row(dest_row);
+  // the source is moved by the insertion
+  if (dest_row <= src_row)
+    ++src_row;
+
+  m_store.copy(get_slot(iter), m_store, m_rows[src_row]);
+  emit_row_changed(iter);
 
   m_document->start_command(_("Reordered Subtitle"));
-  m_document->add_command(new AddSubtitleCommand(m_document, get_iter(dest)));
+  m_document->add_command(new AddSubtitleCommand(m_document, iter));
 
   return true;
 }
+
+bool SubtitleModel::row_drop_possible_vfunc(
+    const Path &dest, const Gtk::SelectionData & /*selection_data*/) const {
+  return dest.size() == 1 && dest[0] >= 0 &&
+         static_cast<guint32>(dest[0]) <= m_rows.size();
+}
@@ -21,6 +21,8 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <gtkmm.h>
+#include <vector>
+#include "subtitlestore.h"
 #include "subtitletime.h"
 
 class NameModel : public Gtk::ListStore {
@@ -100,7 +102,14 @@ class SubtitleColumnRecorder : public Gtk::TreeModel::ColumnRecord {
 
 class Document;
 
-class SubtitleModel : public Gtk::ListStore {
+// The model of the subtitles. The values are stored by columns in a
+// SubtitleStore, the model only keeps the order of the rows (slots).
+// The iterators persist, they stay valid until the row is removed.
+// The number of a subtitle is not stored, it's the position of the row.
+class SubtitleModel : public Glib::Object,
+                      public Gtk::TreeModel,
+                      public Gtk::TreeDragSource,
+                      public Gtk::TreeDragDest {
  public:
   SubtitleModel(Document *doc);
 
@@ -109,6 +118,22 @@ class SubtitleModel : public Gtk::ListStore {
 
   Gtk::TreeIter append();
 
+  // Insert a new empty row before iter (or at the end if iter is not valid).
+  Gtk::TreeIter insert(const Gtk::TreeIter &iter);
+
+  // Insert a new empty row after iter (or at the start if iter is not valid).
+  Gtk::TreeIter insert_after(const Gtk::TreeIter &iter);
+
+  // Remove the row and return the next one.
+  Gtk::TreeIter erase(const Gtk::TreeIter &iter);
+
+  // Move source before destination (or at the end if destination is not
+  // valid).
+  void move(const Gtk::TreeIter &source, const Gtk::TreeIter &destination);
+
+  // new_order[newpos] = oldpos
+  void reorder(const std::vector<int> &new_order);
+
   // retourne le premier element de la list
   // ou un iterator invalide
   Gtk::TreeIter getFirst();
@@ -123,17 +148,27 @@ class SubtitleModel : public Gtk::ListStore {
   // FONCTION DE RECHERCHE
 
   // recherche un subtitle
-  // grace a son numero
+  // grace a son numero (constant time, num = position + 1)
   Gtk::TreeIter find(unsigned int num);
 
   // recherche un subtitle grace a son temps
   // si time est compris entre start et end
   Gtk::TreeIter find(const SubtitleTime &time);
 
+  // Return the first subtitle (by start time) which starts at or after time.
+  // The time index is used, the lookup is O(log n).
+  Gtk::TreeIter find_at_or_after(const SubtitleTime &time);
+
+  // Mark the time index as out of date. Called when rows are inserted,
+  // deleted or reordered, the index is rebuilt on the next time lookup.
+  // A start or end change only moves the entry of the row.
+  void invalidate_time_index();
+
   // recherche a partir de start (+1) dans le text des subtitles
   Gtk::TreeIter find_text(Gtk::TreeIter &start, const Glib::ustring &text);
 
   // recherche l'iterator precedant iter
+  // (constant time, --iter)
   Gtk::TreeIter find_previous(const Gtk::TreeIter &iter);
 
   // recherche l'iterator suivant iter
@@ -143,14 +178,12 @@ class SubtitleModel : public Gtk::ListStore {
   // FONCTION D'EDITION
 
   // insert sub avant iter et retourne l'iter de sub
-  // puis declale tout les autres (num)
   Gtk::TreeIter insertBefore(Gtk::TreeIter &iter);
 
   // insert sub apres iter et retourne l'iter de sub
-  // et declale tout les autres (num)
   Gtk::TreeIter insertAfter(Gtk::TreeIter &iter);
 
-  // efface un subtitle, on init les suivants avec le bon num
+  // efface un subtitle
   void remove(Gtk::TreeIter &iter);
 
   // efface des elements de start a end
@@ -160,19 +193,176 @@ class SubtitleModel : public Gtk::ListStore {
   // fait une copy de src dans this
   void copy(Glib::RefPtr<SubtitleModel> src);
 
-  // check la colonne num pour init de [1,size]
-  void rebuild_column_num();
+  // Direct access to the values of a row, without GValue.
+  // The setters emit row_changed. NUM is the position of the row (+1), it
+  // can't be set.
+  gint64 get_int(const Gtk::TreeIter &iter, SubtitleStore::Field field) const;
+  void set_int(const Gtk::TreeIter &iter, SubtitleStore::Field field,
+               gint64 value);
+
+  double get_double(const Gtk::TreeIter &iter,
+                    SubtitleStore::Field field) const;
+  void set_double(const Gtk::TreeIter &iter, SubtitleStore::Field field,
+                  double value);
+
+  Glib::ustring get_ustring(const Gtk::TreeIter &iter,
+                            SubtitleStore::Field field) const;
+  void set_ustring(const Gtk::TreeIter &iter, SubtitleStore::Field field,
+                   const Glib::ustring &value);
+
+  // Copy the values of the row in a new slot of backup (undo/redo).
+  SubtitleStore::Slot save_row(const Gtk::TreeIter &iter,
+                               SubtitleStore &backup) const;
+
+  // Set the values of the row from the slot of backup.
+  void load_row(const Gtk::TreeIter &iter, const SubtitleStore &backup,
+                SubtitleStore::Slot slot);
+
+  // Return the number of bytes used by the values of the subtitles.
+  gsize memory_usage() const;
+
+  // Return false if the iter doesn't belong to this model or if its row has
+  // been removed (even if the slot is used by a new row).
+  bool iter_is_valid(const Gtk::TreeIter &iter) const;
 
  protected:
-  virtual bool drag_data_delete_vfunc(const TreeModel::Path &path);
+  // One entry of the time index, sorted by (start, row).
+  struct TimeIndexEntry {
+    long start;
+    long end;
+    // The greatest end value of the entries [0, this]. Used to know when to
+    // stop the backward scan with overlapping subtitles.
+    long max_end;
+    // Position of the row in the model, keep the document order for the
+    // subtitles which share the same time.
+    unsigned int row;
+    Gtk::TreeIter iter;
+
+    bool operator<(const TimeIndexEntry &other) const {
+      if (start != other.start)
+        return start < other.start;
+      return row < other.row;
+    }
+  };
+
+  // Convert the time to the model value (msecs or frame).
+  long time_to_model_value(const SubtitleTime &time);
+
+  // Rebuild the time index if needed.
+  void update_time_index();
+
+  // Move the entry of the row after a start or end change.
+  void update_time_index_entry(const Gtk::TreeIter &iter, long old_start);
+
+  void on_time_index_row_inserted(const Gtk::TreeModel::Path &path,
+                                  const Gtk::TreeModel::iterator &iter);
+
+  void on_time_index_row_deleted(const Gtk::TreeModel::Path &path);
+
+  void on_time_index_rows_reordered(const Gtk::TreeModel::Path &path,
+                                    const Gtk::TreeModel::iterator &iter,
+                                    int *new_order);
+
+  // Rows and slots
+
+  // Return the slot of the iter.
+  SubtitleStore::Slot get_slot(const Gtk::TreeIter &iter) const;
+
+  // Return the position of the slot in the model.
+  guint32 get_row(SubtitleStore::Slot slot) const;
+
+  // Return an iter pointing to the row.
+  Gtk::TreeIter create_iter(guint32 row);
 
+  // Set iter to the row.
+  void set_iter(Gtk::TreeIter &iter, guint32 row) const;
+
+  // Create a new slot and insert it at the row position.
+  Gtk::TreeIter insert_row(guint32 row);
+
+  // Remove the row from the model and release its slot.
+  void erase_row(guint32 row);
+
+  // Emit rows_reordered for the whole list.
+  void emit_rows_reordered(std::vector<int> &new_order);
+
+  // Emit row_changed for the row of iter.
+  void emit_row_changed(const Gtk::TreeIter &iter);
+
+  // Compute the characters per line/second of the slot if they are out of
+  // date (SubtitleStore::get_dirty).
+  void update_metrics(SubtitleStore::Slot slot) const;
+
+  // Gtk::TreeModel
+  virtual Gtk::TreeModelFlags get_flags_vfunc() const;
+
+  virtual int get_n_columns_vfunc() const;
+
+  virtual GType get_column_type_vfunc(int index) const;
+
+  virtual bool iter_next_vfunc(const iterator &iter,
+                               iterator &iter_next) const;
+
+  virtual bool get_iter_vfunc(const Path &path, iterator &iter) const;
+
+  virtual bool iter_children_vfunc(const iterator &parent,
+                                   iterator &iter) const;
+
+  virtual bool iter_parent_vfunc(const iterator &child, iterator &iter) const;
+
+  virtual bool iter_nth_child_vfunc(const iterator &parent, int n,
+                                    iterator &iter) const;
+
+  virtual bool iter_nth_root_child_vfunc(int n, iterator &iter) const;
+
+  virtual bool iter_has_child_vfunc(const iterator &iter) const;
+
+  virtual int iter_n_children_vfunc(const iterator &iter) const;
+
+  virtual int iter_n_root_children_vfunc() const;
+
+  virtual Path get_path_vfunc(const iterator &iter) const;
+
+  virtual void get_value_vfunc(const iterator &iter, int column,
+                               Glib::ValueBase &value) const;
+
+  virtual void set_value_impl(const iterator &row, int column,
+                              const Glib::ValueBase &value);
+
+  // Gtk::TreeDragSource
+  virtual bool row_draggable_vfunc(const Path &path) const;
+
+  virtual bool drag_data_get_vfunc(const Path &path,
+                                   Gtk::SelectionData &selection_data) const;
+
+  virtual bool drag_data_delete_vfunc(const Path &path);
+
+  // Gtk::TreeDragDest
   virtual bool drag_data_received_vfunc(
-      const TreeModel::Path &dest, const Gtk::SelectionData &selection_data);
+      const Path &dest, const Gtk::SelectionData &selection_data);
+
+  virtual bool row_drop_possible_vfunc(
+      const Path &dest, const Gtk::SelectionData &selection_data) const;
 
  protected:
   Document *m_document;
   SubtitleColumnRecorder m_column;
 
-  sigc::signal<void, const Gtk::TreePath &, const Gtk::TreePath &>
-      m_my_signal_row_reorderer;
+  // The values of the subtitles
+  SubtitleStore m_store;
+  // The slot of each row
+  std::vector<SubtitleStore::Slot> m_rows;
+  // The position of each slot, only valid before m_row_of_slot_valid (updated
+  // on demand)
+  mutable std::vector<guint32> m_row_of_slot;
+  mutable guint32 m_row_of_slot_valid{0};
+  // The generation of each slot, changed when its row is removed (stored in
+  // the user_data2 of the iters)
+  std::vector<guint32> m_slot_generation;
+  // The stamp of the iterators
+  int m_stamp;
+
+  // Sorted start time index used by find(time) and find_at_or_after(time)
+  std::vector<TimeIndexEntry> m_time_index;
+  bool m_time_index_valid{false};
 };
@@ -18,7 +18,10 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include "commandspill.h"
 #include "document.h"
+#include "error.h"
 #include "subtitles.h"
 #include "utility.h"
 
@@ -42,7 +45,6 @@ class AppendSubtitleCommand : public Command {
   void restore() {
     Gtk::TreeIter iter = get_document_subtitle_model()->get_iter(m_path);
     get_document_subtitle_model()->erase(iter);
-    get_document_subtitle_model()->rebuild_column_num();
   }
 
  protected:
@@ -53,51 +55,84 @@ class RemoveSubtitlesCommand : public Command {
  public:
   RemoveSubtitlesCommand(Document *doc, std::vector<Subtitle> &subtitles)
       : Command(doc, _("Remove Subtitles")) {
-    m_backup.resize(subtitles.size());
+    SubtitleModelPtr model = get_document_subtitle_model();
+
+    m_rows.resize(subtitles.size());
+    m_slots.resize(subtitles.size());
 
     for (unsigned int i = 0; i < subtitles.size(); ++i) {
-      subtitles[i].get(m_backup[i]);
+      m_rows[i] = subtitles[i].get_num() - 1;
+      m_slots[i] = model->save_row(model->find(m_rows[i] + 1), m_backup);
     }
   }
 
   void execute() {
-    std::vector<std::map<Glib::ustring, Glib::ustring> >::reverse_iterator it;
-
-    for (it = m_backup.rbegin(); it != m_backup.rend(); ++it) {
-      Gtk::TreeIter iter =
-          get_document_subtitle_model()->get_iter((*it)["path"]);
+    SubtitleModelPtr model = get_document_subtitle_model();
 
-      get_document_subtitle_model()->erase(iter);
+    // from the end, the rows before are not moved
+    for (auto it = m_rows.rbegin(); it != m_rows.rend(); ++it) {
+      Gtk::TreeIter iter = model->find(*it + 1);
+      if (iter)
+        model->erase(iter);
 
       // FIXME: updated gap after/before
     }
 
-    get_document_subtitle_model()->rebuild_column_num();
     document()->emit_signal("subtitle-deleted");
   }
 
   void restore() {
-    std::vector<std::map<Glib::ustring, Glib::ustring> >::iterator it;
-
-    for (it = m_backup.begin(); it != m_backup.end(); ++it) {
-      Gtk::TreeIter newiter = get_document_subtitle_model()->append();
+    SubtitleModelPtr model = get_document_subtitle_model();
 
-      Gtk::TreeIter path =
-          get_document_subtitle_model()->get_iter((*it)["path"]);
-      if (path)
-        get_document_subtitle_model()->move(newiter, path);
-
-      Subtitle sub(document(), newiter);
-      sub.set((*it));
+    for (unsigned int i = 0; i < m_rows.size(); ++i) {
+      Gtk::TreeIter iter = model->insert(model->find(m_rows[i] + 1));
+      model->load_row(iter, m_backup, m_slots[i]);
       // FIXME: updated gap after/before
     }
 
-    get_document_subtitle_model()->rebuild_column_num();
     document()->emit_signal("subtitle-insered");
   }
 
+  gsize memory_usage() const {
+    return Command::memory_usage() + m_backup.memory_usage() +
+           m_rows.capacity() * sizeof(guint32) +
+           m_slots.capacity() * sizeof(SubtitleStore::Slot);
+  }
+
+  // Only the values of the subtitles are written in the file.
+  gsize spill(CommandSpillFile &file) {
+    if (m_spill_offset != -1)
+      return 0;
+
+    std::string data;
+    m_backup.save(data);
+    m_spill_offset = file.write(data.data(), data.size());
+    m_spill_size = data.size();
+    m_backup = SubtitleStore();
+    return m_spill_size;
+  }
+
+  void unspill(CommandSpillFile &file) {
+    if (m_spill_offset == -1)
+      return;
+
+    std::string data(m_spill_size, '\0');
+    gint64 offset = m_spill_offset;
+    m_spill_offset = -1;
+    file.read(offset, &data[0], m_spill_size);
+
+    if (!m_backup.load(data))
+      throw IOFileError("Invalid data in the undo file");
+  }
+
  protected:
-  std::vector<std::map<Glib::ustring, Glib::ustring> > m_backup;
+  // The position of each subtitle and the slot of its values in m_backup
+  std::vector<guint32> m_rows;
+  std::vector<SubtitleStore::Slot> m_slots;
+  SubtitleStore m_backup;
+  // offset of m_backup in the spill file or -1
+  gint64 m_spill_offset{-1};
+  gsize m_spill_size{0};
 };
 
 class InsertSubtitleCommand : public Command {
@@ -119,14 +154,12 @@ class InsertSubtitleCommand : public Command {
     Gtk::TreeIter path = get_document_subtitle_model()->get_iter(m_path);
 
     get_document_subtitle_model()->move(newiter, path);
-    get_document_subtitle_model()->rebuild_column_num();
   }
 
   void restore() {
     Gtk::TreeIter iter = get_document_subtitle_model()->get_iter(m_path);
 
     get_document_subtitle_model()->erase(iter);
-    get_document_subtitle_model()->rebuild_column_num();
   }
 
  protected:
@@ -145,12 +178,10 @@ class ReorderSubtitlesCommand : public Command {
 
   void execute() {
     get_document_subtitle_model()->reorder(m_new_order);
-    get_document_subtitle_model()->rebuild_column_num();
   }
 
   void restore() {
     get_document_subtitle_model()->reorder(m_old_order);
-    get_document_subtitle_model()->rebuild_column_num();
   }
 
  protected:
@@ -162,10 +193,6 @@ class ReorderSubtitlesCommand : public Command {
 // information for sorted function.
 class SortedBuffer {
  public:
-  static bool compare_num_func(const SortedBuffer &a, const SortedBuffer &b) {
-    return (a.num < b.num);
-  }
-
   static bool compare_time_func(const SortedBuffer &a, const SortedBuffer &b) {
     return (a.time < b.time);
   }
@@ -175,7 +202,6 @@ class SortedBuffer {
     gint index = 0;
     for (Subtitle s = subtitles.get_first(); s; ++s, ++index) {
       buf[index].index = index;
-      buf[index].num = s.get_num();
       buf[index].time = s.get_start().totalmsecs;
     }
   }
@@ -198,7 +224,6 @@ class SortedBuffer {
 
  public:
   gint index;
-  gint num;
   long time;
 };
 
@@ -237,17 +262,25 @@ Subtitle Subtitles::get_next(const Subtitle &sub) {
 }
 
 Subtitle Subtitles::append() {
+  if (m_document.is_bulk_editing())
+    m_document.mark_bulk_edit_changed();
+
   if (m_document.is_recording())
-    m_document.add_command(new AppendSubtitleCommand(&m_document));
+    m_document.add_command(new AppendSubtitleCommand(&m_document), size());
 
   Gtk::TreeIter iter = m_document.get_subtitle_model()->append();
   return Subtitle(&m_document, iter);
 }
 
 Subtitle Subtitles::insert_before(const Subtitle &sub) {
+  if (m_document.is_bulk_editing())
+    m_document.mark_bulk_edit_changed();
+
   if (m_document.is_recording())
-    m_document.add_command(new InsertSubtitleCommand(
-        &m_document, sub, InsertSubtitleCommand::BEFORE));
+    m_document.add_command(
+        new InsertSubtitleCommand(&m_document, sub,
+                                  InsertSubtitleCommand::BEFORE),
+        sub.get_num() - 1);
 
   Gtk::TreeIter iter = sub.m_iter;
   return Subtitle(&m_document,
@@ -255,9 +288,14 @@ Subtitle Subtitles::insert_before(const Subtitle &sub) {
 }
 
 Subtitle Subtitles::insert_after(const Subtitle &sub) {
+  if (m_document.is_bulk_editing())
+    m_document.mark_bulk_edit_changed();
+
   if (m_document.is_recording())
-    m_document.add_command(new InsertSubtitleCommand(
-        &m_document, sub, InsertSubtitleCommand::AFTER));
+    m_document.add_command(
+        new InsertSubtitleCommand(&m_document, sub,
+                                  InsertSubtitleCommand::AFTER),
+        sub.get_num());
 
   Gtk::TreeIter iter = sub.m_iter;
   return Subtitle(&m_document,
@@ -265,11 +303,27 @@ Subtitle Subtitles::insert_after(const Subtitle &sub) {
 }
 
 void Subtitles::remove(std::vector<Subtitle> &subs) {
-  if (m_document.is_recording())
-    m_document.add_command(new RemoveSubtitlesCommand(&m_document, subs));
+  if (m_document.is_recording()) {
+    unsigned int first_row = G_MAXUINT;
+    for (const auto &sub : subs) {
+      first_row = std::min(first_row, sub.get_num() - 1);
+    }
+    m_document.add_command(new RemoveSubtitlesCommand(&m_document, subs),
+                           first_row);
+  }
+
+  // The gaps are updated by the end of the bulk edit
+  bool bulk = m_document.is_bulk_editing();
+  if (bulk)
+    m_document.mark_bulk_edit_changed();
 
   std::vector<Subtitle>::reverse_iterator it;
   for (it = subs.rbegin(); it != subs.rend(); ++it) {
+    if (bulk) {
+      m_document.get_subtitle_model()->erase((*it).m_iter);
+      continue;
+    }
+
     Subtitle prev_sub = get_previous(*it);
     Subtitle next_sub = get_next(*it);
 
@@ -280,7 +334,6 @@ void Subtitles::remove(std::vector<Subtitle> &subs) {
     if (next_sub)
       next_sub.update_gap_before();
   }
-  m_document.get_subtitle_model()->rebuild_column_num();
   m_document.emit_signal("subtitle-deleted");
 }
 
@@ -312,7 +365,7 @@ void Subtitles::remove(const Subtitle &sub) {
 
 Subtitle Subtitles::find(const SubtitleTime &time) {
   // Calling 'SubtitleModel::find' is doing the same thing
-  // that the next code, but in an optimized way
+  // that the next code, but in an optimized way (sorted time index)
   // Subtitle sub = get_first();
   // while (sub) {
   //   if (time >= sub.get_start() && time <= sub.get_end())
@@ -323,13 +376,22 @@ Subtitle Subtitles::find(const SubtitleTime &time) {
   return Subtitle(&m_document, m_document.get_subtitle_model()->find(time));
 }
 
+// Return the first subtitle (by start time) which starts at or after time.
+Subtitle Subtitles::find_at_or_after(const SubtitleTime &time) {
+  return Subtitle(&m_document,
+                  m_document.get_subtitle_model()->find_at_or_after(time));
+}
+
 // Selection
 
 std::vector<Subtitle> Subtitles::get_selection() {
   std::vector<Subtitle> array;
 
-  std::vector<Gtk::TreeModel::Path> rows =
-      m_document.get_subtitle_view()->get_selection()->get_selected_rows();
+  DocumentView *view = m_document.get_view();
+  if (view == nullptr)
+    return array;
+
+  std::vector<Gtk::TreeModel::Path> rows = view->get_selected_rows();
 
   if (!rows.empty()) {
     array.resize(rows.size());
@@ -360,49 +422,65 @@ Subtitle Subtitles::get_last_selected() {
 }
 
 void Subtitles::select(const std::vector<Subtitle> &sub) {
+  DocumentView *view = m_document.get_view();
+  if (view == nullptr)
+    return;
+
   for (unsigned int i = 0; i < sub.size(); ++i) {
-    m_document.get_subtitle_view()->get_selection()->select(sub[i].m_iter);
+    view->select_row(sub[i].m_iter);
   }
 }
 
 void Subtitles::select(const std::list<Subtitle> &sub) {
+  DocumentView *view = m_document.get_view();
+  if (view == nullptr)
+    return;
+
   for (auto it = sub.begin(); it != sub.end(); ++it) {
-    m_document.get_subtitle_view()->get_selection()->select((*it).m_iter);
+    view->select_row((*it).m_iter);
   }
 }
 
 void Subtitles::select(const Subtitle &sub, bool start_editing) {
-  m_document.get_subtitle_view()->select_and_set_cursor(sub.m_iter,
-                                                        start_editing);
+  DocumentView *view = m_document.get_view();
+  if (view != nullptr)
+    view->select_and_set_cursor(sub.m_iter, start_editing);
 }
 
 void Subtitles::unselect(const Subtitle &sub) {
-  m_document.get_subtitle_view()->get_selection()->unselect(sub.m_iter);
+  DocumentView *view = m_document.get_view();
+  if (view != nullptr)
+    view->unselect_row(sub.m_iter);
 }
 
 bool Subtitles::is_selected(const Subtitle &sub) {
-  return m_document.get_subtitle_view()->get_selection()->is_selected(
-      sub.m_iter);
+  DocumentView *view = m_document.get_view();
+  return view != nullptr && view->is_row_selected(sub.m_iter);
 }
 
 void Subtitles::select_all() {
-  m_document.get_subtitle_view()->get_selection()->select_all();
+  DocumentView *view = m_document.get_view();
+  if (view != nullptr)
+    view->select_all_rows();
 }
 
 void Subtitles::invert_selection() {
-  Glib::RefPtr<Gtk::TreeSelection> selection =
-      m_document.get_subtitle_view()->get_selection();
+  DocumentView *view = m_document.get_view();
+  if (view == nullptr)
+    return;
 
   for (Subtitle sub = get_first(); sub; ++sub) {
-    if (selection->is_selected(sub.m_iter))
-      selection->unselect(sub.m_iter);
+    if (view->is_row_selected(sub.m_iter))
+      view->unselect_row(sub.m_iter);
     else
-      selection->select(sub.m_iter);
+      view->select_row(sub.m_iter);
   }
 }
 
 void Subtitles::unselect_all() {
-  m_document.get_subtitle_view()->get_selection()->unselect_all();
+  DocumentView *view = m_document.get_view();
+  if (view != nullptr)
+    view->unselect_all_rows();
 }
 
 guint Subtitles::sort_by_time() {
@@ -427,16 +505,13 @@ guint Subtitles::sort_by_time() {
 
   // Reorder the model
   m_document.get_subtitle_model()->reorder(new_order);
+  if (m_document.is_bulk_editing())
+    m_document.mark_bulk_edit_changed();
 
-  // We need to resort by using the subtitle number for Undo
-  // Create the Buffer structure used to sort
-  SortedBuffer::create_buffers(*this, buf);
-  // Sort using the Num this time
-  std::sort(buf.begin(), buf.end(), SortedBuffer::compare_num_func);
-  SortedBuffer::to_vector(buf, old_order);
-
-  // We can now update the num of subtitles
-  m_document.get_subtitle_model()->rebuild_column_num();
+  // The order for Undo is the inverse of the new order
+  for (guint i = 0; i < number_of_subtitles; ++i) {
+    old_order[new_order[i]] = i;
+  }
 
   if (m_document.is_recording())
     m_document.add_command(
@@ -444,3 +519,17 @@ guint Subtitles::sort_by_time() {
 
   return number_of_sub_reorder;
 }
+
+// Recalculate the gaps of the subtitles from first to the one after last (the
+// gap after last is the gap before the next one). Used at the end of a bulk
+// edit (the characters per line/second are computed on demand).
+void Subtitles::update_computed_values(unsigned int first, unsigned int last) {
+  if (first > last)
+    return;
+
+  guint64 end = guint64(last) + 1;
+  Subtitle sub = get(first + 1);
+  for (guint64 row = first; sub && row <= end; ++row, ++sub) {
+    sub.update_gap_before();
+  }
+}
@@ -58,6 +58,9 @@ class Subtitles {
 
   Subtitle find(const SubtitleTime &time);
 
+  // Return the first subtitle (by start time) which starts at or after time.
+  Subtitle find_at_or_after(const SubtitleTime &time);
+
   // Selection
 
   std::vector<Subtitle> get_selection();
@@ -83,6 +86,15 @@ class Subtitles {
 
   guint sort_by_time();
 
+  // Recalculate the gaps of the subtitles from first to the one after last
+  // (the gap after last). Used at the end of a bulk edit (the characters per
+  // line/second are computed on demand).
+  void update_computed_values(unsigned int first = 0,
+                              unsigned int last = G_MAXUINT);
+
  protected:
   Document &m_document;
+};
+  unsigned int m_changed_last{0};
+  bool m_all_changed{false};
 };
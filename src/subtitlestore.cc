@@ -0,0 +1,765 @@
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "subtitlestore.h"
+
+// Serialization of the store (save/load).
+template <class T>
+static void write_value(std::string &data, const T &value) {
+  data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T>
+static void write_vector(std::string &data, const std::vector<T> &values) {
+  write_value<guint32>(data, values.size());
+  data.append(reinterpret_cast<const char *>(values.data()),
+              values.size() * sizeof(T));
+}
+
+static void write_string(std::string &data, const std::string &str) {
+  write_value<guint32>(data, str.size());
+  data.append(str);
+}
+
+class StoreReader {
+ public:
+  explicit StoreReader(const std::string &data)
+      : m_data(data.data()), m_end(data.data() + data.size()) {
+  }
+
+  bool read(void *value, gsize size) {
+    if (static_cast<gsize>(m_end - m_data) < size)
+      return false;
+    memcpy(value, m_data, size);
+    m_data += size;
+    return true;
+  }
+
+  template <class T>
+  bool read_value(T &value) {
+    return read(&value, sizeof(T));
+  }
+
+  template <class T>
+  bool read_vector(std::vector<T> &values) {
+    guint32 size = 0;
+    if (!read_value(size) ||
+        static_cast<gsize>(m_end - m_data) / sizeof(T) < size)
+      return false;
+    values.resize(size);
+    return read(values.data(), size * sizeof(T));
+  }
+
+  bool read_string(std::string &str) {
+    guint32 size = 0;
+    if (!read_value(size) || static_cast<gsize>(m_end - m_data) < size)
+      return false;
+    str.assign(m_data, size);
+    m_data += size;
+    return true;
+  }
+
+  // Return true if all the data are read.
+  bool at_end() const {
+    return m_data == m_end;
+  }
+
+ protected:
+  const char *m_data;
+  const char *m_end;
+};
+
+// The arena is compacted only when it wastes more than this size and more than
+// the half of its size.
+static const gsize ARENA_COMPACT_MIN_UNUSED = 1024 * 1024;
+
+// The same for the line lengths (number of values).
+static const gsize LINES_COMPACT_MIN_UNUSED = 64 * 1024;
+
+guint32 SubtitleStore::StringPool::ref(const std::string &str) {
+  auto it = m_ids.find(str);
+  if (it != m_ids.end()) {
+    ++m_refs[it->second];
+    return it->second;
+  }
+
+  guint32 id;
+  if (!m_free_ids.empty()) {
+    id = m_free_ids.back();
+    m_free_ids.pop_back();
+    m_strings[id] = str;
+    m_refs[id] = 1;
+  } else {
+    id = m_strings.size();
+    m_strings.push_back(str);
+    m_refs.push_back(1);
+  }
+  m_ids[str] = id;
+  return id;
+}
+
+void SubtitleStore::StringPool::unref(guint32 id) {
+  g_return_if_fail(m_refs[id] > 0);
+
+  if (--m_refs[id] > 0)
+    return;
+
+  m_ids.erase(m_strings[id]);
+  std::string().swap(m_strings[id]);
+  m_free_ids.push_back(id);
+}
+
+gsize SubtitleStore::StringPool::memory_usage() const {
+  gsize size = m_strings.capacity() * sizeof(std::string);
+  for (const auto &str : m_strings) {
+    size += str.capacity();
+  }
+  // the keys of the map are a copy of the strings
+  size *= 2;
+  size += m_refs.capacity() * sizeof(guint32);
+  size += m_free_ids.capacity() * sizeof(guint32);
+  return size;
+}
+
+// Replace the strings by the strings saved, without reference.
+void SubtitleStore::StringPool::restore(std::vector<std::string> &strings) {
+  m_strings.swap(strings);
+  m_refs.assign(m_strings.size(), 0);
+  m_free_ids.clear();
+  m_ids.clear();
+}
+
+// Release the strings without reference after restore().
+void SubtitleStore::StringPool::release_unused() {
+  for (guint32 id = 0; id < m_strings.size(); ++id) {
+    if (m_refs[id] > 0) {
+      m_ids[m_strings[id]] = id;
+    } else {
+      std::string().swap(m_strings[id]);
+      m_free_ids.push_back(id);
+    }
+  }
+}
+
+// Return the type of the value of the field (NUM is an INT).
+SubtitleStore::Type SubtitleStore::get_type(Field field) {
+  switch (field) {
+    case NUM:
+    case START:
+    case END:
+    case DURATION:
+    case GAP_BEFORE:
+    case GAP_AFTER:
+      return INT;
+    case CHARACTERS_PER_SECOND_TEXT:
+      return DOUBLE;
+    default:
+      return STRING;
+  }
+}
+
+// The default strings keep a reference, they are never released.
+SubtitleStore::SubtitleStore() {
+  m_id_empty = m_pool.ref("");
+  m_id_zero = m_pool.ref("0");
+  m_id_default = m_pool.ref("Default");
+}
+
+// Return a new slot with the default values.
+SubtitleStore::Slot SubtitleStore::create() {
+  if (!m_free_slots.empty()) {
+    Slot slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    reset(slot);
+    return slot;
+  }
+
+  Slot slot = m_size++;
+
+  m_start.push_back(0);
+  m_end.push_back(0);
+  m_duration.push_back(0);
+  m_gap_before.push_back(0);
+  m_gap_after.push_back(0);
+  m_cps_text.push_back(0);
+  m_dirty.push_back(DIRTY_ALL);
+
+  m_layer.push_back(m_id_zero);
+  m_style.push_back(m_id_default);
+  m_name.push_back(m_id_empty);
+  m_margin_l.push_back(m_id_zero);
+  m_margin_r.push_back(m_id_zero);
+  m_margin_v.push_back(m_id_zero);
+  m_effect.push_back(m_id_empty);
+  for (const auto id : {m_id_zero, m_id_default, m_id_empty, m_id_zero,
+                        m_id_zero, m_id_zero, m_id_empty}) {
+    m_pool.ref(id);
+  }
+
+  LinesRef no_lines = {0, 0};
+  m_cpl_text.push_back(no_lines);
+  m_cpl_translation.push_back(no_lines);
+
+  TextRef empty = {0, 0};
+  m_text.push_back(empty);
+  m_translation.push_back(empty);
+  m_note.push_back(empty);
+
+  return slot;
+}
+
+// Release the slot, it can be reused by create().
+// The texts and the interned strings of the slot are released.
+void SubtitleStore::release(Slot slot) {
+  g_return_if_fail(slot < m_size);
+
+  reset(slot);
+
+  m_free_slots.push_back(slot);
+}
+
+// Set the default values of the slot.
+void SubtitleStore::reset(Slot slot) {
+  g_return_if_fail(slot < m_size);
+
+  m_start[slot] = 0;
+  m_end[slot] = 0;
+  m_duration[slot] = 0;
+  m_gap_before[slot] = 0;
+  m_gap_after[slot] = 0;
+  m_cps_text[slot] = 0;
+  m_dirty[slot] = DIRTY_ALL;
+
+  set_interned(m_layer[slot], m_id_zero);
+  set_interned(m_style[slot], m_id_default);
+  set_interned(m_name[slot], m_id_empty);
+  set_interned(m_margin_l[slot], m_id_zero);
+  set_interned(m_margin_r[slot], m_id_zero);
+  set_interned(m_margin_v[slot], m_id_zero);
+  set_interned(m_effect[slot], m_id_empty);
+
+  set_lines(m_cpl_text[slot], nullptr, 0);
+  set_lines(m_cpl_translation[slot], nullptr, 0);
+
+  set_text(m_text[slot], std::string());
+  set_text(m_translation[slot], std::string());
+  set_text(m_note[slot], std::string());
+}
+
+// Copy all the values of the slot src of the store from to the slot dst.
+void SubtitleStore::copy(Slot dst, const SubtitleStore &from, Slot src) {
+  g_return_if_fail(dst < m_size);
+  g_return_if_fail(src < from.m_size);
+
+  static const Field int_fields[] = {START, END, DURATION, GAP_BEFORE,
+                                     GAP_AFTER};
+  static const Field string_fields[] = {LAYER,    STYLE,    NAME,
+                                        MARGIN_L, MARGIN_R, MARGIN_V,
+                                        EFFECT,   TEXT,     TRANSLATION,
+                                        NOTE};
+  static const Field lines_fields[] = {CHARACTERS_PER_LINE_TEXT,
+                                       CHARACTERS_PER_LINE_TRANSLATION};
+
+  for (const auto &field : int_fields) {
+    set_int(dst, field, from.get_int(src, field));
+  }
+  // get_string() returns a copy, from can be this store
+  for (const auto &field : string_fields) {
+    set_string(dst, field, from.get_string(src, field));
+  }
+  // the same for the line lengths
+  for (const auto &field : lines_fields) {
+    gsize count = 0;
+    const guint32 *lines = from.get_lines(src, field, count);
+    std::vector<guint32> copy(lines, lines + count);
+    set_lines((*lines_column(field))[dst], copy.data(), count);
+  }
+  set_double(dst, CHARACTERS_PER_SECOND_TEXT,
+             from.get_double(src, CHARACTERS_PER_SECOND_TEXT));
+  m_dirty[dst] = from.m_dirty[src];
+}
+
+// Replace the id of the interned value, the references are updated.
+void SubtitleStore::set_interned(guint32 &value, guint32 id) {
+  if (value == id)
+    return;
+  m_pool.ref(id);
+  m_pool.unref(value);
+  value = id;
+}
+
+std::vector<gint64> *SubtitleStore::int_column(Field field) const {
+  SubtitleStore *self = const_cast<SubtitleStore *>(this);
+  switch (field) {
+    case START:
+      return &self->m_start;
+    case END:
+      return &self->m_end;
+    case DURATION:
+      return &self->m_duration;
+    case GAP_BEFORE:
+      return &self->m_gap_before;
+    case GAP_AFTER:
+      return &self->m_gap_after;
+    default:
+      return nullptr;
+  }
+}
+
+std::vector<guint32> *SubtitleStore::interned_column(Field field) const {
+  SubtitleStore *self = const_cast<SubtitleStore *>(this);
+  switch (field) {
+    case LAYER:
+      return &self->m_layer;
+    case STYLE:
+      return &self->m_style;
+    case NAME:
+      return &self->m_name;
+    case MARGIN_L:
+      return &self->m_margin_l;
+    case MARGIN_R:
+      return &self->m_margin_r;
+    case MARGIN_V:
+      return &self->m_margin_v;
+    case EFFECT:
+      return &self->m_effect;
+    default:
+      return nullptr;
+  }
+}
+
+std::vector<SubtitleStore::TextRef> *SubtitleStore::text_column(
+    Field field) const {
+  SubtitleStore *self = const_cast<SubtitleStore *>(this);
+  switch (field) {
+    case TEXT:
+      return &self->m_text;
+    case TRANSLATION:
+      return &self->m_translation;
+    case NOTE:
+      return &self->m_note;
+    default:
+      return nullptr;
+  }
+}
+
+std::vector<SubtitleStore::LinesRef> *SubtitleStore::lines_column(
+    Field field) const {
+  SubtitleStore *self = const_cast<SubtitleStore *>(this);
+  switch (field) {
+    case CHARACTERS_PER_LINE_TEXT:
+      return &self->m_cpl_text;
+    case CHARACTERS_PER_LINE_TRANSLATION:
+      return &self->m_cpl_translation;
+    default:
+      return nullptr;
+  }
+}
+
+gint64 SubtitleStore::get_int(Slot slot, Field field) const {
+  g_return_val_if_fail(slot < m_size, 0);
+
+  std::vector<gint64> *column = int_column(field);
+  g_return_val_if_fail(column, 0);
+
+  return (*column)[slot];
+}
+
+void SubtitleStore::set_int(Slot slot, Field field, gint64 value) {
+  g_return_if_fail(slot < m_size);
+
+  std::vector<gint64> *column = int_column(field);
+  g_return_if_fail(column);
+
+  (*column)[slot] = value;
+
+  if (field == START || field == END || field == DURATION)
+    m_dirty[slot] |= DIRTY_CPS_TEXT;
+}
+
+double SubtitleStore::get_double(Slot slot, Field field) const {
+  g_return_val_if_fail(slot < m_size, 0);
+  g_return_val_if_fail(field == CHARACTERS_PER_SECOND_TEXT, 0);
+
+  return m_cps_text[slot];
+}
+
+void SubtitleStore::set_double(Slot slot, Field field, double value) {
+  g_return_if_fail(slot < m_size);
+  g_return_if_fail(field == CHARACTERS_PER_SECOND_TEXT);
+
+  m_cps_text[slot] = value;
+  m_dirty[slot] &= ~DIRTY_CPS_TEXT;
+}
+
+const char *SubtitleStore::get_string_data(Slot slot, Field field,
+                                           gsize &size) const {
+  size = 0;
+  g_return_val_if_fail(slot < m_size, "");
+
+  std::vector<guint32> *interned = interned_column(field);
+  if (interned) {
+    const std::string &str = m_pool.get((*interned)[slot]);
+    size = str.size();
+    return str.data();
+  }
+
+  std::vector<TextRef> *texts = text_column(field);
+  g_return_val_if_fail(texts, "");
+
+  const TextRef &ref = (*texts)[slot];
+  size = ref.size;
+  return m_arena.data() + ref.offset;
+}
+
+Glib::ustring SubtitleStore::get_string(Slot slot, Field field) const {
+  if (lines_column(field)) {
+    gsize count = 0;
+    const guint32 *lines = get_lines(slot, field, count);
+    if (count == 0)
+      return "0";
+
+    std::string cpl = std::to_string(lines[0]);
+    for (gsize i = 1; i < count; ++i) {
+      cpl += '\n';
+      cpl += std::to_string(lines[i]);
+    }
+    return cpl;
+  }
+
+  gsize size = 0;
+  const char *data = get_string_data(slot, field, size);
+  return Glib::ustring(data, data + size);
+}
+
+void SubtitleStore::set_string(Slot slot, Field field,
+                               const Glib::ustring &value) {
+  g_return_if_fail(slot < m_size);
+
+  std::vector<guint32> *interned = interned_column(field);
+  if (interned) {
+    guint32 id = m_pool.ref(value.raw());
+    m_pool.unref((*interned)[slot]);
+    (*interned)[slot] = id;
+    return;
+  }
+
+  // the numbers of the characters per line (ex: "3\n3")
+  if (lines_column(field)) {
+    std::vector<int> lines;
+    const char *str = value.c_str();
+    while (*str != '\0') {
+      char *end = nullptr;
+      lines.push_back(static_cast<int>(g_ascii_strtoull(str, &end, 10)));
+      if (*end != '\n')
+        break;
+      str = end + 1;
+    }
+    set_lines(slot, field, lines);
+    return;
+  }
+
+  std::vector<TextRef> *texts = text_column(field);
+  g_return_if_fail(texts);
+
+  set_text((*texts)[slot], value.raw());
+
+  if (field == TEXT)
+    m_dirty[slot] |= DIRTY_CPL_TEXT | DIRTY_CPS_TEXT;
+  else if (field == TRANSLATION)
+    m_dirty[slot] |= DIRTY_CPL_TRANSLATION;
+}
+
+const guint32 *SubtitleStore::get_lines(Slot slot, Field field,
+                                        gsize &count) const {
+  count = 0;
+  g_return_val_if_fail(slot < m_size, nullptr);
+
+  std::vector<LinesRef> *column = lines_column(field);
+  g_return_val_if_fail(column, nullptr);
+
+  const LinesRef &ref = (*column)[slot];
+  count = ref.count;
+  return m_lines.data() + ref.offset;
+}
+
+void SubtitleStore::set_lines(Slot slot, Field field,
+                              const std::vector<int> &lines) {
+  g_return_if_fail(slot < m_size);
+
+  std::vector<LinesRef> *column = lines_column(field);
+  g_return_if_fail(column);
+
+  std::vector<guint32> values(lines.begin(), lines.end());
+  set_lines((*column)[slot], values.data(), values.size());
+
+  if (field == CHARACTERS_PER_LINE_TEXT)
+    m_dirty[slot] &= ~DIRTY_CPL_TEXT;
+  else
+    m_dirty[slot] &= ~DIRTY_CPL_TRANSLATION;
+}
+
+// Write the text in place if it's not longer, otherwise at the end of the
+// arena.
+void SubtitleStore::set_text(TextRef &ref, const std::string &value) {
+  if (value.size() <= ref.size) {
+    value.copy(&m_arena[ref.offset], value.size());
+    m_arena_unused += ref.size - value.size();
+    ref.size = value.size();
+    return;
+  }
+
+  m_arena_unused += ref.size;
+
+  ref.offset = m_arena.size();
+  ref.size = value.size();
+  m_arena.append(value);
+
+  if (m_arena_unused > ARENA_COMPACT_MIN_UNUSED &&
+      m_arena_unused > m_arena.size() / 2)
+    compact_texts();
+}
+
+// Rewrite the arena without the unused bytes.
+void SubtitleStore::compact_texts() {
+  std::string arena;
+  arena.reserve(m_arena.size() - m_arena_unused);
+
+  for (auto column : {&m_text, &m_translation, &m_note}) {
+    for (auto &ref : *column) {
+      guint32 offset = arena.size();
+      arena.append(m_arena, ref.offset, ref.size);
+      ref.offset = offset;
+    }
+  }
+
+  m_arena.swap(arena);
+  m_arena_unused = 0;
+}
+
+// Write the line lengths in place if there are not more lines, otherwise at
+// the end of m_lines.
+void SubtitleStore::set_lines(LinesRef &ref, const guint32 *lines,
+                              gsize count) {
+  if (count <= ref.count) {
+    std::copy(lines, lines + count, m_lines.begin() + ref.offset);
+    m_lines_unused += ref.count - count;
+    ref.count = count;
+    return;
+  }
+
+  m_lines_unused += ref.count;
+
+  ref.offset = m_lines.size();
+  ref.count = count;
+  m_lines.insert(m_lines.end(), lines, lines + count);
+
+  if (m_lines_unused > LINES_COMPACT_MIN_UNUSED &&
+      m_lines_unused > m_lines.size() / 2)
+    compact_lines();
+}
+
+// Rewrite m_lines without the unused values.
+void SubtitleStore::compact_lines() {
+  std::vector<guint32> lines;
+  lines.reserve(m_lines.size() - m_lines_unused);
+
+  for (auto column : {&m_cpl_text, &m_cpl_translation}) {
+    for (auto &ref : *column) {
+      guint32 offset = lines.size();
+      lines.insert(lines.end(), m_lines.begin() + ref.offset,
+                   m_lines.begin() + ref.offset + ref.count);
+      ref.offset = offset;
+    }
+  }
+
+  m_lines.swap(lines);
+  m_lines_unused = 0;
+}
+
+// Return the number of bytes used by the store.
+gsize SubtitleStore::memory_usage() const {
+  gsize size = sizeof(SubtitleStore);
+
+  size += (m_start.capacity() + m_end.capacity() + m_duration.capacity() +
+           m_gap_before.capacity() + m_gap_after.capacity()) *
+          sizeof(gint64);
+  size += m_cps_text.capacity() * sizeof(double);
+  size += m_dirty.capacity();
+
+  size += (m_layer.capacity() + m_style.capacity() + m_name.capacity() +
+           m_margin_l.capacity() + m_margin_r.capacity() +
+           m_margin_v.capacity() + m_effect.capacity()) *
+          sizeof(guint32);
+  size += m_pool.memory_usage();
+
+  size += m_lines.capacity() * sizeof(guint32);
+  size += (m_cpl_text.capacity() + m_cpl_translation.capacity()) *
+          sizeof(LinesRef);
+
+  size += m_arena.capacity();
+  size += (m_text.capacity() + m_translation.capacity() + m_note.capacity()) *
+          sizeof(TextRef);
+
+  size += m_free_slots.capacity() * sizeof(Slot);
+  return size;
+}
+
+// Write all the values of the store in data (undo spill file).
+void SubtitleStore::save(std::string &data) const {
+  data.clear();
+
+  write_value(data, m_size);
+  write_vector(data, m_free_slots);
+
+  for (const auto column :
+       {&m_start, &m_end, &m_duration, &m_gap_before, &m_gap_after}) {
+    write_vector(data, *column);
+  }
+  write_vector(data, m_cps_text);
+  write_vector(data, m_dirty);
+
+  const std::vector<std::string> &strings = m_pool.strings();
+  write_value<guint32>(data, strings.size());
+  for (const auto &str : strings) {
+    write_string(data, str);
+  }
+  for (const auto column : {&m_layer, &m_style, &m_name, &m_margin_l,
+                            &m_margin_r, &m_margin_v, &m_effect}) {
+    write_vector(data, *column);
+  }
+
+  write_vector(data, m_lines);
+  write_value<guint64>(data, m_lines_unused);
+  write_vector(data, m_cpl_text);
+  write_vector(data, m_cpl_translation);
+
+  write_string(data, m_arena);
+  write_value<guint64>(data, m_arena_unused);
+  for (const auto column : {&m_text, &m_translation, &m_note}) {
+    write_vector(data, *column);
+  }
+}
+
+// Restore the values written by save(). Return false if data is invalid.
+// The data are read in a new store, this one is replaced only if all of
+// them are valid.
+bool SubtitleStore::load(const std::string &data) {
+  SubtitleStore store;
+  if (!store.read(data))
+    return false;
+
+  *this = std::move(store);
+  return true;
+}
+
+// Read the values written by save() in a new store and check the size of
+// each column and each reference. Return false if data is invalid.
+bool SubtitleStore::read(const std::string &data) {
+  StoreReader reader(data);
+
+  if (!reader.read_value(m_size) || !reader.read_vector(m_free_slots))
+    return false;
+  std::vector<bool> is_free(m_size, false);
+  for (const auto slot : m_free_slots) {
+    if (slot >= m_size || is_free[slot])
+      return false;
+    is_free[slot] = true;
+  }
+
+  for (auto column :
+       {&m_start, &m_end, &m_duration, &m_gap_before, &m_gap_after}) {
+    if (!reader.read_vector(*column) || column->size() != m_size)
+      return false;
+  }
+  if (!reader.read_vector(m_cps_text) || m_cps_text.size() != m_size ||
+      !reader.read_vector(m_dirty) || m_dirty.size() != m_size)
+    return false;
+
+  // the ids of the default strings don't change, they are the first ones
+  guint32 count = 0;
+  if (!reader.read_value(count))
+    return false;
+  std::vector<std::string> strings(count);
+  for (auto &str : strings) {
+    if (!reader.read_string(str))
+      return false;
+  }
+  if (count < 3 || strings[m_id_empty] != m_pool.get(m_id_empty) ||
+      strings[m_id_zero] != m_pool.get(m_id_zero) ||
+      strings[m_id_default] != m_pool.get(m_id_default))
+    return false;
+  for (auto column : {&m_layer, &m_style, &m_name, &m_margin_l, &m_margin_r,
+                      &m_margin_v, &m_effect}) {
+    if (!reader.read_vector(*column) || column->size() != m_size)
+      return false;
+    for (auto id : *column) {
+      if (id >= count)
+        return false;
+    }
+  }
+
+  // Count the references of the slots (and of the default strings)
+  m_pool.restore(strings);
+  for (const auto id : {m_id_empty, m_id_zero, m_id_default}) {
+    m_pool.ref(id);
+  }
+  for (auto column : {&m_layer, &m_style, &m_name, &m_margin_l, &m_margin_r,
+                      &m_margin_v, &m_effect}) {
+    for (auto id : *column) {
+      m_pool.ref(id);
+    }
+  }
+  m_pool.release_unused();
+
+  guint64 unused = 0;
+  if (!reader.read_vector(m_lines) || !reader.read_value(unused) ||
+      unused > m_lines.size())
+    return false;
+  m_lines_unused = unused;
+  for (auto column : {&m_cpl_text, &m_cpl_translation}) {
+    if (!reader.read_vector(*column) || column->size() != m_size)
+      return false;
+    for (const auto &ref : *column) {
+      if (ref.offset > m_lines.size() ||
+          ref.count > m_lines.size() - ref.offset)
+        return false;
+    }
+  }
+
+  if (!reader.read_string(m_arena) || !reader.read_value(unused) ||
+      unused > m_arena.size())
+    return false;
+  m_arena_unused = unused;
+  for (auto column : {&m_text, &m_translation, &m_note}) {
+    if (!reader.read_vector(*column) || column->size() != m_size)
+      return false;
+    for (const auto &ref : *column) {
+      if (ref.offset > m_arena.size() ||
+          ref.size > m_arena.size() - ref.offset)
+        return false;
+    }
+  }
+  return reader.at_end();
+}
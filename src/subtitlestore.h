@@ -0,0 +1,257 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <glibmm.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Columnar storage of the subtitles, used by SubtitleModel.
+// Each subtitle is a slot and each field is stored in its own array:
+//  - the times as 64 bits integers,
+//  - the short and repeated strings (layer, style, name, margins and effect)
+//    as an index in a pool of interned strings,
+//  - the characters per line as numbers in an array of line lengths,
+//  - the text, the translation and the note in a text arena.
+// A slot keeps its values until it is released, the order of the rows is
+// handled by SubtitleModel. NUM is not stored, the number of a subtitle is
+// its position in the model.
+class SubtitleStore {
+ public:
+  // The fields follow the order of the columns (SubtitleColumnRecorder).
+  enum Field {
+    NUM,
+    LAYER,
+    START,
+    END,
+    DURATION,
+    GAP_BEFORE,
+    GAP_AFTER,
+    STYLE,
+    NAME,
+    MARGIN_L,
+    MARGIN_R,
+    MARGIN_V,
+    EFFECT,
+    TEXT,
+    TRANSLATION,
+    CHARACTERS_PER_LINE_TEXT,
+    CHARACTERS_PER_SECOND_TEXT,
+    CHARACTERS_PER_LINE_TRANSLATION,
+    NOTE
+  };
+
+  // The type of the value of a field.
+  enum Type { INT, DOUBLE, STRING };
+
+  typedef guint32 Slot;
+
+  // Return the type of the value of the field (NUM is an INT).
+  static Type get_type(Field field);
+
+  SubtitleStore();
+
+  // Return a new slot with the default values.
+  Slot create();
+
+  // Release the slot, it can be reused by create().
+  void release(Slot slot);
+
+  // Set the default values of the slot.
+  void reset(Slot slot);
+
+  // Copy all the values of the slot src of the store from to the slot dst.
+  void copy(Slot dst, const SubtitleStore &from, Slot src);
+
+  // START, END, DURATION, GAP_BEFORE, GAP_AFTER
+  gint64 get_int(Slot slot, Field field) const;
+  void set_int(Slot slot, Field field, gint64 value);
+
+  // CHARACTERS_PER_SECOND_TEXT
+  double get_double(Slot slot, Field field) const;
+  void set_double(Slot slot, Field field, double value);
+
+  // All the string fields.
+  // The characters per line are returned as a string (ex: "6" or "3\n3").
+  Glib::ustring get_string(Slot slot, Field field) const;
+  void set_string(Slot slot, Field field, const Glib::ustring &value);
+
+  // Return the (not null terminated) data of a string field, except the
+  // characters per line. The pointer is valid until the next change of the
+  // store.
+  const char *get_string_data(Slot slot, Field field, gsize &size) const;
+
+  // CHARACTERS_PER_LINE_TEXT, CHARACTERS_PER_LINE_TRANSLATION
+  // Return the number of characters of each line. The pointer is valid until
+  // the next change of the store.
+  const guint32 *get_lines(Slot slot, Field field, gsize &count) const;
+  void set_lines(Slot slot, Field field, const std::vector<int> &lines);
+
+  // The computed values (characters per line and per second) are marked as
+  // out of date when the text, the translation or the times change, and
+  // up to date when they are set. SubtitleModel updates them on the first
+  // read.
+  enum Dirty {
+    DIRTY_CPL_TEXT = 1 << 0,
+    DIRTY_CPL_TRANSLATION = 1 << 1,
+    DIRTY_CPS_TEXT = 1 << 2,
+    DIRTY_ALL = DIRTY_CPL_TEXT | DIRTY_CPL_TRANSLATION | DIRTY_CPS_TEXT
+  };
+
+  guint8 get_dirty(Slot slot) const {
+    return m_dirty[slot];
+  }
+
+  // Return the number of bytes used by the store.
+  gsize memory_usage() const;
+
+  // Write all the values of the store in data (undo spill file).
+  void save(std::string &data) const;
+
+  // Restore the values written by save(). Return false if data is invalid,
+  // the store doesn't change.
+  bool load(const std::string &data);
+
+ protected:
+  // Pool of interned strings counted by reference. A string is released by
+  // its last reference and its id is reused by the next new string.
+  class StringPool {
+   public:
+    // Return the id of the string and add a reference to it.
+    guint32 ref(const std::string &str);
+
+    // Add a reference to the id.
+    void ref(guint32 id) {
+      ++m_refs[id];
+    }
+
+    // Remove a reference to the id, the last one releases the string.
+    void unref(guint32 id);
+
+    const std::string &get(guint32 id) const {
+      return m_strings[id];
+    }
+
+    // Return the number of strings used.
+    gsize size() const {
+      return m_ids.size();
+    }
+
+    gsize memory_usage() const;
+
+    // All the ids, a released id is an empty string.
+    const std::vector<std::string> &strings() const {
+      return m_strings;
+    }
+
+    // Replace the strings by the strings saved (the same ids), without
+    // reference. The references are added by ref(id), then
+    // release_unused() releases the strings without reference.
+    void restore(std::vector<std::string> &strings);
+    void release_unused();
+
+   protected:
+    std::vector<std::string> m_strings;
+    std::vector<guint32> m_refs;
+    std::vector<guint32> m_free_ids;
+    std::unordered_map<std::string, guint32> m_ids;
+  };
+
+  // A text in the arena.
+  struct TextRef {
+    guint32 offset;
+    guint32 size;
+  };
+
+  // The line lengths of a text in m_lines.
+  struct LinesRef {
+    guint32 offset;
+    guint32 count;
+  };
+
+  // Replace the id of the interned value, the references are updated.
+  void set_interned(guint32 &value, guint32 id);
+
+  // Return the column of the field or NULL.
+  std::vector<gint64> *int_column(Field field) const;
+  std::vector<guint32> *interned_column(Field field) const;
+  std::vector<TextRef> *text_column(Field field) const;
+  std::vector<LinesRef> *lines_column(Field field) const;
+
+  // Write the text in place if it's not longer, otherwise at the end of the
+  // arena.
+  void set_text(TextRef &ref, const std::string &value);
+
+  // Rewrite the arena without the unused bytes.
+  void compact_texts();
+
+  // Write the line lengths in place if there are not more lines, otherwise
+  // at the end of m_lines.
+  void set_lines(LinesRef &ref, const guint32 *lines, gsize count);
+
+  // Rewrite m_lines without the unused values.
+  void compact_lines();
+
+  // Read the values written by save() in a new store and check the size of
+  // each column and each reference. Return false if data is invalid.
+  bool read(const std::string &data);
+
+ protected:
+  guint32 m_size{0};
+  std::vector<Slot> m_free_slots;
+
+  // times
+  std::vector<gint64> m_start;
+  std::vector<gint64> m_end;
+  std::vector<gint64> m_duration;
+  std::vector<gint64> m_gap_before;
+  std::vector<gint64> m_gap_after;
+  std::vector<double> m_cps_text;
+  // Dirty flags of the computed values
+  std::vector<guint8> m_dirty;
+
+  // interned strings
+  StringPool m_pool;
+  guint32 m_id_empty;
+  guint32 m_id_zero;
+  guint32 m_id_default;
+  std::vector<guint32> m_layer;
+  std::vector<guint32> m_style;
+  std::vector<guint32> m_name;
+  std::vector<guint32> m_margin_l;
+  std::vector<guint32> m_margin_r;
+  std::vector<guint32> m_margin_v;
+  std::vector<guint32> m_effect;
+
+  // characters per line
+  std::vector<guint32> m_lines;
+  gsize m_lines_unused{0};
+  std::vector<LinesRef> m_cpl_text;
+  std::vector<LinesRef> m_cpl_translation;
+
+  // text arena
+  std::string m_arena;
+  gsize m_arena_unused{0};
+  std::vector<TextRef> m_text;
+  std::vector<TextRef> m_translation;
+  std::vector<TextRef> m_note;
+};
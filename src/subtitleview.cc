@@ -331,6 +331,38 @@ void SubtitleView::update_visible_range() {
 SubtitleView::~SubtitleView() {
 }
 
+Gtk::Widget *SubtitleView::widget() {
+  return this;
+}
+
+std::vector<Gtk::TreeModel::Path> SubtitleView::get_selected_rows() {
+  return get_selection()->get_selected_rows();
+}
+
+void SubtitleView::select_row(const Gtk::TreeIter &iter) {
+  get_selection()->select(iter);
+}
+
+void SubtitleView::select_row(const Gtk::TreeModel::Path &path) {
+  get_selection()->select(path);
+}
+
+void SubtitleView::unselect_row(const Gtk::TreeIter &iter) {
+  get_selection()->unselect(iter);
+}
+
+bool SubtitleView::is_row_selected(const Gtk::TreeIter &iter) {
+  return get_selection()->is_selected(iter);
+}
+
+void SubtitleView::select_all_rows() {
+  get_selection()->select_all();
+}
+
+void SubtitleView::unselect_all_rows() {
+  get_selection()->unselect_all();
+}
+
 void SubtitleView::loadCfg() {
   se_dbg(SE_DBG_VIEW);
 
@@ -934,7 +966,7 @@ void SubtitleView::on_edited_text(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("text") != newtext) {
+    if (subtitle.get_text() != newtext) {
       m_refDocument->start_command(_("Editing text"));
 
       subtitle.set_text(newtext);
@@ -951,7 +983,7 @@ void SubtitleView::on_edited_translation(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("translation") != newtext) {
+    if (subtitle.get_translation() != newtext) {
       m_refDocument->start_command(_("Editing translation"));
       subtitle.set_translation(newtext);
       m_refDocument->finish_command();
@@ -966,7 +998,7 @@ void SubtitleView::on_edited_note(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("note") != newtext) {
+    if (subtitle.get_note() != newtext) {
       m_refDocument->start_command(_("Editing note"));
       subtitle.set_note(newtext);
       m_refDocument->finish_command();
@@ -980,7 +1012,7 @@ void SubtitleView::on_edited_effect(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("effect") != newtext) {
+    if (subtitle.get_effect() != newtext) {
       m_refDocument->start_command(_("Editing effect"));
       subtitle.set_effect(newtext);
       m_refDocument->finish_command();
@@ -995,7 +1027,7 @@ void SubtitleView::on_edited_style(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("style") != newstyle) {
+    if (subtitle.get_style() != newstyle) {
       m_refDocument->start_command(_("Editing style"));
       subtitle.set_style(newstyle);
       m_refDocument->finish_command();
@@ -1010,7 +1042,7 @@ void SubtitleView::on_edited_name(const Glib::ustring &path,
 
   Subtitle subtitle(m_refDocument, path);
   if (subtitle) {
-    if (subtitle.get("name") != newname) {
+    if (subtitle.get_name() != newname) {
       m_refDocument->start_command(_("Editing name"));
       subtitle.set_name(newname);
       m_refDocument->finish_command();
@@ -1147,7 +1179,7 @@ void SubtitleView::on_set_style_to_selection(const Glib::ustring &name) {
 
   m_refDocument->start_command(_("Set style to selection"));
   for (auto &select : selection) {
-    select.set("style", name);
+    select.set_style(name);
   }
   m_refDocument->finish_command();
 }
@@ -1314,3 +1346,51 @@ Glib::ustring SubtitleView::get_current_column_name() {
     return get_name_of_column(m_currentColumn);
   return Glib::ustring();
 }
+
+// Detach the model from the view (bulk edit).
+// The selection, the cursor and the scroll position are kept.
+void SubtitleView::detach_model() {
+  se_dbg(SE_DBG_VIEW);
+
+  m_detached_selection = get_selection()->get_selected_rows();
+
+  Gtk::TreeViewColumn *column = nullptr;
+  get_cursor(m_detached_cursor, column);
+
+  Gtk::TreeModel::Path end;
+  if (!get_visible_range(m_detached_top, end))
+    m_detached_top = Gtk::TreeModel::Path();
+
+  unset_model();
+}
+
+// Attach again the model and restore the selection, the cursor and the
+// scroll position.
+void SubtitleView::attach_model() {
+  se_dbg(SE_DBG_VIEW);
+
+  // Not detached (the view can be created during the bulk edit)
+  if (get_model())
+    return;
+
+  set_model(m_subtitleModel);
+
+  if (!m_detached_cursor.empty() &&
+      m_subtitleModel->get_iter(m_detached_cursor))
+    set_cursor(m_detached_cursor);
+
+  Glib::RefPtr<Gtk::TreeSelection> selection = get_selection();
+  selection->unselect_all();
+  for (const auto &path : m_detached_selection) {
+    if (m_subtitleModel->get_iter(path))
+      selection->select(path);
+  }
+
+  // set_cursor scrolls to the cursor, go back to the previous first row
+  if (!m_detached_top.empty() && m_subtitleModel->get_iter(m_detached_top))
+    scroll_to_row(m_detached_top, 0.0);
+
+  m_detached_selection.clear();
+  m_detached_cursor = Gtk::TreeModel::Path();
+  m_detached_top = Gtk::TreeModel::Path();
+}
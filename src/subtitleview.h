@@ -22,16 +22,28 @@
 
 #include <gtkmm.h>
 #include "cfg.h"
+#include "documentview.h"
 #include "stylemodel.h"
 
 class Document;
 class SubtitleModel;
 
-class SubtitleView : public Gtk::TreeView {
+class SubtitleView : public Gtk::TreeView, public DocumentView {
  public:
   explicit SubtitleView(Document &doc);
   ~SubtitleView();
 
+  // DocumentView
+  Gtk::Widget *widget();
+
+  std::vector<Gtk::TreeModel::Path> get_selected_rows();
+  void select_row(const Gtk::TreeIter &iter);
+  void select_row(const Gtk::TreeModel::Path &path);
+  void unselect_row(const Gtk::TreeIter &iter);
+  bool is_row_selected(const Gtk::TreeIter &iter);
+  void select_all_rows();
+  void unselect_all_rows();
+
   // return first iter select
   Gtk::TreeIter getSelected();
 
@@ -47,6 +59,14 @@ class SubtitleView : public Gtk::TreeView {
   // (start, end, duration, text, translation ...)
   Glib::ustring get_current_column_name();
 
+  // Detach the model from the view (bulk edit).
+  // The selection, the cursor and the scroll position are kept.
+  void detach_model();
+
+  // Attach again the model and restore the selection, the cursor and the
+  // scroll position.
+  void attach_model();
+
  protected:
   void loadCfg();
 
@@ -190,6 +210,11 @@ class SubtitleView : public Gtk::TreeView {
 
   Gtk::Menu m_menu_popup;
 
+  // selection, cursor and first visible row kept by detach_model
+  std::vector<Gtk::TreeModel::Path> m_detached_selection;
+  Gtk::TreeModel::Path m_detached_cursor;
+  Gtk::TreeModel::Path m_detached_top;
+
  protected:
   bool check_timing;
   long min_gap;
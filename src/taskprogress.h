@@ -0,0 +1,55 @@
+#pragma once
+
+// subtitleeditor -- a tool to create or edit subtitle
+//
+// https://kitone.github.io/subtitleeditor/
+// https://github.com/kitone/subtitleeditor/
+//
+// Copyright @ 2005-2018, kitone
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+
+// The progress of a task done by another thread (DocumentLoader).
+// The thread sets the fraction and checks the cancellation, the main loop
+// reads the fraction and can cancel the task.
+class TaskProgress {
+ public:
+  // Define the fraction of the task done (0 to 1).
+  void set_fraction(double fraction) {
+    m_fraction = fraction;
+  }
+
+  // Return the fraction of the task done (0 to 1).
+  double get_fraction() const {
+    return m_fraction;
+  }
+
+  // Ask the thread to stop.
+  void cancel() {
+    m_cancelled = true;
+  }
+
+  bool is_cancelled() const {
+    return m_cancelled;
+  }
+
+  // Throw CancelledError if the task has been cancelled.
+  void check_cancelled() const;
+
+ protected:
+  std::atomic<double> m_fraction{0};
+  std::atomic<bool> m_cancelled{false};
+};
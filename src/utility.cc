@@ -291,32 +291,108 @@ unsigned long get_min_duration_msecs(const Glib::ustring &text, double maxcps) {
       (unsigned long)get_text_length_for_timing(text), maxcps);
 }
 
+// The spaces are not counted if the option timing/ignore-space is enabled.
+// Read once, like before.
+static bool is_space_ignored() {
+  static bool ignore_space = cfg::get_boolean("timing", "ignore-space");
+  return ignore_space;
+}
+
+// Single pass over the text without the tags (<i>, </i>, {\an8}, ...) and
+// without the spaces if ignore_space is true. A tag is closed on the same
+// line, otherwise '<' or '{' is a character like the others (as the old
+// pattern "<.*?>|{.*?}").
+// append(begin, end) is called for each visible part of a line, newline()
+// at the end of each line.
+template <class Append, class NewLine>
+static void strip_tags(const std::string &text, bool ignore_space,
+                       Append append, NewLine newline) {
+  const char *data = text.data();
+  const gsize size = text.size();
+
+  // Position of the end of the line where there is no '>' or '}' after a
+  // failed search, the next '<' or '{' of the line can't be a tag.
+  gsize no_close_angle = 0;
+  gsize no_close_brace = 0;
+
+  gsize start = 0;
+  gsize i = 0;
+  while (i < size) {
+    char c = data[i];
+
+    if (c == '\n') {
+      append(data + start, data + i);
+      newline();
+      start = ++i;
+      continue;
+    }
+
+    if (c == ' ' && ignore_space) {
+      append(data + start, data + i);
+      start = ++i;
+      continue;
+    }
+
+    if (c == '<' || c == '{') {
+      char close = (c == '<') ? '>' : '}';
+      gsize &no_close = (c == '<') ? no_close_angle : no_close_brace;
+
+      if (i >= no_close) {
+        gsize end = i + 1;
+        while (end < size && data[end] != close && data[end] != '\n') ++end;
+
+        if (end < size && data[end] == close) {
+          append(data + start, data + i);
+          start = i = end + 1;
+          continue;
+        }
+        no_close = end;
+      }
+    }
+    ++i;
+  }
+  append(data + start, data + size);
+}
+
 // get number of characters for each line in the text
+// The last line is ignored if it's empty (like std::getline).
 std::vector<int> get_characters_per_line(const Glib::ustring &text) {
   std::vector<int> num_characters;
-  std::istringstream iss(utility::get_stripped_text(text));
-  std::string line;
-
-  while (std::getline(iss, line)) {
-    Glib::ustring::size_type len =
-        reinterpret_cast<Glib::ustring &>(line).size();
-    num_characters.push_back(len);
-  }
+  int count = 0;
+
+  strip_tags(
+      text.raw(), is_space_ignored(),
+      [&count](const char *begin, const char *end) {
+        // count the UTF-8 characters (not the continuation bytes)
+        for (const char *p = begin; p < end; ++p) {
+          if ((static_cast<guchar>(*p) & 0xC0) != 0x80)
+            ++count;
+        }
+      },
+      [&num_characters, &count]() {
+        num_characters.push_back(count);
+        count = 0;
+      });
+
+  if (count > 0)
+    num_characters.push_back(count);
 
   return num_characters;
 }
 
 // get a text stripped from tags
 Glib::ustring get_stripped_text(const Glib::ustring &text) {
-  // pattern for tags like <i>, </i>, {\comment}, etc.
-  // or space
-  static bool ignore_space = cfg::get_boolean("timing", "ignore-space");
-  static Glib::RefPtr<Glib::Regex> tag_pattern =
-      ignore_space ? Glib::Regex::create("<.*?>|{.*?}| ")
-                   : Glib::Regex::create("<.*?>|{.*?}");
+  std::string stripped;
+  stripped.reserve(text.bytes());
+
+  strip_tags(
+      text.raw(), is_space_ignored(),
+      [&stripped](const char *begin, const char *end) {
+        stripped.append(begin, end);
+      },
+      [&stripped]() { stripped += '\n'; });
 
-  return tag_pattern->replace(text, 0, "",
-                              static_cast<Glib::RegexMatchFlags>(0));
+  return stripped;
 }
 
 void set_transient_parent(Gtk::Window &window) {
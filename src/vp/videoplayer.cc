@@ -319,10 +319,14 @@ bool VideoPlayer::find_subtitle() {
 
   if (!m_subtitle) {
     m_subtitle = doc->subtitles().find(time);
-    if (m_subtitle)
+    if (m_subtitle) {
       show_subtitle_text();
-    else
+    } else {
+      // Between two subtitles, keep the next one. The following ticks only
+      // compare with its start instead of searching again.
+      m_subtitle = doc->subtitles().find_at_or_after(time);
       show_subtitle_null();
+    }
   } else {
     if (is_good_subtitle(m_subtitle, position)) {  // is good ?
       show_subtitle_text();
@@ -18,11 +18,56 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <giomm.h>
 #include <math.h>
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include "debug.h"
 #include "waveform.h"
 
+// The header of a v3 file. It's followed by the video uri (video_uri_size
+// bytes) and the peaks at data_offset: n_channels arrays of n_samples values,
+// each array aligned on 16 bytes.
+struct WaveformHeaderV3 {
+  // "waveform v3\n", the first line like the old versions
+  char magic[12];
+  // BYTE_ORDER_MARK in the byte order of the writer
+  guint32 byte_order;
+  // Waveform::SampleType
+  guint32 sample_type;
+  guint32 n_channels;
+  guint32 video_uri_size;
+  guint32 reserved;
+  // msecs
+  gint64 duration;
+  // number of peaks by channel
+  guint64 n_samples;
+  guint64 data_offset;
+};
+
+static_assert(sizeof(WaveformHeaderV3) == 56, "unexpected padding");
+
+static const char MAGIC_V3[12] = {'w', 'a', 'v', 'e', 'f', 'o',
+                                  'r', 'm', ' ', 'v', '3', '\n'};
+static const guint32 BYTE_ORDER_MARK = 0x01020304;
+static const gsize ALIGNMENT = 16;
+
+// Round up size to a multiple of ALIGNMENT.
+static guint64 align_size(guint64 size) {
+  return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Return the size of a peak of the type or 0 if it's unknown.
+static gsize get_sample_size(guint32 type) {
+  if (type == Waveform::SAMPLE_INT16)
+    return sizeof(gint16);
+  if (type == Waveform::SAMPLE_FLOAT32)
+    return sizeof(float);
+  return 0;
+}
+
 // Open Wavefrom from file
 Glib::RefPtr<Waveform> Waveform::create_from_file(const Glib::ustring &uri) {
   Glib::RefPtr<Waveform> wf = Glib::RefPtr<Waveform>(new Waveform);
@@ -42,6 +87,7 @@ Waveform::Waveform() {
 }
 
 Waveform::~Waveform() {
+  clear();
 }
 
 void Waveform::reference() const {
@@ -54,7 +100,17 @@ void Waveform::unreference() const {
 }
 
 guint Waveform::get_size() {
-  return m_channels[0].size();
+  if (!m_complete)
+    return std::max(m_pending_size, m_peaks[0].size);
+  return m_peaks[0].size;
+}
+
+guint Waveform::get_ready_size() {
+  return m_peaks[0].size;
+}
+
+bool Waveform::is_complete() {
+  return m_complete;
 }
 
 gint64 Waveform::get_duration() {
@@ -62,102 +118,382 @@ gint64 Waveform::get_duration() {
 }
 
 double Waveform::get_channel(unsigned int ch, guint64 pos) {
-  pos = CLAMP(pos, 0, get_size());
-  ch = CLAMP(ch, 0, m_n_channels);
+  if (m_n_channels == 0)
+    return 0;
+
+  ch = std::min(ch, m_n_channels - 1);
+
+  const Peaks &peaks = m_peaks[ch];
+  if (peaks.size == 0)
+    return 0;
 
-  return m_channels[ch][pos];
+  return get_peak(peaks, std::min(pos, peaks.size - 1));
+}
+
+// Return the greatest peak of the channel in [first, last).
+// Like a segment tree: the unpaired bounds are read at each level, then the
+// range goes up to the next level.
+double Waveform::get_peak_max(unsigned int ch, guint64 first, guint64 last) {
+  if (m_n_channels == 0)
+    return 0;
+
+  const Peaks &peaks = m_peaks[std::min(ch, m_n_channels - 1)];
+
+  last = std::min(last, peaks.size);
+  if (first >= last)
+    return 0;
+
+  // The peaks are amplitudes, 0 is the minimum
+  double value = 0;
+  if (first & 1)
+    value = std::max(value, get_peak(peaks, first++));
+  if (last & 1)
+    value = std::max(value, get_peak(peaks, --last));
+  first >>= 1;
+  last >>= 1;
+
+  for (const auto &level : peaks.levels) {
+    if (first >= last)
+      break;
+    if (first & 1)
+      value = std::max(value, static_cast<double>(level[first++]));
+    if (last & 1)
+      value = std::max(value, static_cast<double>(level[--last]));
+    first >>= 1;
+    last >>= 1;
+  }
+  return value;
+}
+
+// Return the peak at pos (pos < size).
+double Waveform::get_peak(const Peaks &peaks, guint64 pos) {
+  if (peaks.int16 != nullptr)
+    return peaks.int16[pos] / 32767.0;
+  if (peaks.float32 != nullptr)
+    return peaks.float32[pos];
+  return peaks.values[pos];
+}
+
+// Update the pyramid of the channel from the peak first to the end.
+// The levels use about one float per peak. Only the entries which cover the
+// new peaks are computed, appending is O(count + log n).
+void Waveform::update_pyramid(Peaks &peaks, guint64 first) {
+  guint64 size = peaks.size;
+  gsize n = 0;
+  for (; size > 1; ++n) {
+    guint64 count = (size + 1) / 2;
+    first /= 2;
+
+    if (peaks.levels.size() <= n)
+      peaks.levels.emplace_back();
+    std::vector<float> &level = peaks.levels[n];
+    level.resize(count);
+
+    for (guint64 i = first; i < count; ++i) {
+      double value = 0;
+      if (n == 0) {
+        value = get_peak(peaks, 2 * i);
+        if (2 * i + 1 < size)
+          value = std::max(value, get_peak(peaks, 2 * i + 1));
+      } else {
+        const std::vector<float> &prev = peaks.levels[n - 1];
+        value = prev[2 * i];
+        if (2 * i + 1 < size)
+          value = std::max(value, static_cast<double>(prev[2 * i + 1]));
+      }
+      level[i] = static_cast<float>(value);
+    }
+    size = count;
+  }
+  peaks.levels.resize(n);
+}
+
+// Replace the peaks of the channel (generators), peaks is swapped.
+void Waveform::set_channel(unsigned int ch, std::vector<double> &peaks) {
+  g_return_if_fail(ch < MAX_CHANNELS);
+
+  Peaks &dst = m_peaks[ch];
+  dst.values.swap(peaks);
+  dst.int16 = nullptr;
+  dst.float32 = nullptr;
+  dst.size = dst.values.size();
+  dst.levels.clear();
+
+  update_pyramid(dst, 0);
+}
+
+// Generators: the peaks will be appended progressively.
+void Waveform::set_pending(guint64 size) {
+  m_pending_size = size;
+  m_complete = false;
+}
+
+// Generators: append count peaks to the channel and update its pyramid.
+void Waveform::append_channel(unsigned int ch, const double *peaks,
+                              gsize count) {
+  g_return_if_fail(ch < MAX_CHANNELS);
+
+  Peaks &dst = m_peaks[ch];
+  g_return_if_fail(dst.int16 == nullptr && dst.float32 == nullptr);
+
+  guint64 first = dst.size;
+  dst.values.insert(dst.values.end(), peaks, peaks + count);
+  dst.size = dst.values.size();
+
+  update_pyramid(dst, first);
+}
+
+// Generators: all the peaks are available.
+void Waveform::set_complete() {
+  m_pending_size = 0;
+  m_complete = true;
 }
 
 unsigned int Waveform::get_n_channels() {
   return m_n_channels;
 }
 
+// Release the peaks and the mapping.
+void Waveform::clear() {
+  for (auto &peaks : m_peaks) {
+    peaks = Peaks();
+  }
+  m_pending_size = 0;
+  m_complete = true;
+
+  if (m_mapped != nullptr) {
+    g_mapped_file_unref(m_mapped);
+    m_mapped = nullptr;
+  }
+}
+
 bool Waveform::open(const Glib::ustring &file_uri) {
   Glib::ustring filename = Glib::filename_from_uri(file_uri);
 
-  std::ifstream file(filename.c_str(), std::ios_base::binary);
-
-  if (!file) {
+  GError *error = nullptr;
+  GMappedFile *mapped = g_mapped_file_new(filename.c_str(), FALSE, &error);
+  if (mapped == nullptr) {
+    se_dbg_msg(SE_DBG_WAVEFORM, "Could not map '%s': %s", filename.c_str(),
+               error->message);
+    g_error_free(error);
     return false;
   }
 
-  std::string line;
+  const char *data = g_mapped_file_get_contents(mapped);
+  gsize size = g_mapped_file_get_length(mapped);
 
-  if (!std::getline(file, line)) {
-    file.close();
+  const char *eol =
+      (size > 0) ? static_cast<const char *>(std::memchr(data, '\n', size))
+                 : nullptr;
+  if (eol == nullptr) {
+    g_mapped_file_unref(mapped);
     return false;
   }
 
-  int version = 0;
+  std::string line(data, eol);
+
+  clear();
 
-  if (line == "waveform") {
-    version = 1;
-  } else if (line == "waveform v2") {
-    version = 2;
+  bool ok = false;
+  if (line == "waveform v3") {
+    // The peaks stay in the mapping
+    m_mapped = mapped;
+    ok = read_v3(data, size);
   } else {
-    file.close();
-    return false;
+    if (line == "waveform")
+      ok = read_v2(data, size, 1);
+    else if (line == "waveform v2")
+      ok = read_v2(data, size, 2);
+    g_mapped_file_unref(mapped);
   }
 
-  if (!std::getline(file, line)) {
-    file.close();
+  if (!ok) {
+    clear();
+    m_n_channels = 0;
     return false;
   }
 
-  m_video_uri = line;
+  m_waveform_uri = file_uri;
+
+  return true;
+}
 
-  file.read((char *)&m_n_channels, sizeof(m_n_channels));
-  file.read((char *)&m_duration, sizeof(m_duration));
+// Read the v1/v2 format from the data of the file.
+// The values of a channel are copied in one block.
+bool Waveform::read_v2(const char *data, gsize size, int version) {
+  const char *end = data + size;
+  // After the first line (version)
+  const char *pos =
+      static_cast<const char *>(std::memchr(data, '\n', size)) + 1;
+
+  // The video uri
+  const char *eol =
+      static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+  if (eol == nullptr)
+    return false;
+
+  m_video_uri = std::string(pos, eol);
+  pos = eol + 1;
+
+  guint n_channels = 0;
+  gint64 duration = 0;
+  if (gsize(end - pos) < sizeof(n_channels) + sizeof(duration))
+    return false;
+
+  std::memcpy(&n_channels, pos, sizeof(n_channels));
+  pos += sizeof(n_channels);
+  std::memcpy(&duration, pos, sizeof(duration));
+  pos += sizeof(duration);
+
+  if (n_channels > MAX_CHANNELS)
+    return false;
+
+  m_n_channels = n_channels;
+  m_duration = duration;
 
   if (version == 1) {
     m_duration = m_duration / 1000000;  // GST_MSECOND=1000000;
   }
 
   for (unsigned int n = 0; n < m_n_channels; ++n) {
-    std::vector<double>::size_type size = 0;
+    std::vector<double>::size_type count = 0;
 
-    file.read((char *)&size, sizeof(size));
+    if (gsize(end - pos) < sizeof(count))
+      return false;
+    std::memcpy(&count, pos, sizeof(count));
+    pos += sizeof(count);
 
-    m_channels[n].resize(size);
+    if (count > gsize(end - pos) / sizeof(double))
+      return false;
 
-    for (unsigned int i = 0; i < size; ++i) {
-      file.read((char *)&m_channels[n][i], sizeof(double));
-    }
+    std::vector<double> values(count);
+    std::memcpy(values.data(), pos, count * sizeof(double));
+    pos += count * sizeof(double);
+
+    set_channel(n, values);
   }
+  return true;
+}
 
-  file.close();
+// Use the v3 format from the mapping of the file.
+// The peaks point to the mapping.
+bool Waveform::read_v3(const char *data, gsize size) {
+  WaveformHeaderV3 header;
+  if (size < sizeof(header))
+    return false;
 
-  m_waveform_uri = file_uri;
+  std::memcpy(&header, data, sizeof(header));
 
-  return true;
-}
+  if (std::memcmp(header.magic, MAGIC_V3, sizeof(MAGIC_V3)) != 0)
+    return false;
 
-bool Waveform::save(const Glib::ustring &file_uri) {
-  Glib::ustring filename = Glib::filename_from_uri(file_uri);
+  if (header.byte_order != BYTE_ORDER_MARK) {
+    se_dbg_msg(SE_DBG_WAVEFORM, "The byte order of the file is not supported");
+    return false;
+  }
 
-  std::ofstream file(filename.c_str(), std::ios_base::binary);
+  gsize sample_size = get_sample_size(header.sample_type);
+  if (sample_size == 0 || header.n_channels > MAX_CHANNELS)
+    return false;
 
-  if (!file)
+  // The uri is before the peaks, the peaks are aligned
+  if (header.data_offset % ALIGNMENT != 0 ||
+      header.data_offset < sizeof(header) + header.video_uri_size ||
+      header.data_offset > size)
     return false;
 
-  file << "waveform v2" << std::endl;
+  if (header.n_samples > size / sample_size)
+    return false;
 
-  file << m_video_uri << std::endl;
+  guint64 stride = align_size(header.n_samples * sample_size);
+  if (header.n_channels > 0 &&
+      stride > (size - header.data_offset) / header.n_channels)
+    return false;
 
-  file.write((const char *)&m_n_channels, sizeof(m_n_channels));
-  file.write((const char *)&m_duration, sizeof(m_duration));
+  m_video_uri = std::string(data + sizeof(header), header.video_uri_size);
+  m_n_channels = header.n_channels;
+  m_duration = header.duration;
 
-  for (unsigned int n = 0; n < m_n_channels; ++n) {
-    std::vector<double>::size_type size = m_channels[n].size();
+  const char *peaks = data + header.data_offset;
+  for (unsigned int n = 0; n < m_n_channels; ++n, peaks += stride) {
+    Peaks &dst = m_peaks[n];
+    if (header.sample_type == SAMPLE_INT16)
+      dst.int16 = reinterpret_cast<const gint16 *>(peaks);
+    else
+      dst.float32 = reinterpret_cast<const float *>(peaks);
+    dst.size = header.n_samples;
 
-    file.write((const char *)&size, sizeof(size));
+    update_pyramid(dst, 0);
+  }
+  return true;
+}
 
-    for (unsigned int i = 0; i < size; ++i) {
-      file.write((const char *)&m_channels[n][i], sizeof(double));
+// Save the waveform in the v3 format.
+bool Waveform::save(const Glib::ustring &file_uri, SampleType type) {
+  gsize sample_size = get_sample_size(type);
+  g_return_val_if_fail(sample_size > 0, false);
+
+  std::string video_uri = m_video_uri;
+
+  WaveformHeaderV3 header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC_V3, sizeof(MAGIC_V3));
+  header.byte_order = BYTE_ORDER_MARK;
+  header.sample_type = type;
+  header.n_channels = m_n_channels;
+  header.video_uri_size = video_uri.size();
+  header.duration = m_duration;
+  header.n_samples = get_size();
+  header.data_offset = align_size(sizeof(header) + video_uri.size());
+
+  guint64 stride = align_size(header.n_samples * sample_size);
+
+  try {
+    // The file is replaced at the end, the old file can be the mapping of
+    // this waveform
+    Glib::RefPtr<Gio::File> file = Gio::File::create_for_uri(file_uri);
+    Glib::RefPtr<Gio::FileOutputStream> stream = file->replace();
+    gsize bytes_written = 0;
+
+    std::string head(reinterpret_cast<const char *>(&header), sizeof(header));
+    head += video_uri;
+    head.resize(header.data_offset, '\0');
+    stream->write_all(head.data(), head.size(), bytes_written);
+
+    // The peaks are converted by blocks
+    std::vector<char> buffer;
+    const guint64 block = 16384;
+    for (unsigned int n = 0; n < m_n_channels; ++n) {
+      for (guint64 i = 0; i < header.n_samples; i += block) {
+        guint64 count = std::min(block, header.n_samples - i);
+        buffer.resize(count * sample_size);
+
+        if (type == SAMPLE_INT16) {
+          gint16 *dst = reinterpret_cast<gint16 *>(buffer.data());
+          for (guint64 j = 0; j < count; ++j) {
+            double value = CLAMP(get_channel(n, i + j), -1.0, 1.0);
+            dst[j] = static_cast<gint16>(lround(value * 32767));
+          }
+        } else {
+          float *dst = reinterpret_cast<float *>(buffer.data());
+          for (guint64 j = 0; j < count; ++j) {
+            dst[j] = static_cast<float>(get_channel(n, i + j));
+          }
+        }
+        stream->write_all(buffer.data(), buffer.size(), bytes_written);
+      }
+      // Alignment of the next channel
+      buffer.assign(stride - header.n_samples * sample_size, '\0');
+      if (!buffer.empty())
+        stream->write_all(buffer.data(), buffer.size(), bytes_written);
     }
-  }
 
-  file.close();
+    stream->close();
+  } catch (const Glib::Error &ex) {
+    std::cerr << "Could not save the waveform '" << file_uri
+              << "': " << ex.what() << std::endl;
+    return false;
+  }
 
   m_waveform_uri = file_uri;
 
@@ -23,27 +23,74 @@
 #include <glibmm.h>
 #include <vector>
 
+// The peaks of the channels of a media (0 to 1), one value per interval.
+// A pyramid of the max of the peaks is built when the peaks are set, the
+// renderers use it to draw the exact envelope at any zoom.
+// A generator can publish the peaks progressively (set_pending,
+// append_channel, set_complete), the peaks after get_ready_size() are
+// pending.
+// Formats of the files:
+//  - "waveform" (v1) and "waveform v2": native doubles, read in one block per
+//    channel.
+//  - "waveform v3": a header and the peaks as int16 or float32, each channel
+//    aligned on 16 bytes. The file is mapped in memory, the peaks are read
+//    from the mapping without copy.
 class Waveform {
  public:
+  // The type of the peaks in a v3 file
+  enum SampleType { SAMPLE_INT16 = 1, SAMPLE_FLOAT32 = 2 };
+
+  // The maximum number of channels
+  static const unsigned int MAX_CHANNELS = 3;
+
   Waveform();
   ~Waveform();
 
   // Open Wavefrom from file
   static Glib::RefPtr<Waveform> create_from_file(const Glib::ustring &uri);
 
+  // The number of peaks of the timeline. While the waveform is generated
+  // it's the final size.
   guint get_size();
 
+  // The number of peaks available, the same as get_size() when the waveform
+  // is complete.
+  guint get_ready_size();
+
+  // Return false while the waveform is generated.
+  bool is_complete();
+
   // long = SubtitleTime.totalmsec
   gint64 get_duration();
 
   // long = SubtitleTime.totalmsecs
   double get_channel(unsigned int channel, guint64 pos);
 
+  // Return the greatest peak of the channel in [first, last), 0 if the range
+  // is empty. The pyramid is used, the cost is O(log n) whatever the size of
+  // the range.
+  double get_peak_max(unsigned int channel, guint64 first, guint64 last);
+
+  // Replace the peaks of the channel (generators), peaks is swapped.
+  void set_channel(unsigned int channel, std::vector<double> &peaks);
+
+  // Generators: the peaks will be appended progressively, the timeline has
+  // size peaks (0 if unknown).
+  void set_pending(guint64 size);
+
+  // Generators: append count peaks to the channel and update its pyramid.
+  void append_channel(unsigned int channel, const double *peaks,
+                      gsize count);
+
+  // Generators: all the peaks are available.
+  void set_complete();
+
   unsigned int get_n_channels();
 
   bool open(const Glib::ustring &uri);
 
-  bool save(const Glib::ustring &uri);
+  // Save the waveform in the v3 format.
+  bool save(const Glib::ustring &uri, SampleType type = SAMPLE_INT16);
 
   // l'uri de la video source du waveform
   Glib::ustring get_video_uri();
@@ -58,9 +105,43 @@ class Waveform {
   Glib::ustring m_waveform_uri;
   Glib::ustring m_video_uri;
   guint m_n_channels{0};
-  std::vector<double> m_channels[3];
   gint64 m_duration{0};
 
  protected:
+  // The peaks of a channel, in memory (generated, v1/v2) or in the mapped
+  // file (v3)
+  struct Peaks {
+    std::vector<double> values;
+    const gint16 *int16{nullptr};
+    const float *float32{nullptr};
+    guint64 size{0};
+    // The max pyramid: levels[0][i] is the max of the peaks 2i and 2i+1,
+    // each level halves the previous one, up to a single value.
+    std::vector<std::vector<float>> levels;
+  };
+
+  // Return the peak at pos (pos < size).
+  static double get_peak(const Peaks &peaks, guint64 pos);
+
+  // Update the pyramid of the channel from the peak first to the end.
+  static void update_pyramid(Peaks &peaks, guint64 first);
+
+  // Read the v1/v2 format from the data of the file.
+  bool read_v2(const char *data, gsize size, int version);
+
+  // Use the v3 format from the mapping of the file.
+  bool read_v3(const char *data, gsize size);
+
+  // Release the peaks and the mapping.
+  void clear();
+
+ protected:
+  Peaks m_peaks[MAX_CHANNELS];
+  // The mapping of the v3 file, the peaks point inside
+  GMappedFile *m_mapped{nullptr};
+  // The final number of peaks while the waveform is generated
+  guint64 m_pending_size{0};
+  bool m_complete{true};
+
   mutable int ref_count_{0};
 };
@@ -460,6 +460,15 @@ void WaveformEditor::set_waveform(const Glib::RefPtr<Waveform> &wf) {
   redraw_renderer();
 }
 
+// The peaks of the current waveform have changed (generation in progress),
+// redisplay it.
+void WaveformEditor::update_waveform() {
+  se_dbg(SE_DBG_WAVEFORM);
+
+  if (has_renderer())
+    renderer()->waveform_changed();
+}
+
 // Return the state of waveform. Can be NULL.
 bool WaveformEditor::has_waveform() {
   return static_cast<bool>(get_waveform());
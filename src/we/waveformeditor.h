@@ -38,6 +38,10 @@ class WaveformEditor : public WaveformManager, public Gtk::Box {
   // Init the Waveform Editor and the WaveformRenderer with this wf
   void set_waveform(const Glib::RefPtr<Waveform>& wf);
 
+  // The peaks of the current waveform have changed (generation in
+  // progress), redisplay it.
+  void update_waveform();
+
   // Return the state of waveform. Cab be NULL.
   bool has_waveform();
 
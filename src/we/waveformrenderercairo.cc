@@ -18,6 +18,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include "document.h"
 #include "keyframes.h"
 #include "player.h"
@@ -82,6 +83,10 @@ class WaveformRendererCairo : public Gtk::DrawingArea, public WaveformRenderer {
   void draw_channel(const Cairo::RefPtr<Cairo::Context> &cr,
                     const Gdk::Rectangle &area, unsigned int channel);
 
+  // Mark the part of the timeline which is not yet generated.
+  void draw_pending(const Cairo::RefPtr<Cairo::Context> &cr,
+                    const Gdk::Rectangle &area);
+
   // Display the text of the subtitle.
   // start:
   // position of the start in the area : get_pos_by_time(subtitle.get_start)
@@ -398,6 +403,36 @@ void WaveformRendererCairo::draw_waveform(
     draw_channel(cr, Gdk::Rectangle(0, 0, area.get_width(), ch_height), i);
     cr->restore();
   }
+
+  if (!m_waveform->is_complete())
+    draw_pending(cr, area);
+}
+
+// Mark the part of the timeline which is not yet generated.
+void WaveformRendererCairo::draw_pending(
+    const Cairo::RefPtr<Cairo::Context> &cr, const Gdk::Rectangle &area) {
+  se_dbg(SE_DBG_WAVEFORM);
+
+  guint64 size = m_waveform->get_size();
+  if (size == 0)
+    return;
+
+  // The position of the first pending peak in the area
+  double ready = static_cast<double>(m_waveform->get_ready_size()) / size;
+  double x = ready * get_width() * zoom() - get_start_area();
+  if (x >= area.get_width())
+    return;
+  x = std::max(x, 0.0);
+
+  cr->set_source_rgba(m_color_wave_fill[0], m_color_wave_fill[1],
+                      m_color_wave_fill[2], m_color_wave_fill[3] * 0.3);
+  cr->rectangle(x, 0, area.get_width() - x, area.get_height());
+  cr->fill();
+
+  set_color(cr, m_color_text);
+  cr->move_to(x + 10, area.get_height() / 2);
+  cr->show_text(build_message(_("Generating the waveform (%d%%)..."),
+                              static_cast<int>(ready * 100)));
 }
 
 void WaveformRendererCairo::draw_channel(
@@ -408,8 +443,6 @@ void WaveformRendererCairo::draw_channel(
   if (!m_waveform)
     return;
 
-  std::vector<double> &peaks = m_waveform->m_channels[channel];
-
   set_color(cr, m_color_wave);
 
   int bottom = area.get_height();
@@ -420,28 +453,36 @@ void WaveformRendererCairo::draw_channel(
 
   se_dbg_msg(SE_DBG_WAVEFORM, "init drawing values");
 
-  int skip = 4;
   int z = zoom();
 
+  // Each column shows the max of the peaks it covers, read from the pyramid
+  // of the waveform: the envelope is exact at any zoom and the cost only
+  // depends on the width.
+  guint64 peaks_size = m_waveform->get_size();
   double begin =
-      peaks.size() * (static_cast<double>(get_start_area()) / (width * z));
-  double move = peaks.size() * (static_cast<double>(skip) / (width * z));
+      peaks_size * (static_cast<double>(get_start_area()) / (width * z));
+  double move = peaks_size / (static_cast<double>(width) * z);
   int length = width;
-  int peaks_size = peaks.size();
 
-  double x = begin;
-
-  se_dbg_msg(SE_DBG_WAVEFORM, "begin %f  move %f  length %d  peaks_size %d",
-             begin, move, length, peaks_size);
+  se_dbg_msg(SE_DBG_WAVEFORM, "begin %f  move %f  length %d  peaks_size %lu",
+             begin, move, length, static_cast<unsigned long>(peaks_size));
 
   se_dbg_msg(SE_DBG_WAVEFORM, "start drawing peaks");
 
+  // The peaks after ready are pending (generation in progress)
+  guint64 ready = m_waveform->get_ready_size();
+
   cr->line_to(0, bottom);
-  for (int t = 0; t < length; t += skip, x += move) {
-    int px = static_cast<int>(x);
-    if (px > peaks_size)
+  double x = begin;
+  for (int t = 0; t < length; ++t) {
+    guint64 first = static_cast<guint64>(x);
+    x += move;
+    if (first >= ready)
       break;
-    double peakOnScreen = peaks[px] * scale_value;
+    guint64 last = std::max(first + 1, static_cast<guint64>(x));
+
+    double peakOnScreen =
+        m_waveform->get_peak_max(channel, first, last) * scale_value;
 
     peakOnScreen = CLAMP(peakOnScreen, 0, bottom);
 
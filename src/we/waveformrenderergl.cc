@@ -22,6 +22,8 @@
 
 #include <GL/gl.h>
 #include <gtkglmm.h>
+#include <algorithm>
+#include <vector>
 
 #include "document.h"
 #include "keyframes.h"
@@ -83,6 +85,11 @@ class WaveformRendererGL : public Gtk::GL::DrawingArea,
   // Draw the text of the subtitles visible
   void draw_subtitles_text(const Gdk::Rectangle &rect);
 
+  // Compute the peak of each column of the area (visible part of the
+  // channel) from the pyramid of the waveform.
+  void get_columns(const Gdk::Rectangle &area, int channel,
+                   std::vector<float> &columns);
+
   // Draw the channel in the area with the lines methods
   void draw_channel_with_line_strip(const Gdk::Rectangle &area, int channel);
 
@@ -138,6 +145,9 @@ class WaveformRendererGL : public Gtk::GL::DrawingArea,
   Gdk::Rectangle m_displayListRect;
   GLuint m_displayList;
   GLsizei m_displayListSize;
+  // The view of the display list
+  int m_displayListZoom;
+  int m_displayListStart;
 };
 
 // Constructor
@@ -146,7 +156,9 @@ WaveformRendererGL::WaveformRendererGL()
       m_fontListBase(0),
       m_fontHeight(0),
       m_displayList(0),
-      m_displayListSize(0) {
+      m_displayListSize(0),
+      m_displayListZoom(0),
+      m_displayListStart(0) {
   Glib::RefPtr<Gdk::GL::Config> glconfig = create_glconfig();
   if (glconfig)
     set_gl_capability(glconfig);
@@ -425,24 +437,46 @@ void WaveformRendererGL::draw(GdkEventExpose *ev) {
     display_time_info(waveform_area);
 }
 
+// Compute the peak of each column of the area (visible part of the
+// channel) from the pyramid of the waveform.
+// The cost only depends on the width of the area, not on the zoom.
+void WaveformRendererGL::get_columns(const Gdk::Rectangle &area, int channel,
+                                     std::vector<float> &columns) {
+  columns.clear();
+
+  int width = area.get_width();
+  guint64 size = m_waveform->get_size();
+  // The peaks after ready are pending (generation in progress)
+  guint64 ready = m_waveform->get_ready_size();
+  double move = size / (static_cast<double>(width) * zoom());
+  double x = get_start_area() * move;
+
+  for (int t = 0; t < width; ++t) {
+    guint64 first = static_cast<guint64>(x);
+    x += move;
+    if (first >= ready)
+      break;
+    guint64 last = std::max(first + 1, static_cast<guint64>(x));
+
+    columns.push_back(m_waveform->get_peak_max(channel, first, last));
+  }
+}
+
 // Draw the channel in the area with the lines methods
 void WaveformRendererGL::draw_channel_with_line_strip(
     const Gdk::Rectangle &area, int channel) {
   if (!m_waveform)
     return;
 
-  std::vector<double> &peaks = m_waveform->m_channels[channel];
-
-  float skip = static_cast<float>(area.get_width()) / peaks.size();
-
-  float px = 0;
+  std::vector<float> columns;
+  get_columns(area, channel, columns);
 
   glColor4fv(m_color_wave_fill);
 
   glBegin(GL_LINE_STRIP);
 
-  for (const auto it = peaks.begin(); it != peaks.end(); ++it, px += skip)
-    glVertex2d(px, *it);
+  for (guint i = 0; i < columns.size(); ++i)
+    glVertex2d(i, columns[i]);
 
   glEnd();
 }
@@ -453,18 +487,15 @@ void WaveformRendererGL::draw_channel_with_quad_strip(
   if (!m_waveform)
     return;
 
-  std::vector<double> &peaks = m_waveform->m_channels[channel];
-
-  float skip = static_cast<float>(area.get_width()) / peaks.size();
-
-  float px = 0;
+  std::vector<float> columns;
+  get_columns(area, channel, columns);
 
   glColor4fv(m_color_wave);
 
   glBegin(GL_QUAD_STRIP);
-  for (const auto it it = peaks.begin(); it != peaks.end(); ++it, px += skip) {
-    glVertex2d(px, 0);
-    glVertex2d(px, *it);
+  for (guint i = 0; i < columns.size(); ++i) {
+    glVertex2d(i, 0);
+    glVertex2d(i, columns[i]);
   }
   glEnd();
 }
@@ -479,8 +510,9 @@ void WaveformRendererGL::delete_display_lists() {
 }
 
 // The Waveform used a display list for optimize the render.
-// If the OpenGL display list (waveform) is not yet create:
-// - Create the display list and draw the waveform inside.
+// If the OpenGL display list (waveform) is not yet create or the view
+// (width, zoom, scroll) is changed:
+// - Create the display list and draw the visible columns inside.
 // Call the display list for drawing the waveform.
 void WaveformRendererGL::draw_waveform(const Gdk::Rectangle &rect) {
   if (!m_waveform)
@@ -490,11 +522,17 @@ void WaveformRendererGL::draw_waveform(const Gdk::Rectangle &rect) {
 
   int h = rect.get_height() / n_channels;
 
+  if (m_displayListSize > 0 &&
+      (m_displayListRect.get_width() != rect.get_width() ||
+       m_displayListZoom != zoom() || m_displayListStart != get_start_area()))
+    delete_display_lists();
+
   if (m_displayListSize == 0) {
-    // display to rectangle 10x10
-    // after is scale to the widget area (size + zoom)
-    Gdk::Rectangle area(0, 0, 10, 10);
+    // one column by pixel, the height is scaled to the channel area
+    Gdk::Rectangle area(0, 0, rect.get_width(), 1);
     m_displayListRect = area;
+    m_displayListZoom = zoom();
+    m_displayListStart = get_start_area();
 
     m_displayListSize = n_channels;
 
@@ -512,26 +550,34 @@ void WaveformRendererGL::draw_waveform(const Gdk::Rectangle &rect) {
   glEnable(GL_SCISSOR_TEST);
   glEnable(GL_BLEND);
 
-  float d = m_displayListRect.get_width();
-  float r = rect.get_width();
-
-  float s = r / d;
-
   for (unsigned int i = 0; i < n_channels; ++i) {
     // clamp in waveform area
     glScissor(0, h * i, rect.get_width(), h);
 
     // position to channel area
     glPushMatrix();
-    glTranslatef(-get_start_area(), h * i, 0);
-    // apply scale and zoom
-    glScalef(s * zoom(), scale() * rect.get_height(), 1);
+    glTranslatef(0, h * i, 0);
+    // apply scale
+    glScalef(1, scale() * rect.get_height(), 1);
     // display the channel
     glCallList(m_displayList + i);
 
     glPopMatrix();
   }
   glDisable(GL_SCISSOR_TEST);
+
+  // Mark the part of the timeline which is not yet generated
+  guint64 size = m_waveform->get_size();
+  if (!m_waveform->is_complete() && size > 0) {
+    float x = static_cast<float>(m_waveform->get_ready_size()) / size *
+                  get_width() * zoom() -
+              get_start_area();
+    x = std::max(x, 0.0f);
+
+    glColor4f(m_color_wave_fill[0], m_color_wave_fill[1], m_color_wave_fill[2],
+              m_color_wave_fill[3] * 0.3f);
+    glRectf(x, 0, rect.get_width(), rect.get_height());
+  }
   glDisable(GL_BLEND);
 }
 
@@ -18,21 +18,84 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
+#include <cstring>
 #include "debug.h"
 #include "encodings.h"
 #include "error.h"
 #include "writer.h"
 
+// Format the integer in buf like printf "%0*ld", return the end of the
+// string (not null terminated).
+static char* format_int(char* buf, long value, int width) {
+  char digits[24];
+  int count = 0;
+  unsigned long n = (value < 0) ? -static_cast<unsigned long>(value) : value;
+  do {
+    digits[count++] = '0' + (n % 10);
+    n /= 10;
+  } while (n > 0);
+
+  if (value < 0) {
+    *buf++ = '-';
+    --width;
+  }
+  for (int i = count; i < width; ++i) {
+    *buf++ = '0';
+  }
+  while (count > 0) {
+    *buf++ = digits[--count];
+  }
+  return buf;
+}
+
 Writer::Writer() {
 }
 
 Writer::~Writer() {
 }
 
+// Return the data written in memory (empty with FileWriter).
 const Glib::ustring& Writer::get_data() const {
   return m_data;
 }
 
 void Writer::write(const Glib::ustring& buf) {
-  m_data += buf;
+  append(buf.data(), buf.bytes());
+}
+
+void Writer::write(const char* str) {
+  append(str, strlen(str));
+}
+
+void Writer::write(const char* data, gsize size) {
+  append(data, size);
+}
+
+void Writer::write(char c) {
+  append(&c, 1);
+}
+
+// Write the integer padded with zeros to width (printf "%0*ld").
+void Writer::write_int(long value, int width) {
+  char buf[64];
+  width = CLAMP(width, 0, 32);
+  append(buf, format_int(buf, value, width) - buf);
+}
+
+// Write the time as "hh:mm:ss<separator>mmm" (SubRip).
+void Writer::write_time(const SubtitleTime& time, char separator) {
+  char buf[128];
+  char* p = format_int(buf, time.hours(), 2);
+  *p++ = ':';
+  p = format_int(p, time.minutes(), 2);
+  *p++ = ':';
+  p = format_int(p, time.seconds(), 2);
+  *p++ = separator;
+  p = format_int(p, time.mseconds(), 3);
+  append(buf, p - buf);
+}
+
+// Append the UTF-8 data.
+void Writer::append(const char* data, gsize size) {
+  m_data.append(data, data + size);
 }
@@ -21,18 +21,39 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <glibmm.h>
+#include "subtitletime.h"
 
 // Helper to write data.
+// The data are written in UTF-8 with Unix newline. Writer keeps them in
+// memory (get_data), FileWriter streams them to a file.
 class Writer {
  public:
   Writer();
 
   virtual ~Writer();
 
+  // Return the data written in memory (empty with FileWriter).
   const Glib::ustring& get_data() const;
 
   void write(const Glib::ustring& buf);
 
+  void write(const char* str);
+
+  void write(const char* data, gsize size);
+
+  // Fast formatters, without allocation.
+
+  void write(char c);
+
+  // Write the integer padded with zeros to width (printf "%0*ld").
+  void write_int(long value, int width = 0);
+
+  // Write the time as "hh:mm:ss<separator>mmm" (SubRip).
+  void write_time(const SubtitleTime& time, char separator);
+
  protected:
+  // Append the UTF-8 data.
+  virtual void append(const char* data, gsize size);
+
   Glib::ustring m_data;
 };